@@ -11,6 +11,7 @@
 
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -71,11 +72,45 @@ struct cwio_data
 	int				size;
 	};
 
+#define CWIO_QUEUE_FLAG_INITIALIZED	(1 << 0)
+#define CWIO_QUEUE_FLAG_STOP		(1 << 1)
+
+struct cwio_request
+	{
+	struct cwio_data		*cwio_data;
+	int				result;
+	int				canceled;
+	};
+
+/*
+ * the counters submitted, started, completed and reaped only increase,
+ * req[counter % CWIO_QUEUE_SIZE] is the request belonging to a counter
+ * value. there is only one worker thread per queue, so requests are
+ * started and completed in the order they were submitted
+ */
+
+struct cwio_queue
+	{
+	int				flags;
+	struct cwio_device		*cwio_dev;
+	pthread_t			thread;
+	pthread_mutex_t			mutex;
+	pthread_cond_t			cond_submit;
+	pthread_cond_t			cond_complete;
+	unsigned int			submitted;
+	unsigned int			started;
+	unsigned int			completed;
+	unsigned int			reaped;
+	struct cwio_request		req[CWIO_QUEUE_SIZE];
+	};
+
 static const char			program_name[]               = "cwio";
 static const char			error_device_null[]          = "cwio_dev == NULL";
 static const char			error_data_null[]            = "cwio_data == NULL";
 static const char			error_device_not_open[]      = "device not open";
 static const char			error_data_not_initialized[] = "cwio_data not initialized";
+static const char			error_queue_null[]           = "cwio_queue == NULL";
+static const char			error_queue_not_initialized[] = "cwio_queue not initialized";
 
 
 
@@ -317,6 +352,177 @@ cwio_data_set_trackinfo(
 
 
 
+/****************************************************************************
+ * cwio_read_check
+ ****************************************************************************/
+static void
+cwio_read_check(
+	struct cwio_device		*cwio_dev,
+	struct cwio_data		*cwio_data)
+
+	{
+	if (cwio_dev == NULL) cwio_error(error_device_null);
+	if (cwio_data == NULL) cwio_error(error_data_null);
+	if (! (cwio_dev->flags & CWIO_DEVICE_FLAG_OPEN)) cwio_error(error_device_not_open);
+	if (cwio_dev->mode != CWIO_MODE_READ) cwio_error("device not opened for reading");
+	if (! (cwio_data->flags & CWIO_DATA_FLAG_INITIALIZED)) cwio_error(error_data_not_initialized);
+	}
+
+
+
+/****************************************************************************
+ * cwio_read_track
+ ****************************************************************************/
+static int
+cwio_read_track(
+	struct cwio_device		*cwio_dev,
+	struct cwio_data		*cwio_data)
+
+	{
+	struct cw_trackinfo		tri = CW_TRACKINFO_INIT;
+
+	cwio_data_set_trackinfo(cwio_data, &tri, cwio_data->data);
+	return (ioctl(cwio_dev->fd, CW_IOC_READ, &tri));
+	}
+
+
+
+/****************************************************************************
+ * cwio_write_check
+ ****************************************************************************/
+static void
+cwio_write_check(
+	struct cwio_device		*cwio_dev,
+	struct cwio_data		*cwio_data)
+
+	{
+	unsigned char			*data;
+	int				i;
+
+	if (cwio_dev == NULL) cwio_error(error_device_null);
+	if (cwio_data == NULL) cwio_error(error_data_null);
+	if (! (cwio_dev->flags & CWIO_DEVICE_FLAG_OPEN)) cwio_error(error_device_not_open);
+	if (cwio_dev->mode != CWIO_MODE_WRITE) cwio_error("device not opened for writing");
+	if (! (cwio_data->flags & CWIO_DATA_FLAG_INITIALIZED)) cwio_error(error_data_not_initialized);
+	if (cwio_data->mode == CWIO_DATA_MODE_INDEX_STORE) cwio_error("index storing not supported with writing");
+	if (cwio_data->size >= CWIO_MAX_TRACK_SIZE - CW_WRITE_OVERHEAD) cwio_error("track too large for writing");
+
+	data = cwio_data->data;
+	for (i = 0; i < cwio_data->size; i++)
+		{
+		if ((data[i] < 0x03) || (data[i] > 0x7e)) cwio_error("data contains values too small or too large for writing");
+		}
+	}
+
+
+
+/****************************************************************************
+ * cwio_write_track
+ ****************************************************************************/
+static int
+cwio_write_track(
+	struct cwio_device		*cwio_dev,
+	struct cwio_data		*cwio_data)
+
+	{
+	struct cw_trackinfo		tri = CW_TRACKINFO_INIT;
+	unsigned char			*data = cwio_data->data;
+#if CW_STRUCT_VERSION < 2
+	unsigned char			buffer[CWIO_BUFFER_SIZE];
+	int				i;
+#endif /* CW_STRUCT_VERSION */
+
+	/*
+	 * until cw-0.12 write values are subtracted from 0x80 in the driver.
+	 * this changed to 0x7f in cw-0.13
+	 */
+
+#if CW_STRUCT_VERSION < 2
+	for (i = 0; i < cwio_data->size; i++) buffer[i] = data[i] + 1;
+	data = buffer;
+#endif /* CW_STRUCT_VERSION */
+
+	cwio_data_set_trackinfo(cwio_data, &tri, data);
+	return (ioctl(cwio_dev->fd, CW_IOC_WRITE, &tri));
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_check
+ ****************************************************************************/
+static void
+cwio_queue_check(
+	struct cwio_queue		*cwio_queue)
+
+	{
+	if (cwio_queue == NULL) cwio_error(error_queue_null);
+	if (! (cwio_queue->flags & CWIO_QUEUE_FLAG_INITIALIZED)) cwio_error(error_queue_not_initialized);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_reap
+ ****************************************************************************/
+static struct cwio_data *
+cwio_queue_reap(
+	struct cwio_queue		*cwio_queue,
+	int				*result)
+
+	{
+	struct cwio_request		*req = &cwio_queue->req[cwio_queue->reaped++ % CWIO_QUEUE_SIZE];
+
+	/* has to be called with cwio_queue->mutex locked */
+
+	if (result != NULL) *result = req->result;
+	return (req->cwio_data);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_worker
+ ****************************************************************************/
+static void *
+cwio_queue_worker(
+	void				*arg)
+
+	{
+	struct cwio_queue		*cwio_queue = (struct cwio_queue *) arg;
+	struct cwio_device		*cwio_dev = cwio_queue->cwio_dev;
+	struct cwio_request		*req;
+	int				result;
+
+	pthread_mutex_lock(&cwio_queue->mutex);
+	while (1)
+		{
+		while ((cwio_queue->started == cwio_queue->submitted) && (! (cwio_queue->flags & CWIO_QUEUE_FLAG_STOP))) pthread_cond_wait(&cwio_queue->cond_submit, &cwio_queue->mutex);
+		if (cwio_queue->started == cwio_queue->submitted) break;
+		req = &cwio_queue->req[cwio_queue->started++ % CWIO_QUEUE_SIZE];
+
+		/* do the track operation without holding the mutex */
+
+		result = CWIO_RESULT_CANCELED;
+		if (! req->canceled)
+			{
+			pthread_mutex_unlock(&cwio_queue->mutex);
+			if (cwio_dev->mode == CWIO_MODE_WRITE) result = cwio_write_track(cwio_dev, req->cwio_data);
+			else result = cwio_read_track(cwio_dev, req->cwio_data);
+			if (result < 0) result = CWIO_RESULT_ERROR;
+			pthread_mutex_lock(&cwio_queue->mutex);
+			}
+		req->result = result;
+		cwio_queue->completed++;
+		pthread_cond_broadcast(&cwio_queue->cond_complete);
+		}
+	pthread_mutex_unlock(&cwio_queue->mutex);
+	return (NULL);
+	}
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -490,17 +696,10 @@ cwio_read(
 	struct cwio_data		*cwio_data)
 
 	{
-	struct cw_trackinfo		tri = CW_TRACKINFO_INIT;
 	int				result;
 
-	if (cwio_dev == NULL) cwio_error(error_device_null);
-	if (cwio_data == NULL) cwio_error(error_data_null);
-	if (! (cwio_dev->flags & CWIO_DEVICE_FLAG_OPEN)) cwio_error(error_device_not_open);
-	if (cwio_dev->mode != CWIO_MODE_READ) cwio_error("device not opened for reading");
-	if (! (cwio_data->flags & CWIO_DATA_FLAG_INITIALIZED)) cwio_error(error_data_not_initialized);
-
-	cwio_data_set_trackinfo(cwio_data, &tri, cwio_data->data);
-	result = ioctl(cwio_dev->fd, CW_IOC_READ, &tri);
+	cwio_read_check(cwio_dev, cwio_data);
+	result = cwio_read_track(cwio_dev, cwio_data);
 	if (result == -1) cwio_perror("error while reading track");
 
 	/* return how many bytes we have got */
@@ -519,44 +718,203 @@ cwio_write(
 	struct cwio_data		*cwio_data)
 
 	{
-	struct cw_trackinfo		tri = CW_TRACKINFO_INIT;
 	int				result;
-	unsigned char			*data;
-	int				i;
-#if CW_STRUCT_VERSION < 2
-	unsigned char			buffer[CWIO_BUFFER_SIZE];
-#endif /* CW_STRUCT_VERSION */
 
+	cwio_write_check(cwio_dev, cwio_data);
+	result = cwio_write_track(cwio_dev, cwio_data);
+	if (result == -1) cwio_perror("error while writing track");
+
+	/* how many bytes were written */
+
+	return (result);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_struct_size
+ ****************************************************************************/
+int
+cwio_queue_struct_size(
+	void)
+
+	{
+	return (sizeof (struct cwio_queue));
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_init
+ ****************************************************************************/
+int
+cwio_queue_init(
+	struct cwio_queue		*cwio_queue,
+	struct cwio_device		*cwio_dev)
+
+	{
+	if (cwio_queue == NULL) cwio_error(error_queue_null);
 	if (cwio_dev == NULL) cwio_error(error_device_null);
-	if (cwio_data == NULL) cwio_error(error_data_null);
 	if (! (cwio_dev->flags & CWIO_DEVICE_FLAG_OPEN)) cwio_error(error_device_not_open);
-	if (cwio_dev->mode != CWIO_MODE_WRITE) cwio_error("device not opened for writing");
-	if (! (cwio_data->flags & CWIO_DATA_FLAG_INITIALIZED)) cwio_error(error_data_not_initialized);
-	if (cwio_data->mode == CWIO_DATA_MODE_INDEX_STORE) cwio_error("index storing not supported with writing");
-	if (cwio_data->size >= CWIO_MAX_TRACK_SIZE - CW_WRITE_OVERHEAD) cwio_error("track too large for writing");
+	*cwio_queue = (struct cwio_queue)
+		{
+		.flags    = CWIO_QUEUE_FLAG_INITIALIZED,
+		.cwio_dev = cwio_dev
+		};
+	if (pthread_mutex_init(&cwio_queue->mutex, NULL) != 0) cwio_error("error while initializing queue mutex");
+	if (pthread_cond_init(&cwio_queue->cond_submit, NULL) != 0) cwio_error("error while initializing queue condition");
+	if (pthread_cond_init(&cwio_queue->cond_complete, NULL) != 0) cwio_error("error while initializing queue condition");
+	if (pthread_create(&cwio_queue->thread, NULL, cwio_queue_worker, cwio_queue) != 0) cwio_error("error while creating queue worker thread");
 
-	data = cwio_data->data;
-	for (i = 0; i < cwio_data->size; i++)
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_deinit
+ ****************************************************************************/
+int
+cwio_queue_deinit(
+	struct cwio_queue		*cwio_queue)
+
+	{
+	cwio_queue_check(cwio_queue);
+
+	/*
+	 * cancel all requests not yet started and wait until the worker
+	 * finished the current one. completed but not yet reaped requests
+	 * are simply dropped
+	 */
+
+	cwio_queue_cancel(cwio_queue);
+	pthread_mutex_lock(&cwio_queue->mutex);
+	cwio_queue->flags |= CWIO_QUEUE_FLAG_STOP;
+	pthread_cond_signal(&cwio_queue->cond_submit);
+	pthread_mutex_unlock(&cwio_queue->mutex);
+	pthread_join(cwio_queue->thread, NULL);
+	pthread_cond_destroy(&cwio_queue->cond_complete);
+	pthread_cond_destroy(&cwio_queue->cond_submit);
+	pthread_mutex_destroy(&cwio_queue->mutex);
+	cwio_queue->flags = 0;
+
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_submit
+ ****************************************************************************/
+int
+cwio_queue_submit(
+	struct cwio_queue		*cwio_queue,
+	struct cwio_data		*cwio_data)
+
+	{
+	struct cwio_request		*req;
+
+	/*
+	 * cwio_data and the buffer it points to are owned by the caller,
+	 * nothing is copied. so both must not be touched until the request
+	 * is returned by cwio_queue_poll() or cwio_queue_wait()
+	 */
+
+	cwio_queue_check(cwio_queue);
+	if (cwio_queue->cwio_dev->mode == CWIO_MODE_WRITE) cwio_write_check(cwio_queue->cwio_dev, cwio_data);
+	else cwio_read_check(cwio_queue->cwio_dev, cwio_data);
+
+	/* return -1 if queue is full */
+
+	pthread_mutex_lock(&cwio_queue->mutex);
+	if (cwio_queue->submitted - cwio_queue->reaped >= CWIO_QUEUE_SIZE)
 		{
-		if ((data[i] < 0x03) || (data[i] > 0x7e)) cwio_error("data contains values too small or too large for writing");
+		pthread_mutex_unlock(&cwio_queue->mutex);
+		return (-1);
 		}
+	req = &cwio_queue->req[cwio_queue->submitted++ % CWIO_QUEUE_SIZE];
+	*req = (struct cwio_request) { .cwio_data = cwio_data };
+	pthread_cond_signal(&cwio_queue->cond_submit);
+	pthread_mutex_unlock(&cwio_queue->mutex);
+
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_poll
+ ****************************************************************************/
+struct cwio_data *
+cwio_queue_poll(
+	struct cwio_queue		*cwio_queue,
+	int				*result)
+
+	{
+	struct cwio_data		*cwio_data = NULL;
+
+	/* return NULL if no request is completed yet */
+
+	cwio_queue_check(cwio_queue);
+	pthread_mutex_lock(&cwio_queue->mutex);
+	if (cwio_queue->reaped != cwio_queue->completed) cwio_data = cwio_queue_reap(cwio_queue, result);
+	pthread_mutex_unlock(&cwio_queue->mutex);
+
+	return (cwio_data);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_wait
+ ****************************************************************************/
+struct cwio_data *
+cwio_queue_wait(
+	struct cwio_queue		*cwio_queue,
+	int				*result)
+
+	{
+	struct cwio_data		*cwio_data = NULL;
+
+	/* return NULL if there is no outstanding request */
+
+	cwio_queue_check(cwio_queue);
+	pthread_mutex_lock(&cwio_queue->mutex);
+	if (cwio_queue->reaped != cwio_queue->submitted)
+		{
+		while (cwio_queue->reaped == cwio_queue->completed) pthread_cond_wait(&cwio_queue->cond_complete, &cwio_queue->mutex);
+		cwio_data = cwio_queue_reap(cwio_queue, result);
+		}
+	pthread_mutex_unlock(&cwio_queue->mutex);
+
+	return (cwio_data);
+	}
+
+
+
+/****************************************************************************
+ * cwio_queue_cancel
+ ****************************************************************************/
+int
+cwio_queue_cancel(
+	struct cwio_queue		*cwio_queue)
+
+	{
+	unsigned int			i;
+	int				canceled = 0;
 
 	/*
-	 * until cw-0.12 write values are subtracted from 0x80 in the driver.
-	 * this changed to 0x7f in cw-0.13
+	 * the request currently processed by the worker can not be
+	 * canceled, all others will complete with CWIO_RESULT_CANCELED
 	 */
 
-#if CW_STRUCT_VERSION < 2
-	for (i = 0; i < cwio_data->size; i++) buffer[i] = data[i] + 1;
-	data = buffer;
-#endif /* CW_STRUCT_VERSION */
+	cwio_queue_check(cwio_queue);
+	pthread_mutex_lock(&cwio_queue->mutex);
+	for (i = cwio_queue->started; i != cwio_queue->submitted; i++, canceled++) cwio_queue->req[i % CWIO_QUEUE_SIZE].canceled = 1;
+	pthread_mutex_unlock(&cwio_queue->mutex);
 
-	cwio_data_set_trackinfo(cwio_data, &tri, data);
-	result = ioctl(cwio_dev->fd, CW_IOC_WRITE, &tri);
-	if (result == -1) cwio_perror("error while writing track");
+	/* return number of canceled requests */
 
-	/* how many bytes were written */
-
-	return (result);
+	return (canceled);
 	}
 /******************************************************** Karsten Scheibler */
@@ -43,15 +43,30 @@
 #define CWIO_MODE_READ			1
 #define CWIO_MODE_WRITE			2
 
+/*
+ * number of requests a struct cwio_queue can hold at once (submitted but
+ * not yet reaped with cwio_queue_poll() or cwio_queue_wait()). results
+ * below 0 returned for a request mean: CWIO_RESULT_ERROR - the track
+ * operation failed (errno of the worker thread is lost, so no more
+ * details are available), CWIO_RESULT_CANCELED - the request was
+ * canceled with cwio_queue_cancel() before it was started
+ */
+
+#define CWIO_QUEUE_SIZE			64
+#define CWIO_RESULT_ERROR		-1
+#define CWIO_RESULT_CANCELED		-2
+
 /*
  * those structs are defined in cwio.c, so there is no way to know the inner
  * members for callers who use cwio.h. use the functions
- * cwio_device_struct_size() and cwio_data_struct_size() to determine how
- * many bytes you need to allocate for the structs
+ * cwio_device_struct_size(), cwio_data_struct_size() and
+ * cwio_queue_struct_size() to determine how many bytes you need to allocate
+ * for the structs
  */
 
 struct cwio_device;
 struct cwio_data;
+struct cwio_queue;
 
 
 
@@ -113,6 +128,38 @@ cwio_write(
 	struct cwio_device		*cwio_dev,
 	struct cwio_data		*cwio_data);
 
+extern int
+cwio_queue_struct_size(
+	void);
+
+extern int
+cwio_queue_init(
+	struct cwio_queue		*cwio_queue,
+	struct cwio_device		*cwio_dev);
+
+extern int
+cwio_queue_deinit(
+	struct cwio_queue		*cwio_queue);
+
+extern int
+cwio_queue_submit(
+	struct cwio_queue		*cwio_queue,
+	struct cwio_data		*cwio_data);
+
+extern struct cwio_data *
+cwio_queue_poll(
+	struct cwio_queue		*cwio_queue,
+	int				*result);
+
+extern struct cwio_data *
+cwio_queue_wait(
+	struct cwio_queue		*cwio_queue,
+	int				*result);
+
+extern int
+cwio_queue_cancel(
+	struct cwio_queue		*cwio_queue);
+
 
 
 #endif /* !CWIO_H */
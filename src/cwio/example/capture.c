@@ -0,0 +1,205 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * capture.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <alloca.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cwio.h"
+
+/*
+ * this example reads all tracks of a disk with the asynchronous queue
+ * interface of cwio and streams them to stdout in the raw image format
+ * of cwtool ("cwtool raw data 3"). while one track is written to stdout
+ * the next ones are already read by the driver
+ */
+
+#define NR_TRACKS			84
+#define NR_SIDES			2
+#define NR_BUFFERS			4
+#define MAGIC				"cwtool raw data 3"
+#define MAGIC_SIZE			32
+#define TRACK_MAGIC			0xca
+#define HEADER_FLAG_INDEX_STORED	(1 << 1)
+
+struct capture
+	{
+	struct cwio_data		*cwio_data;
+	int				track;
+	int				side;
+	unsigned char			buffer[CWIO_BUFFER_SIZE];
+	};
+
+
+
+/****************************************************************************
+ * capture_submit
+ ****************************************************************************/
+static int
+capture_submit(
+	struct cwio_queue		*cwio_queue,
+	struct capture			*cap,
+	int				track,
+	int				side)
+
+	{
+	cap->track = track;
+	cap->side  = side;
+	cwio_data_set_params(
+		cap->cwio_data,
+		track,
+		side,
+		CWIO_DATA_CLOCK_14MHZ,
+		CWIO_DATA_MODE_INDEX_STORE,
+		400,
+		cap->buffer,
+		sizeof (cap->buffer));
+	return (cwio_queue_submit(cwio_queue, cap->cwio_data));
+	}
+
+
+
+/****************************************************************************
+ * capture_write
+ ****************************************************************************/
+static void
+capture_write(
+	struct capture			*cap,
+	int				len)
+
+	{
+	unsigned char			header[8] =
+		{
+		TRACK_MAGIC,
+		2 * cap->track + cap->side,
+		0,			/* clock: 0 = 14 MHz */
+		HEADER_FLAG_INDEX_STORED,
+		len & 0xff,
+		(len >> 8) & 0xff,
+		(len >> 16) & 0xff,
+		(len >> 24) & 0xff
+		};
+
+	fwrite(header, 1, sizeof (header), stdout);
+	fwrite(cap->buffer, 1, len, stdout);
+	}
+
+
+
+/****************************************************************************
+ * main
+ ****************************************************************************/
+int
+main(
+	void)
+
+	{
+	struct cwio_device		*cwio_dev;
+	struct cwio_queue		*cwio_queue;
+	struct cwio_data		*cwio_data;
+	struct capture			*cap;
+	char				magic[MAGIC_SIZE];
+	int				tracks = NR_TRACKS;
+	int				next = 0;
+	int				error = 0;
+	int				i, result;
+
+	/*
+	 * allocate memory for cwio_dev, cwio_queue and the capture buffers.
+	 * each buffer gets its own cwio_data, the queue does not copy
+	 * anything, so a buffer must not be touched until its cwio_data is
+	 * returned by cwio_queue_wait()
+	 */
+
+	cwio_dev   = alloca(cwio_device_struct_size());
+	cwio_queue = alloca(cwio_queue_struct_size());
+	cap        = malloc(NR_BUFFERS * sizeof (struct capture));
+	if ((cwio_dev == NULL) || (cwio_queue == NULL) || (cap == NULL))
+		{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+		}
+	for (i = 0; i < NR_BUFFERS; i++)
+		{
+		cap[i].cwio_data = malloc(cwio_data_struct_size());
+		if (cap[i].cwio_data == NULL)
+			{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+			}
+		}
+
+	/* set device parameters, open device for reading and init queue */
+
+	cwio_device_set_params(
+		cwio_dev,
+		"/dev/cw0raw0",
+		CWIO_DEVICE_TYPE_ANY);
+	cwio_open(cwio_dev, CWIO_MODE_READ);
+	if (cwio_device_has_double_step(cwio_dev)) tracks /= 2;
+	cwio_queue_init(cwio_queue, cwio_dev);
+
+	/* write file header */
+
+	memset(magic, 0, sizeof (magic));
+	strcpy(magic, MAGIC);
+	fwrite(magic, 1, sizeof (magic), stdout);
+
+	/* fill the queue, requests are processed in submission order */
+
+	for (i = 0; (i < NR_BUFFERS) && (next < NR_SIDES * tracks); i++, next++)
+		{
+		capture_submit(cwio_queue, &cap[i], next / NR_SIDES, next % NR_SIDES);
+		}
+
+	/*
+	 * wait for the oldest request, dump it and reuse its buffer for the
+	 * next track. after an error nothing is submitted or dumped any
+	 * more, the outstanding requests are canceled and only reaped, so
+	 * no buffer is in use when they are freed. cwio_queue_wait()
+	 * returns NULL if nothing is outstanding any more
+	 */
+
+	while ((cwio_data = cwio_queue_wait(cwio_queue, &result)) != NULL)
+		{
+		for (i = 0; cap[i].cwio_data != cwio_data; i++) ;
+		if (error) continue;
+		if (result < 0)
+			{
+			fprintf(stderr, "error while reading track %d side %d\n", cap[i].track, cap[i].side);
+			cwio_queue_cancel(cwio_queue);
+			error = 1;
+			continue;
+			}
+		fprintf(stderr, "read track %d side %d\n", cap[i].track, cap[i].side);
+		capture_write(&cap[i], result);
+		if (next >= NR_SIDES * tracks) continue;
+		if (capture_submit(cwio_queue, &cap[i], next / NR_SIDES, next % NR_SIDES) == -1)
+			{
+			fprintf(stderr, "error while submitting track %d side %d\n", next / NR_SIDES, next % NR_SIDES);
+			cwio_queue_cancel(cwio_queue);
+			error = 1;
+			continue;
+			}
+		next++;
+		}
+
+	/* done */
+
+	cwio_queue_deinit(cwio_queue);
+	cwio_close(cwio_dev);
+	for (i = 0; i < NR_BUFFERS; i++) free(cap[i].cwio_data);
+	free(cap);
+	return (error);
+	}
+/******************************************************** Karsten Scheibler */
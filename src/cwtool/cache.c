@@ -0,0 +1,418 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * cache.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "options.h"
+#include "disk.h"
+#include "file.h"
+#include "import.h"
+#include "export.h"
+#include "string.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define MAGIC_SIZE			32
+#define HEADER_SIZE			4
+#define SECTOR_HEADER_SIZE		16
+#define NAME_SIZE			16
+
+struct cache_entry
+	{
+	time_t				mtime;
+	cw_size64_t			size;
+	cw_char_t			name[NAME_SIZE + 1];
+	};
+
+static const cw_char_t			magic[MAGIC_SIZE] = "cwtool track cache 1";
+static pthread_mutex_t			cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static cw_bool_t			cache_scanned;
+static cw_size64_t			cache_used;
+static cw_count_t			cache_tmp_count;
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * cache_path
+ ****************************************************************************/
+static cw_char_t *
+cache_path(
+	cw_char_t			*path,
+	cw_size_t			size,
+	const cw_char_t			*name)
+
+	{
+	string_snprintf(path, size, "%s/%s", options_get_cache_path(), name);
+	return (path);
+	}
+
+
+
+/****************************************************************************
+ * cache_name
+ ****************************************************************************/
+static cw_char_t *
+cache_name(
+	cw_char_t			*name,
+	struct cache_key		*cch_key)
+
+	{
+	string_snprintf(name, NAME_SIZE + 1, "%016llx", (unsigned long long) cch_key->hash);
+	return (name);
+	}
+
+
+
+/****************************************************************************
+ * cache_name_valid
+ ****************************************************************************/
+static cw_bool_t
+cache_name_valid(
+	const cw_char_t			*name)
+
+	{
+	cw_char_t			c;
+	cw_index_t			i;
+
+	for (i = 0; (c = name[i]) != '\0'; i++)
+		{
+		if ((c >= '0') && (c <= '9')) continue;
+		if ((c >= 'a') && (c <= 'f')) continue;
+		return (CW_BOOL_FALSE);
+		}
+	return ((i == NAME_SIZE) ? CW_BOOL_TRUE : CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * cache_scan
+ ****************************************************************************/
+static cw_size64_t
+cache_scan(
+	struct cache_entry		**cch_ent,
+	cw_count_t			*entries)
+
+	{
+	const cw_char_t			*dir_path = options_get_cache_path();
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	DIR				*dir;
+	struct dirent			*dir_ent;
+	struct stat			st;
+	cw_size64_t			size = 0;
+	cw_count_t			e = 0, max = 0;
+
+	/*
+	 * sum up the size of all entries in the cache directory, if
+	 * cch_ent is given also return a list of all entries. the cache
+	 * directory is created on first use
+	 */
+
+	if (cch_ent != NULL) *cch_ent = NULL;
+	dir = opendir(dir_path);
+	if ((dir == NULL) && (errno == ENOENT))
+		{
+		verbose_message(GENERIC, 1, "creating cache directory '%s'", dir_path);
+		if (mkdir(dir_path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) == -1) error_perror_message("error while creating cache directory '%s'", dir_path);
+		dir = opendir(dir_path);
+		}
+	if (dir == NULL) error_perror_message("error while opening cache directory '%s'", dir_path);
+	while ((dir_ent = readdir(dir)) != NULL)
+		{
+		if (! cache_name_valid(dir_ent->d_name)) continue;
+		if (stat(cache_path(path, sizeof (path), dir_ent->d_name), &st) == -1) continue;
+		size += st.st_size;
+		if (cch_ent == NULL) continue;
+		if (e >= max)
+			{
+			max = (max == 0) ? 1024 : 2 * max;
+			*cch_ent = realloc(*cch_ent, max * sizeof (struct cache_entry));
+			if (*cch_ent == NULL) error_oom();
+			}
+		(*cch_ent)[e] = (struct cache_entry) { .mtime = st.st_mtime, .size = st.st_size };
+		string_copy((*cch_ent)[e++].name, NAME_SIZE + 1, dir_ent->d_name);
+		}
+	closedir(dir);
+	if (entries != NULL) *entries = e;
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * cache_compare
+ ****************************************************************************/
+static int
+cache_compare(
+	const void			*entry1,
+	const void			*entry2)
+
+	{
+	const struct cache_entry	*cch_ent1 = entry1;
+	const struct cache_entry	*cch_ent2 = entry2;
+
+	if (cch_ent1->mtime < cch_ent2->mtime) return (-1);
+	if (cch_ent1->mtime > cch_ent2->mtime) return (1);
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * cache_evict
+ ****************************************************************************/
+static cw_void_t
+cache_evict(
+	cw_size64_t			limit)
+
+	{
+	struct cache_entry		*cch_ent;
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_count_t			entries;
+	cw_index_t			i;
+
+	/*
+	 * remove the least recently used entries (cache_lookup() touches
+	 * every entry it finds) until only 3/4 of limit are used, so this
+	 * is not needed again for the next few tracks. other processes
+	 * may use the same directory, so the real size is taken from the
+	 * directory and not from cache_used
+	 */
+
+	cache_used = cache_scan(&cch_ent, &entries);
+	qsort(cch_ent, entries, sizeof (struct cache_entry), cache_compare);
+	for (i = 0; (i < entries) && (cache_used > limit / 4 * 3); i++)
+		{
+		verbose_message(GENERIC, 2, "removing '%s' from cache", cch_ent[i].name);
+		if (unlink(cache_path(path, sizeof (path), cch_ent[i].name)) == -1) continue;
+		cache_used -= cch_ent[i].size;
+		}
+	if (cch_ent != NULL) free(cch_ent);
+	}
+
+
+
+/****************************************************************************
+ * cache_cleanup_mutex
+ ****************************************************************************/
+static cw_void_t
+cache_cleanup_mutex(
+	cw_void_t			*arg)
+
+	{
+
+	/*
+	 * cache_scan() may terminate only the current thread (cwtool -B),
+	 * so the mutex has to be unlocked by a pthread cleanup handler
+	 */
+
+	pthread_mutex_unlock((pthread_mutex_t *) arg);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * cache_enabled
+ ****************************************************************************/
+cw_bool_t
+cache_enabled(
+	cw_void_t)
+
+	{
+	if (options_get_cache_path() == NULL) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * cache_key_add
+ ****************************************************************************/
+cw_void_t
+cache_key_add(
+	struct cache_key		*cch_key,
+	const cw_void_t			*data,
+	cw_size_t			size)
+
+	{
+	const cw_u8_t			*d = data;
+	cw_u64_t			hash = cch_key->hash;
+	cw_index_t			i;
+
+	/* 64 bit FNV-1a */
+
+	for (i = 0; i < size; i++) hash = (hash ^ d[i]) * 0x100000001b3ULL;
+	cch_key->hash = hash;
+	}
+
+
+
+/****************************************************************************
+ * cache_lookup
+ ****************************************************************************/
+cw_bool_t
+cache_lookup(
+	struct cache_key		*cch_key,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			sectors)
+
+	{
+	struct file			fil;
+	cw_char_t			name[NAME_SIZE + 1];
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_u8_t				buffer[MAGIC_SIZE];
+	cw_bool_t			result = CW_BOOL_FALSE;
+	cw_index_t			i;
+
+	/*
+	 * on success err and data of all sectors are replaced with the
+	 * cached ones. dsk_sct may also be changed if CW_BOOL_FALSE is
+	 * returned
+	 */
+
+	if (! cache_enabled()) return (CW_BOOL_FALSE);
+	cache_path(path, sizeof (path), cache_name(name, cch_key));
+	if (! file_open(&fil, path, FILE_MODE_READ, FILE_FLAG_RETURN)) return (CW_BOOL_FALSE);
+	if (file_read(&fil, buffer, MAGIC_SIZE) != MAGIC_SIZE) goto done;
+	if (memcmp(buffer, magic, MAGIC_SIZE) != 0) goto done;
+	if (file_read(&fil, buffer, HEADER_SIZE) != HEADER_SIZE) goto done;
+	if (import_u32_le(buffer) != sectors) goto done;
+	for (i = 0; i < sectors; i++)
+		{
+		if (file_read(&fil, buffer, SECTOR_HEADER_SIZE) != SECTOR_HEADER_SIZE) goto done;
+		if (import_u32_le(&buffer[12]) != dsk_sct[i].size) goto done;
+		dsk_sct[i].err = (struct disk_error)
+			{
+			.flags    = import_u32_le(&buffer[0]),
+			.errors   = import_u32_le(&buffer[4]),
+			.warnings = import_u32_le(&buffer[8])
+			};
+		if (file_read(&fil, dsk_sct[i].data, dsk_sct[i].size) != dsk_sct[i].size) goto done;
+		}
+	result = CW_BOOL_TRUE;
+
+	/* mark entry as recently used for cache_evict() */
+
+	utime(path, NULL);
+	verbose_message(GENERIC, 2, "found decoded track in cache '%s'", path);
+done:
+	file_close(&fil);
+	return (result);
+	}
+
+
+
+/****************************************************************************
+ * cache_store
+ ****************************************************************************/
+cw_void_t
+cache_store(
+	struct cache_key		*cch_key,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			sectors)
+
+	{
+	struct file			fil;
+	cw_char_t			name[NAME_SIZE + 1];
+	cw_char_t			tmp_name[GLOBAL_MAX_NAME_SIZE];
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_char_t			tmp_path[GLOBAL_MAX_PATH_SIZE];
+	cw_u8_t				buffer[SECTOR_HEADER_SIZE];
+	cw_size64_t			limit = 1024 * 1024 * (cw_size64_t) options_get_cache_size();
+	cw_size64_t			size = MAGIC_SIZE + HEADER_SIZE;
+	cw_index_t			i;
+
+	if (! cache_enabled()) return;
+	cache_path(path, sizeof (path), cache_name(name, cch_key));
+	pthread_mutex_lock(&cache_mutex);
+	pthread_cleanup_push(cache_cleanup_mutex, &cache_mutex);
+	if (! cache_scanned) cache_used = cache_scan(NULL, NULL);
+	cache_scanned = CW_BOOL_TRUE;
+	string_snprintf(tmp_name, sizeof (tmp_name), "%s.%d.%d.tmp", name, getpid(), cache_tmp_count++);
+	pthread_cleanup_pop(1);
+
+	/*
+	 * write into a temporary file first and rename it afterwards, so
+	 * other readers never see an incomplete entry
+	 */
+
+	cache_path(tmp_path, sizeof (tmp_path), tmp_name);
+	file_open(&fil, tmp_path, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	file_write(&fil, magic, MAGIC_SIZE);
+	file_write(&fil, export_u32_le(buffer, sectors), HEADER_SIZE);
+	for (i = 0; i < sectors; i++)
+		{
+		export_u32_le(&buffer[0], dsk_sct[i].err.flags);
+		export_u32_le(&buffer[4], dsk_sct[i].err.errors);
+		export_u32_le(&buffer[8], dsk_sct[i].err.warnings);
+		export_u32_le(&buffer[12], dsk_sct[i].size);
+		file_write(&fil, buffer, SECTOR_HEADER_SIZE);
+		file_write(&fil, dsk_sct[i].data, dsk_sct[i].size);
+		size += SECTOR_HEADER_SIZE + dsk_sct[i].size;
+		}
+	file_close(&fil);
+	if (rename(tmp_path, path) == -1) error_perror_message("error while renaming '%s' to '%s'", tmp_path, path);
+	verbose_message(GENERIC, 2, "stored decoded track in cache '%s'", path);
+
+	/* cache_size == 0 means no limit */
+
+	pthread_mutex_lock(&cache_mutex);
+	pthread_cleanup_push(cache_cleanup_mutex, &cache_mutex);
+	cache_used += size;
+	if ((limit > 0) && (cache_used > limit)) cache_evict(limit);
+	pthread_cleanup_pop(1);
+	}
+/******************************************************** Karsten Scheibler */
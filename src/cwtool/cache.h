@@ -0,0 +1,83 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * cache.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_CACHE_H
+#define CWTOOL_CACHE_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * the cache stores decoded tracks in a directory, one file per track. the
+ * file name is the hash over everything the decoder gets as input, so a
+ * cached track is found again if the same raw data is decoded with the
+ * same format settings
+ */
+
+#define CACHE_KEY_INIT			(struct cache_key) { .hash = 0xcbf29ce484222325ULL }
+
+struct cache_key
+	{
+	cw_u64_t			hash;
+	};
+
+struct disk_sector;
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_bool_t
+cache_enabled(
+	cw_void_t);
+
+extern cw_void_t
+cache_key_add(
+	struct cache_key		*cch_key,
+	const cw_void_t			*data,
+	cw_size_t			size);
+
+extern cw_bool_t
+cache_lookup(
+	struct cache_key		*cch_key,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			sectors);
+
+extern cw_void_t
+cache_store(
+	struct cache_key		*cch_key,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			sectors);
+
+
+
+#endif /* !CWTOOL_CACHE_H */
+/******************************************************** Karsten Scheibler */
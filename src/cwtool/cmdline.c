@@ -85,31 +85,47 @@ cmdline_usage(
 		"or:    %s -L [-v] [-n] [-f <file>] [-e <config>]\n"
 		"or:    %s -S [-v] [-n] [-f <file>] [-e <config>]\n"
 		"       %s    [--] <diskname> <srcfile|device>\n"
-		"or:    %s -R [-v] [-n] [-f <file>] [-e <config>] [-r <num>]\n"
-		"       %s    [-o <file>] [--] <diskname> <srcfile|device>\n"
+		"or:    %s -P [-v] [-n] [-f <file>] [-e <config>]\n"
+		"       %s    [--] <srcfile|device> [<diskname> ... ]\n"
+		"or:    %s -R [-v] [-n] [-f <file>] [-e <config>] [-r <num>] [-c]\n"
+		"       %s    [-o|-O <file>] [--] <diskname> <srcfile|device>\n"
 		"       %s    [<srcfile> ... ] <dstfile>\n"
 		"or:    %s -W [-v] [-n] [-f <file>] [-e <config>] [-s]\n"
-		"       %s    [--] <diskname> <srcfile> <dstfile|device>\n\n"
+		"       %s    [--] <diskname> <srcfile> <dstfile|device>\n"
+		"or:    %s -M [-v] [-n] [-f <file>] [-e <config>] [-r <num>] [-c]\n"
+		"       %s    [--] <diskname> <device> <dstfile>\n"
+		"       %s    [<diskname> <device> <dstfile> ... ]\n"
+		"or:    %s -B [-v] [-n] [-f <file>] [-e <config>] [-r <num>] [-c]\n"
+		"       %s    [--] <jobfile>\n"
+		"or:    %s -T [-v] [--] <srcfile> <dstfile>\n\n"
 		"  -V            print out version\n"
 		"  -D            dump builtin config\n"
 		"  -I            initialize configured drives\n"
 		"  -L            list available disk names\n"
 		"  -S            print out statistics\n"
+		"  -P            probe disk and rank matching disk names\n"
 		"  -R            read disk\n"
 		"  -W            write disk\n"
+		"  -M            read several disks in parallel\n"
+		"  -B            run jobs given in jobfile\n"
+		"  -T            render binary bad sector dump as text\n"
 		"  -v            be more verbose\n"
 		"  -n            do not read rc files\n"
 		"  -f <file>     read additional config file\n"
 		"  -e <config>   evaluate given string as config\n"
 		"  -r <num>      number of retries if errors occur\n"
+		"  -c            resume interrupted read from journal\n"
 		"  -o <file>     output raw data of bad sectors to file\n"
+		"  -O <file>     same as -o, but in binary format\n"
 		"  -s            ignore size\n"
 		"  -h            this help\n",
 		global_version_string(), space1, space1, global_program_name(),
 		global_program_name(), global_program_name(), global_program_name(),
 		global_program_name(), global_program_name(), space2,
-		global_program_name(), space2, space2, global_program_name(),
-		space2);
+		global_program_name(), space2, global_program_name(), space2,
+		space2, global_program_name(), space2, global_program_name(),
+		space2, space2, global_program_name(), space2,
+		global_program_name());
 	exit(0);
 	}
 
@@ -174,12 +190,16 @@ cmdline_check_stdout(
  ****************************************************************************/
 static cw_count_t
 cmdline_min_params(
-	cw_void_t)
+	cw_mode_t			mode)
 
 	{
-	if (cmd.mode == CMDLINE_MODE_READ)       return (3);
-	if (cmd.mode == CMDLINE_MODE_WRITE)      return (3);
-	if (cmd.mode == CMDLINE_MODE_STATISTICS) return (2);
+	if (mode == CMDLINE_MODE_READ)       return (3);
+	if (mode == CMDLINE_MODE_WRITE)      return (3);
+	if (mode == CMDLINE_MODE_STATISTICS) return (2);
+	if (mode == CMDLINE_MODE_MULTI_READ) return (3);
+	if (mode == CMDLINE_MODE_BATCH)      return (1);
+	if (mode == CMDLINE_MODE_RENDER)     return (2);
+	if (mode == CMDLINE_MODE_PROBE)      return (1);
 	return (0);
 	}
 
@@ -190,17 +210,69 @@ cmdline_min_params(
  ****************************************************************************/
 static cw_count_t
 cmdline_max_params(
-	cw_void_t)
+	cw_mode_t			mode)
 
 	{
-	if (cmd.mode == CMDLINE_MODE_READ)       return (GLOBAL_NR_IMAGES);
-	if (cmd.mode == CMDLINE_MODE_WRITE)      return (3);
-	if (cmd.mode == CMDLINE_MODE_STATISTICS) return (2);
+	if (mode == CMDLINE_MODE_READ)       return (GLOBAL_NR_IMAGES);
+	if (mode == CMDLINE_MODE_WRITE)      return (3);
+	if (mode == CMDLINE_MODE_STATISTICS) return (2);
+	if (mode == CMDLINE_MODE_MULTI_READ) return (3 * GLOBAL_NR_JOBS);
+	if (mode == CMDLINE_MODE_BATCH)      return (1);
+	if (mode == CMDLINE_MODE_RENDER)     return (2);
+	if (mode == CMDLINE_MODE_PROBE)      return (GLOBAL_NR_IMAGES);
 	return (0);
 	}
 
 
 
+/****************************************************************************
+ * cmdline_add_job_param
+ ****************************************************************************/
+static cw_void_t
+cmdline_add_job_param(
+	cw_char_t			*arg,
+	cw_count_t			params)
+
+	{
+	struct cmdline_job		*job = &cmd.job[params / 3];
+
+	/*
+	 * parameters for -M are given as triples of disk name, source and
+	 * destination. stdin and stdout may only be used once
+	 */
+
+	if (params % 3 == 0)
+		{
+		*job = (struct cmdline_job) { .disk_name = arg };
+		cmd.jobs++;
+		}
+	else if (params % 3 == 1) job->src = cmdline_check_stdin("<device>", arg);
+	else job->dst = cmdline_check_stdout("<dstfile>", arg);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_next_arg
+ ****************************************************************************/
+static cw_char_t *
+cmdline_next_arg(
+	cw_char_t			**line)
+
+	{
+	cw_char_t			*arg = *line;
+
+	/* split line at spaces and tabs, the line is modified */
+
+	while ((*arg == ' ') || (*arg == '\t') || (*arg == '\n') || (*arg == '\r')) arg++;
+	if (*arg == '\0') return (NULL);
+	for (*line = arg; (**line != '\0') && (**line != ' ') && (**line != '\t') && (**line != '\n') && (**line != '\r'); (*line)++) ;
+	if (**line != '\0') *(*line)++ = '\0';
+	return (arg);
+	}
+
+
+
 /****************************************************************************
  * cmdline_read_rc_files
  ****************************************************************************/
@@ -233,8 +305,11 @@ cmdline_verbose_level(
 	generic_level = verbose_get_level(VERBOSE_CLASS_GENERIC);
 	if ((cmd.mode == CMDLINE_MODE_INITIALIZE) ||
 		(cmd.mode == CMDLINE_MODE_LIST) ||
+		(cmd.mode == CMDLINE_MODE_PROBE) ||
 		(cmd.mode == CMDLINE_MODE_READ) ||
-		(cmd.mode == CMDLINE_MODE_WRITE))
+		(cmd.mode == CMDLINE_MODE_WRITE) ||
+		(cmd.mode == CMDLINE_MODE_MULTI_READ) ||
+		(cmd.mode == CMDLINE_MODE_BATCH))
 		{
 		level = verbose_get_level(VERBOSE_CLASS_CWTOOL_ILRW);
 		if (level < VERBOSE_LEVEL_1) verbose_set_level(VERBOSE_CLASS_CWTOOL_ILRW, level + 1);
@@ -281,8 +356,19 @@ cmdline_parse(
 		if ((arg[0] != '-') || (string_equal(arg, "-")) || (ignore))
 			{
 			if (cmd.mode == CMDLINE_MODE_DEFAULT) goto bad_option;
-			if (params >= cmdline_max_params()) error_message("too many parameters given");
-			if (params >= 1)
+			if (params >= cmdline_max_params(cmd.mode)) error_message("too many parameters given");
+			if (cmd.mode == CMDLINE_MODE_MULTI_READ) cmdline_add_job_param(arg, params);
+			else if (cmd.mode == CMDLINE_MODE_BATCH) cmd.file[cmd.files++] = cmdline_check_stdin("<jobfile>", arg);
+			else if (cmd.mode == CMDLINE_MODE_RENDER) cmd.file[cmd.files++] = (params == 0) ? cmdline_check_stdin("<srcfile>", arg) : arg;
+			else if (cmd.mode == CMDLINE_MODE_PROBE)
+				{
+
+				/* the source is opened once for each capture */
+
+				if ((params == 0) && (string_equal(arg, "-"))) error_message("-P/--probe can not read from stdin");
+				cmd.file[cmd.files++] = arg;
+				}
+			else if (params >= 1)
 				{
 				if (cmd.files > 0) cmdline_check_stdin("<srcfile>", cmd.file[cmd.files - 1]);
 				cmd.file[cmd.files++] = arg;
@@ -318,6 +404,10 @@ cmdline_parse(
 			{
 			cmd.mode = CMDLINE_MODE_STATISTICS;
 			}
+		else if ((string_equal2(arg, "-P", "--probe")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_PROBE;
+			}
 		else if ((string_equal2(arg, "-R", "--read")) && (args == 0))
 			{
 			cmd.mode = CMDLINE_MODE_READ;
@@ -326,6 +416,18 @@ cmdline_parse(
 			{
 			cmd.mode = CMDLINE_MODE_WRITE;
 			}
+		else if ((string_equal2(arg, "-M", "--multi-read")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_MULTI_READ;
+			}
+		else if ((string_equal2(arg, "-B", "--batch")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_BATCH;
+			}
+		else if ((string_equal2(arg, "-T", "--text")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_RENDER;
+			}
 		else if ((cmd.mode == CMDLINE_MODE_DEFAULT) || (cmd.mode == CMDLINE_MODE_VERSION) || (cmd.mode == CMDLINE_MODE_DUMP))
 			{
 			goto bad_option;
@@ -360,19 +462,30 @@ cmdline_parse(
 				.data = cmdline_check_arg("-e/--evaluate", "parameter", *argv++)
 				};
 			}
-		else if ((string_equal2(arg, "-r", "--retry")) && (cmd.mode == CMDLINE_MODE_READ))
+		else if ((string_equal2(arg, "-r", "--retry")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_MULTI_READ) || (cmd.mode == CMDLINE_MODE_BATCH)))
 			{
 			cw_count_t	i = 0;
 
 			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.retry);
 			if ((i != 1) || (cmd.retry < 0) || (cmd.retry > GLOBAL_NR_RETRIES)) error_message("-r/--retry expects a valid number of retries");
 			}
+		else if ((string_equal2(arg, "-c", "--resume")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_MULTI_READ) || (cmd.mode == CMDLINE_MODE_BATCH)))
+			{
+			cmd.flags |= CMDLINE_FLAG_RESUME;
+			}
 		else if ((string_equal2(arg, "-o", "--output")) && (cmd.mode == CMDLINE_MODE_READ))
 			{
-			if (cmd.output != NULL) error_message("-o/--output already specified");
+			if (cmd.output != NULL) error_message("-o/--output or -O/--output-binary already specified");
 			cmd.output = cmdline_check_stdout("-o/--output", *argv++);
 			options_set_output(CW_BOOL_TRUE);
 			}
+		else if ((string_equal2(arg, "-O", "--output-binary")) && (cmd.mode == CMDLINE_MODE_READ))
+			{
+			if (cmd.output != NULL) error_message("-o/--output or -O/--output-binary already specified");
+			cmd.output = cmdline_check_stdout("-O/--output-binary", *argv++);
+			options_set_output(CW_BOOL_TRUE);
+			options_set_output_binary(CW_BOOL_TRUE);
+			}
 		else if ((string_equal2(arg, "-s", "--ignore-size")) && (cmd.mode == CMDLINE_MODE_WRITE))
 			{
 			cmd.flags |= CMDLINE_FLAG_IGNORE_SIZE;
@@ -383,8 +496,12 @@ cmdline_parse(
 			error_message("unrecognized option '%s'", arg);
 			}
 		}
-	if ((params < cmdline_min_params()) || (cmd.mode == CMDLINE_MODE_DEFAULT)) error_message("too few parameters given");
-	if (params >= 2) cmdline_check_stdout("<dstfile>", cmd.file[cmd.files - 1]);
+	if ((params < cmdline_min_params(cmd.mode)) || (cmd.mode == CMDLINE_MODE_DEFAULT)) error_message("too few parameters given");
+	if (cmd.mode == CMDLINE_MODE_MULTI_READ)
+		{
+		if (params % 3 != 0) error_message("-M/--multi-read expects triples of <diskname> <device> <dstfile>");
+		}
+	else if ((params >= 2) && (cmd.mode != CMDLINE_MODE_PROBE)) cmdline_check_stdout("<dstfile>", cmd.file[cmd.files - 1]);
 
 	return (CW_BOOL_OK);
 	}
@@ -496,6 +613,101 @@ cmdline_get_files(
 
 
 
+/****************************************************************************
+ * cmdline_get_job
+ ****************************************************************************/
+struct cmdline_job *
+cmdline_get_job(
+	cw_index_t			index)
+
+	{
+	if ((index < 0) || (index >= cmd.jobs)) return (NULL);
+	return (&cmd.job[index]);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_jobs
+ ****************************************************************************/
+cw_count_t
+cmdline_get_jobs(
+	cw_void_t)
+
+	{
+	return (cmd.jobs);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_parse_batch_job
+ ****************************************************************************/
+cw_bool_t
+cmdline_parse_batch_job(
+	struct cmdline_batch_job	*cmd_bat,
+	cw_char_t			*line)
+
+	{
+	cw_char_t			*arg;
+	cw_bool_t			ignore = CW_BOOL_FALSE;
+	cw_count_t			params = 0;
+
+	/*
+	 * a job line looks like the cmdline of -R, -W or -S, but without
+	 * the options only allowed once per process (-v, -n, -f, -e, -o).
+	 * stdin and stdout are reserved for the jobfile and the status
+	 * lines. errors are reported with error_message(), so with
+	 * cwtool -B only the thread of this job is terminated
+	 */
+
+	*cmd_bat = (struct cmdline_batch_job) { .flags = cmd.flags & CMDLINE_FLAG_RESUME, .retry = cmd.retry };
+	arg = cmdline_next_arg(&line);
+	if (arg == NULL) error_message("empty job");
+	if (string_equal2(arg, "-R", "--read"))            cmd_bat->mode = CMDLINE_MODE_READ;
+	else if (string_equal2(arg, "-W", "--write"))      cmd_bat->mode = CMDLINE_MODE_WRITE;
+	else if (string_equal2(arg, "-S", "--statistics")) cmd_bat->mode = CMDLINE_MODE_STATISTICS;
+	else error_message("job has to start with -R, -W or -S");
+	while ((arg = cmdline_next_arg(&line)) != NULL)
+		{
+		if ((arg[0] != '-') || (string_equal(arg, "-")) || (ignore))
+			{
+			if (string_equal(arg, "-")) error_message("stdin or stdout can not be used in jobs");
+			if (params >= cmdline_max_params(cmd_bat->mode)) error_message("too many parameters given");
+			if (params >= 1) cmd_bat->file[cmd_bat->files++] = arg;
+			else cmd_bat->disk_name = arg;
+			params++;
+			}
+		else if (string_equal(arg, "--"))
+			{
+			ignore = CW_BOOL_TRUE;
+			}
+		else if ((string_equal2(arg, "-r", "--retry")) && (cmd_bat->mode == CMDLINE_MODE_READ))
+			{
+			cw_count_t	i = 0;
+
+			if ((arg = cmdline_next_arg(&line)) != NULL) i = sscanf(arg, "%d", &cmd_bat->retry);
+			if ((i != 1) || (cmd_bat->retry < 0) || (cmd_bat->retry > GLOBAL_NR_RETRIES)) error_message("-r/--retry expects a valid number of retries");
+			}
+		else if ((string_equal2(arg, "-c", "--resume")) && (cmd_bat->mode == CMDLINE_MODE_READ))
+			{
+			cmd_bat->flags |= CMDLINE_FLAG_RESUME;
+			}
+		else if ((string_equal2(arg, "-s", "--ignore-size")) && (cmd_bat->mode == CMDLINE_MODE_WRITE))
+			{
+			cmd_bat->flags |= CMDLINE_FLAG_IGNORE_SIZE;
+			}
+		else
+			{
+			error_message("unrecognized option '%s'", arg);
+			}
+		}
+	if (params < cmdline_min_params(cmd_bat->mode)) error_message("too few parameters given");
+	return (CW_BOOL_OK);
+	}
+
+
+
 /****************************************************************************
  * cmdline_read_config
  ****************************************************************************/
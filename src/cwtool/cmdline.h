@@ -36,6 +36,10 @@
 #define CMDLINE_MODE_STATISTICS		5
 #define CMDLINE_MODE_READ		6
 #define CMDLINE_MODE_WRITE		7
+#define CMDLINE_MODE_MULTI_READ		8
+#define CMDLINE_MODE_BATCH		9
+#define CMDLINE_MODE_RENDER		10
+#define CMDLINE_MODE_PROBE		11
 
 #define CMDLINE_NR_CONFIGS		128
 
@@ -48,8 +52,31 @@ struct cmdline_config
 	char				*data;
 	};
 
+struct cmdline_job
+	{
+	cw_char_t			*disk_name;
+	cw_char_t			*src;
+	cw_char_t			*dst;
+	};
+
+/*
+ * one line of the jobfile given to cwtool -B, the pointers point into
+ * the line passed to cmdline_parse_batch_job()
+ */
+
+struct cmdline_batch_job
+	{
+	cw_mode_t			mode;
+	cw_flag_t			flags;
+	cw_count_t			retry;
+	cw_char_t			*disk_name;
+	cw_char_t			*file[GLOBAL_NR_IMAGES];
+	cw_count_t			files;
+	};
+
 #define CMDLINE_FLAG_NO_RCFILES		(1 << 0)
 #define CMDLINE_FLAG_IGNORE_SIZE	(1 << 1)
+#define CMDLINE_FLAG_RESUME		(1 << 2)
 
 struct cmdline
 	{
@@ -60,6 +87,8 @@ struct cmdline
 	cw_char_t			*file[GLOBAL_NR_IMAGES];
 	cw_count_t			files;
 	cw_char_t			*output;
+	struct cmdline_job		job[GLOBAL_NR_JOBS];
+	cw_count_t			jobs;
 	struct cmdline_config		cfg[CMDLINE_NR_CONFIGS];
 	cw_count_t			configs;
 	};
@@ -112,6 +141,19 @@ extern cw_count_t
 cmdline_get_files(
 	cw_void_t);
 
+extern struct cmdline_job *
+cmdline_get_job(
+	cw_index_t			index);
+
+extern cw_count_t
+cmdline_get_jobs(
+	cw_void_t);
+
+extern cw_bool_t
+cmdline_parse_batch_job(
+	struct cmdline_batch_job	*cmd_bat,
+	cw_char_t			*line);
+
 extern cw_bool_t
 cmdline_read_config(
 	cw_void_t);
@@ -324,6 +324,21 @@ config_disk_timeout_read(
 
 
 
+/****************************************************************************
+ * config_disk_revolutions
+ ****************************************************************************/
+static cw_bool_t
+config_disk_revolutions(
+	struct config			*cfg,
+	struct disk_track		*dsk_trk)
+
+	{
+	if (! disk_set_revolutions(dsk_trk, config_number(cfg, NULL, 0))) config_error(cfg, "invalid revolutions value");
+	return (CW_BOOL_OK);
+	}
+
+
+
 /****************************************************************************
  * config_disk_timeout_write
  ****************************************************************************/
@@ -699,6 +714,7 @@ config_disk_directive(
 	if (scope & SCOPE_READ)
 		{
 		if (string_equal(token, "timeout"))        return (config_disk_timeout_read(cfg, dsk_trk));
+		if (string_equal(token, "revolutions"))    return (config_disk_revolutions(cfg, dsk_trk));
 		if (string_equal(token, "indexed"))        return (config_disk_indexed_read(cfg, dsk_trk));
 		if (disk_get_format(dsk_trk) == NULL)      config_disk_error_format(cfg);
 		if (config_disk_read(cfg, dsk_trk, token)) return (CW_BOOL_OK);
@@ -209,6 +209,212 @@ config_options_track_size_limit(
 
 
 
+/****************************************************************************
+ * config_options_decode_threads
+ ****************************************************************************/
+static cw_bool_t
+config_options_decode_threads(
+	struct config			*cfg)
+
+	{
+	if (! options_set_decode_threads(config_number(cfg, NULL, 0))) config_error(cfg, "invalid decode_threads value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_exhaustive_read
+ ****************************************************************************/
+static cw_bool_t
+config_options_exhaustive_read(
+	struct config			*cfg)
+
+	{
+	if (! options_set_exhaustive_read(config_boolean(cfg, NULL, 0))) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_seek_optimize
+ ****************************************************************************/
+static cw_bool_t
+config_options_seek_optimize(
+	struct config			*cfg)
+
+	{
+	if (! options_set_seek_optimize(config_number(cfg, NULL, 0))) config_error(cfg, "invalid seek_optimize value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_cache_size
+ ****************************************************************************/
+static cw_bool_t
+config_options_cache_size(
+	struct config			*cfg)
+
+	{
+	if (! options_set_cache_size(config_number(cfg, NULL, 0))) config_error(cfg, "invalid cache_size value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_cache_verify
+ ****************************************************************************/
+static cw_bool_t
+config_options_cache_verify(
+	struct config			*cfg)
+
+	{
+	if (! options_set_cache_verify(config_boolean(cfg, NULL, 0))) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_cache_path
+ ****************************************************************************/
+static cw_bool_t
+config_options_cache_path(
+	struct config			*cfg)
+
+	{
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+
+	config_path(cfg, "cache path expected", path, sizeof (path));
+	if (! options_set_cache_path(path)) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_batch_jobs
+ ****************************************************************************/
+static cw_bool_t
+config_options_batch_jobs(
+	struct config			*cfg)
+
+	{
+	if (! options_set_batch_jobs(config_number(cfg, NULL, 0))) config_error(cfg, "invalid batch_jobs value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_statistics_format
+ ****************************************************************************/
+static cw_bool_t
+config_options_statistics_format(
+	struct config			*cfg)
+
+	{
+	cw_char_t			name[GLOBAL_MAX_NAME_SIZE];
+	cw_mode_t			mode = OPTIONS_STATISTICS_FORMAT_TEXT;
+
+	config_name(cfg, "statistics format expected", name, sizeof (name));
+	if (string_equal(name, "csv"))       mode = OPTIONS_STATISTICS_FORMAT_CSV;
+	else if (string_equal(name, "json")) mode = OPTIONS_STATISTICS_FORMAT_JSON;
+	else if (! string_equal(name, "text")) config_error(cfg, "invalid statistics_format value");
+	if (! options_set_statistics_format(mode)) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_raw_buffer_size
+ ****************************************************************************/
+static cw_bool_t
+config_options_raw_buffer_size(
+	struct config			*cfg)
+
+	{
+	if (! options_set_raw_buffer_size(config_number(cfg, NULL, 0))) config_error(cfg, "invalid raw_buffer_size value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_encode_threads
+ ****************************************************************************/
+static cw_bool_t
+config_options_encode_threads(
+	struct config			*cfg)
+
+	{
+	if (! options_set_encode_threads(config_number(cfg, NULL, 0))) config_error(cfg, "invalid encode_threads value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_write_verify
+ ****************************************************************************/
+static cw_bool_t
+config_options_write_verify(
+	struct config			*cfg)
+
+	{
+	if (! options_set_write_verify(config_boolean(cfg, NULL, 0))) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_write_verify_retry
+ ****************************************************************************/
+static cw_bool_t
+config_options_write_verify_retry(
+	struct config			*cfg)
+
+	{
+	if (! options_set_write_verify_retry(config_number(cfg, NULL, 0))) config_error(cfg, "invalid write_verify_retry value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_bounds_calibrate
+ ****************************************************************************/
+static cw_bool_t
+config_options_bounds_calibrate(
+	struct config			*cfg)
+
+	{
+	if (! options_set_bounds_calibrate(config_boolean(cfg, NULL, 0))) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_options_split_revolutions
+ ****************************************************************************/
+static cw_bool_t
+config_options_split_revolutions(
+	struct config			*cfg)
+
+	{
+	if (! options_set_split_revolutions(config_boolean(cfg, NULL, 0))) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
 /****************************************************************************
  * config_options_directive
  ****************************************************************************/
@@ -238,6 +444,20 @@ config_options_directive(
 		if (string_equal(token, "output_track_start"))    return (config_options_output_track_start(cfg));
 		if (string_equal(token, "output_track_end"))      return (config_options_output_track_end(cfg));
 		if (string_equal(token, "track_size_limit"))      return (config_options_track_size_limit(cfg));
+		if (string_equal(token, "decode_threads"))        return (config_options_decode_threads(cfg));
+		if (string_equal(token, "exhaustive_read"))       return (config_options_exhaustive_read(cfg));
+		if (string_equal(token, "seek_optimize"))         return (config_options_seek_optimize(cfg));
+		if (string_equal(token, "cache_size"))            return (config_options_cache_size(cfg));
+		if (string_equal(token, "cache_verify"))          return (config_options_cache_verify(cfg));
+		if (string_equal(token, "cache_path"))            return (config_options_cache_path(cfg));
+		if (string_equal(token, "batch_jobs"))            return (config_options_batch_jobs(cfg));
+		if (string_equal(token, "statistics_format"))     return (config_options_statistics_format(cfg));
+		if (string_equal(token, "raw_buffer_size"))       return (config_options_raw_buffer_size(cfg));
+		if (string_equal(token, "encode_threads"))        return (config_options_encode_threads(cfg));
+		if (string_equal(token, "write_verify"))          return (config_options_write_verify(cfg));
+		if (string_equal(token, "write_verify_retry"))    return (config_options_write_verify_retry(cfg));
+		if (string_equal(token, "bounds_calibrate"))      return (config_options_bounds_calibrate(cfg));
+		if (string_equal(token, "split_revolutions"))     return (config_options_split_revolutions(cfg));
 		}
 	config_error_invalid(cfg, token);
 
@@ -35,7 +35,9 @@
 
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
@@ -53,10 +55,84 @@
 #include "drive.h"
 #include "file.h"
 #include "string.h"
+#include "pool.h"
+#include "dump.h"
+#include "statistics.h"
 
 
 
+/*
+ * the track buffers come from scratch_alloc(), but disk_read() and
+ * disk_write() still keep some hundred kilobytes on the stack
+ */
+
+#define CWTOOL_THREAD_STACK_SIZE	(2 * 1024 * 1024)
+
+/*
+ * each job gets its own copy of the disk, jobs may read with the same
+ * disk name at the same time and disk_read() keeps per track state in
+ * struct disk
+ */
+
+struct cwtool_job
+	{
+	pthread_t			thread;
+	struct cmdline_job		*cmd_job;
+	struct disk			dsk;
+	struct disk_option		dsk_opt;
+	cw_bool_t			done;
+	};
+
+struct cwtool_thread
+	{
+	pthread_t			thread;
+	pthread_attr_t			*attr;
+	int				controller;
+	struct cwtool_job		*job[GLOBAL_NR_JOBS];
+	int				jobs;
+	};
+
+/*
+ * cwtool -B runs the jobs on up to batch_jobs worker threads, a worker
+ * takes one job after the other and keeps its scratch buffers between
+ * them. an error only terminates the worker running the job, another
+ * worker is started in its place. jobs accessing the same controller or
+ * printing statistics wait until the other one is done
+ */
+
+#define CWTOOL_BATCH_LINE_SIZE		4096
+
+struct cwtool_batch_job
+	{
+	struct cmdline_batch_job	cmd_bat;
+	struct disk			dsk;
+	struct disk_summary		sum;
+	struct pool			*pol;
+	int				slot;
+	int				line_number;
+	int				controllers;
+	cw_bool_t			statistics;
+	cw_bool_t			done;
+	char				line[CWTOOL_BATCH_LINE_SIZE];
+	};
+
+struct cwtool_batch_worker
+	{
+	int				slot;
+	cw_bool_t			running;
+	};
+
 static int				exit_code = 0;
+static pthread_mutex_t			info_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t			batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t			batch_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t			batch_controller_mutex[CW_NR_CONTROLLERS];
+static pthread_mutex_t			batch_statistics_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct cwtool_batch_worker	batch_worker[GLOBAL_NR_THREADS];
+static struct cwtool_batch_job		*batch_job[GLOBAL_NR_THREADS];
+static struct cwtool_batch_job		*batch_pending;
+static cw_bool_t			batch_eof;
+static int				batch_workers;
 
 
 
@@ -87,12 +163,12 @@ cwtool_get_line(
  ****************************************************************************/
 static struct disk *
 cwtool_get_disk(
-	void)
+	const char			*name)
 
 	{
-	struct disk			*dsk = disk_search(cmdline_get_disk_name());
+	struct disk			*dsk = disk_search(name);
 
-	if (dsk == NULL) error_message("unknown disk name '%s'", cmdline_get_disk_name());
+	if (dsk == NULL) error_message("unknown disk name '%s'", name);
 	return (dsk);
 	}
 
@@ -160,28 +236,22 @@ cwtool_info_error_details(
 
 
 /****************************************************************************
- * cwtool_info_print
+ * cwtool_info_line
  ****************************************************************************/
-static void
-cwtool_info_print(
+static char *
+cwtool_info_line(
+	char				*line,
+	int				size,
 	struct disk_info		*dsk_nfo,
+	cw_mode_t			mode,
 	int				summary)
 
 	{
-	char				line[1024], path[16];
+	char				path[16];
 	int				selector = 0;
+	int				l = 0;
 
-	/* if there are bad sectors change exit code of cwtool to non zero */
-
-	if (dsk_nfo->sum.sectors_bad > 0) exit_code = 1;
-
-	/* return if verbosity is not high enough */
-
-	if (verbose_get_level(VERBOSE_CLASS_CWTOOL_ILRW) == VERBOSE_LEVEL_NONE) return;
-
-	/* construct line to be printed out */
-
-	if (cmdline_get_mode() == CMDLINE_MODE_WRITE) selector += 4;
+	if (mode == CMDLINE_MODE_WRITE) selector += 4;
 	if (summary)
 		{
 		selector += 2;
@@ -189,28 +259,122 @@ cwtool_info_print(
 		}
 	else if (dsk_nfo->sectors_good + dsk_nfo->sectors_weak + dsk_nfo->sectors_bad > 0) selector++;
 
-	if (selector == 0) string_snprintf(line, sizeof (line), "reading track %3d try %2d (sectors: none) (%s)",
+	if (selector == 0) string_snprintf(line, size, "reading track %3d try %2d (sectors: none) (%s)",
 		dsk_nfo->track, dsk_nfo->try, string_dot(path, sizeof (path), dsk_nfo->path));
-	if (selector == 1) string_snprintf(line, sizeof (line), "reading track %3d try %2d (sectors: good %2d weak %2d bad %2d) (%s)",
+	if (selector == 1) string_snprintf(line, size, "reading track %3d try %2d (sectors: good %2d weak %2d bad %2d) (%s)",
 		dsk_nfo->track, dsk_nfo->try, dsk_nfo->sectors_good,
 		dsk_nfo->sectors_weak, dsk_nfo->sectors_bad,
 		string_dot(path, sizeof (path), dsk_nfo->path));
-	if (selector == 2) string_snprintf(line, sizeof (line), "%3d tracks read",
+	if (selector == 2) l = string_snprintf(line, size, "%3d tracks read",
 		dsk_nfo->sum.tracks);
-	if (selector == 3) string_snprintf(line, sizeof (line), "%3d tracks read (sectors: good %4d weak %4d bad %4d)",
+	if (selector == 3) l = string_snprintf(line, size, "%3d tracks read (sectors: good %4d weak %4d bad %4d)",
 		dsk_nfo->sum.tracks, dsk_nfo->sum.sectors_good,
 		dsk_nfo->sum.sectors_weak, dsk_nfo->sum.sectors_bad);
-	if (selector == 4) string_snprintf(line, sizeof (line), "writing track %3d (sectors: none)",
+	if (selector == 4) string_snprintf(line, size, "writing track %3d (sectors: none)",
 		dsk_nfo->track);
-	if (selector == 5) string_snprintf(line, sizeof (line), "writing track %3d (sectors: %2d)",
+	if (selector == 5) string_snprintf(line, size, "writing track %3d (sectors: %2d)",
 		dsk_nfo->track, dsk_nfo->sectors_good);
-	if (selector == 6) string_snprintf(line, sizeof (line), "%3d tracks written",
+	if (selector == 6) l = string_snprintf(line, size, "%3d tracks written",
 		dsk_nfo->sum.tracks);
-	if (selector == 7) string_snprintf(line, sizeof (line), "%3d tracks written (sectors: %4d)",
+	if (selector == 7) l = string_snprintf(line, size, "%3d tracks written (sectors: %4d)",
 		dsk_nfo->sum.tracks, dsk_nfo->sum.sectors_good);
 
-	verbose_message(CWTOOL_ILRW, 1, "%s", line);
+	/*
+	 * tracks are only verified with write_verify, failed counts each
+	 * unsuccessful verification (including the ones fixed by writing
+	 * the track again)
+	 */
+
+	if ((summary) && (dsk_nfo->sum.verified > 0)) l += string_snprintf(&line[l], size - l, " (verified %d, failed %d, bad sectors %d)",
+		dsk_nfo->sum.verified, dsk_nfo->sum.verify_failed, dsk_nfo->sum.sectors_bad);
+
+	/* steps are only counted if a device was accessed */
+
+	if ((summary) && (dsk_nfo->sum.steps >= 0)) string_snprintf(&line[l], size - l, " (head steps %d, %d.%03d s)",
+		dsk_nfo->sum.steps, dsk_nfo->sum.milliseconds / 1000, dsk_nfo->sum.milliseconds % 1000);
+	return (line);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_info_print
+ ****************************************************************************/
+static void
+cwtool_info_print(
+	struct disk_info		*dsk_nfo,
+	int				summary)
+
+	{
+	char				line[1024];
+
+	/* if there are bad sectors change exit code of cwtool to non zero */
+
+	if (dsk_nfo->sum.sectors_bad > 0) exit_code = 1;
+
+	/* return if verbosity is not high enough */
+
+	if (verbose_get_level(VERBOSE_CLASS_CWTOOL_ILRW) == VERBOSE_LEVEL_NONE) return;
+
+	/* construct line to be printed out */
+
+	verbose_message(CWTOOL_ILRW, 1, "%s", cwtool_info_line(line, sizeof (line), dsk_nfo, cmdline_get_mode(), summary));
+	if ((summary) && (dsk_nfo->sum.sectors_bad > 0)) cwtool_info_error_details(dsk_nfo);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_multi_info_print
+ ****************************************************************************/
+static void
+cwtool_multi_info_print(
+	struct disk_info		*dsk_nfo,
+	int				summary)
+
+	{
+	struct cmdline_job		*cmd_job = cmdline_get_job(dsk_nfo->job);
+	char				line[1024];
+
+	/*
+	 * this function is called from several threads, so serialize
+	 * updating exit_code and keep the lines of one job together
+	 */
+
+	pthread_mutex_lock(&info_mutex);
+	if (dsk_nfo->sum.sectors_bad > 0) exit_code = 1;
+	if (verbose_get_level(VERBOSE_CLASS_CWTOOL_ILRW) == VERBOSE_LEVEL_NONE) goto done;
+	verbose_message(CWTOOL_ILRW, 1, "job %2d %s: %s", dsk_nfo->job + 1, cmd_job->disk_name, cwtool_info_line(line, sizeof (line), dsk_nfo, cmdline_get_mode(), summary));
 	if ((summary) && (dsk_nfo->sum.sectors_bad > 0)) cwtool_info_error_details(dsk_nfo);
+done:
+	pthread_mutex_unlock(&info_mutex);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch_info_print
+ ****************************************************************************/
+static void
+cwtool_batch_info_print(
+	struct disk_info		*dsk_nfo,
+	int				summary)
+
+	{
+	struct cwtool_batch_job		*bat_job;
+	char				line[1024];
+
+	/* the summary is remembered for the status line of the job */
+
+	pthread_mutex_lock(&batch_mutex);
+	bat_job = batch_job[dsk_nfo->job];
+	pthread_mutex_unlock(&batch_mutex);
+	if (summary) bat_job->sum = dsk_nfo->sum;
+	if (verbose_get_level(VERBOSE_CLASS_CWTOOL_ILRW) == VERBOSE_LEVEL_NONE) return;
+	pthread_mutex_lock(&info_mutex);
+	verbose_message(CWTOOL_ILRW, 1, "line %3d %s: %s", bat_job->line_number, bat_job->cmd_bat.disk_name, cwtool_info_line(line, sizeof (line), dsk_nfo, bat_job->cmd_bat.mode, summary));
+	if ((summary) && (dsk_nfo->sum.sectors_bad > 0)) cwtool_info_error_details(dsk_nfo);
+	pthread_mutex_unlock(&info_mutex);
 	}
 
 
@@ -288,13 +452,96 @@ cwtool_statistics(
 	struct disk			*dsk;
 
 	cmdline_read_config();
-	dsk = cwtool_get_disk();
+	dsk = cwtool_get_disk(cmdline_get_disk_name());
 	setlinebuf(stdout);
 	disk_statistics(dsk, cmdline_get_file(0));
 	}
 
 
 
+/****************************************************************************
+ * cwtool_probe_compare
+ ****************************************************************************/
+static int
+cwtool_probe_compare(
+	const void			*probe1,
+	const void			*probe2)
+
+	{
+	const struct disk_probe		*dsk_prb1 = probe1;
+	const struct disk_probe		*dsk_prb2 = probe2;
+
+	/* best score first, then more good sectors, then config order */
+
+	if (dsk_prb1->score != dsk_prb2->score) return (dsk_prb2->score - dsk_prb1->score);
+	if (dsk_prb1->sectors_good != dsk_prb2->sectors_good) return (dsk_prb2->sectors_good - dsk_prb1->sectors_good);
+	return (dsk_prb1->index - dsk_prb2->index);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_probe
+ ****************************************************************************/
+static void
+cwtool_probe(
+	void)
+
+	{
+	struct disk_probe		dsk_prb[GLOBAL_NR_DISKS];
+	struct statistics		stt;
+	struct statistics_track		*stt_trk;
+	struct disk			*dsk;
+	char				line[1024];
+	int				disks = 0, matches = 0;
+	int				i, j, l;
+
+	cmdline_read_config();
+	if (options_get_always_initialize()) drive_init_all_devices();
+
+	/* without disk names given, all available disks are probed */
+
+	for (i = 1; i < cmdline_get_files(); i++) dsk_prb[disks] = (struct disk_probe) { .dsk = cwtool_get_disk(cmdline_get_file(i)), .index = disks }, disks++;
+	if (disks == 0) for (i = 0; (dsk = disk_get(i)) != NULL; i++) dsk_prb[disks] = (struct disk_probe) { .dsk = dsk, .index = disks }, disks++;
+	statistics_init(&stt, DISK_PROBE_NR_CAPTURES);
+	disk_probe(dsk_prb, disks, cmdline_get_file(0), &stt);
+	statistics_calculate(&stt, options_get_decode_threads());
+	qsort(dsk_prb, disks, sizeof (struct disk_probe), cwtool_probe_compare);
+
+	/* peaks of the pulse histogram of each captured track */
+
+	for (i = 0; i < stt.tracks; i++)
+		{
+		stt_trk = &stt.stt_trk[i];
+		l = string_snprintf(line, sizeof (line), "track %3d clock %d: %6d pulses, %s", stt_trk->cwtool_track, stt_trk->clock, stt_trk->pulses, (stt_trk->peaks > 0) ? "peaks at" : "no peaks");
+		for (j = 0; j < stt_trk->peaks; j++) l += string_snprintf(&line[l], sizeof (line) - l, " %d.%02d", stt_trk->pek[j].position / 100, stt_trk->pek[j].position % 100);
+		printf("%s\n", line);
+		}
+	statistics_deinit(&stt);
+
+	/*
+	 * disks without any sector found are only printed with -v, disks
+	 * without tracks to decode are never printed
+	 */
+
+	for (i = 0; i < disks; i++)
+		{
+		if (dsk_prb[i].tracks == 0) continue;
+		if ((dsk_prb[i].sectors_found == 0) && (verbose_get_level(VERBOSE_CLASS_CWTOOL_ILRW) == VERBOSE_LEVEL_NONE)) continue;
+		if (matches++ == 0) printf("Disk names by match quality:\n");
+		printf("%3d.%d%% %-16s (tracks %d, sectors: good %3d found %3d of %3d)\n",
+			dsk_prb[i].score / 10, dsk_prb[i].score % 10, disk_get_name(dsk_prb[i].dsk),
+			dsk_prb[i].tracks, dsk_prb[i].sectors_good, dsk_prb[i].sectors_found, dsk_prb[i].sectors);
+		}
+	if ((disks == 0) || (dsk_prb[0].sectors_found == 0))
+		{
+		printf("No disk name matches\n");
+		exit_code = 1;
+		}
+	}
+
+
+
 /****************************************************************************
  * cwtool_read
  ****************************************************************************/
@@ -304,12 +551,13 @@ cwtool_read(
 
 	{
 	struct disk			*dsk;
-	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), DISK_OPTION_FLAG_NONE);
+	cw_flag_t			flags = (cmdline_get_flag(CMDLINE_FLAG_RESUME)) ? DISK_OPTION_FLAG_RESUME : DISK_OPTION_FLAG_NONE;
+	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), flags);
 	cw_count_t			files = cmdline_get_files();
 
 	cmdline_read_config();
 	if (options_get_always_initialize()) drive_init_all_devices();
-	dsk = cwtool_get_disk();
+	dsk = cwtool_get_disk(cmdline_get_disk_name());
 	disk_read(dsk, &dsk_opt, cmdline_get_all_files(), files - 1, cmdline_get_file(files - 1), cmdline_get_output());
 	}
 
@@ -329,12 +577,466 @@ cwtool_write(
 
 	cmdline_read_config();
 	if (options_get_always_initialize()) drive_init_all_devices();
-	dsk = cwtool_get_disk();
+	dsk = cwtool_get_disk(cmdline_get_disk_name());
 	disk_write(dsk, &dsk_opt, cmdline_get_file(0), cmdline_get_file(1));
 	}
 
 
 
+/****************************************************************************
+ * cwtool_multi_read_done
+ ****************************************************************************/
+static void
+cwtool_multi_read_done(
+	void				*arg)
+
+	{
+	struct cwtool_job		*job = (struct cwtool_job *) arg;
+
+	/* files left open by an aborted job are closed here */
+
+	file_close_all();
+	if (job->done) return;
+	pthread_mutex_lock(&info_mutex);
+	exit_code = 1;
+	verbose_message(CWTOOL_ILRW, 1, "job %2d %s: failed", job->dsk_opt.job + 1, job->cmd_job->disk_name);
+	pthread_mutex_unlock(&info_mutex);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_multi_read_job
+ ****************************************************************************/
+static void *
+cwtool_multi_read_job(
+	void				*arg)
+
+	{
+	struct cwtool_job		*job = (struct cwtool_job *) arg;
+
+	/*
+	 * like with cwtool -B an error only terminates the thread of this
+	 * job, the other jobs go on
+	 */
+
+	error_set_thread_exit(CW_BOOL_TRUE);
+	pthread_cleanup_push(cwtool_multi_read_done, job);
+	disk_read(&job->dsk, &job->dsk_opt, &job->cmd_job->src, 1, job->cmd_job->dst, NULL);
+	job->done = CW_BOOL_TRUE;
+	pthread_cleanup_pop(1);
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_multi_read_thread
+ ****************************************************************************/
+static void *
+cwtool_multi_read_thread(
+	void				*arg)
+
+	{
+	struct cwtool_thread		*thr = (struct cwtool_thread *) arg;
+	struct cwtool_job		*job;
+	int				i;
+
+	/*
+	 * all jobs of one controller are done one after another, because
+	 * the driver allows only one floppy per controller to be
+	 * accessed at a time. each job gets its own thread, so a failing
+	 * job does not take the remaining ones with it
+	 */
+
+	for (i = 0; i < thr->jobs; i++)
+		{
+		job = thr->job[i];
+		if (pthread_create(&job->thread, thr->attr, cwtool_multi_read_job, job) != 0) error_message("error while creating thread");
+		pthread_join(job->thread, NULL);
+		}
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_multi_read
+ ****************************************************************************/
+static void
+cwtool_multi_read(
+	void)
+
+	{
+	static struct cwtool_job	job[GLOBAL_NR_JOBS];
+	static struct cwtool_thread	thr[GLOBAL_NR_JOBS];
+	struct pool			pol;
+	pthread_attr_t			attr;
+	cw_flag_t			flags = (cmdline_get_flag(CMDLINE_FLAG_RESUME)) ? DISK_OPTION_FLAG_RESUME : DISK_OPTION_FLAG_NONE;
+	cw_count_t			jobs = cmdline_get_jobs();
+	int				c, i, t, threads = 0;
+
+	cmdline_read_config();
+	if (options_get_always_initialize()) drive_init_all_devices();
+	pool_init(&pol, options_get_decode_threads());
+
+	/*
+	 * sort jobs into threads, one thread for each catweasel controller.
+	 * jobs reading from files or pipes get their own thread
+	 */
+
+	for (i = 0; i < jobs; i++)
+		{
+		job[i] = (struct cwtool_job)
+			{
+			.cmd_job = cmdline_get_job(i),
+			.dsk_opt = DISK_OPTION_INIT(cwtool_multi_info_print, cmdline_get_retry(), flags)
+			};
+		job[i].dsk             = *cwtool_get_disk(job[i].cmd_job->disk_name);
+		job[i].dsk_opt.job     = i;
+		job[i].dsk_opt.pol     = &pol;
+		c = drive_get_controller(job[i].cmd_job->src);
+		for (t = 0; t < threads; t++) if ((c != -1) && (thr[t].controller == c)) break;
+		if (t == threads) thr[threads++] = (struct cwtool_thread) { .attr = &attr, .controller = c };
+		thr[t].job[thr[t].jobs++] = &job[i];
+		}
+	verbose_message(GENERIC, 1, "reading %d disks with %d threads", jobs, threads);
+
+	/* start threads and wait until all are done */
+
+	if (pthread_attr_init(&attr) != 0) error_message("error while initializing thread attributes");
+	if (pthread_attr_setstacksize(&attr, CWTOOL_THREAD_STACK_SIZE) != 0) error_message("error while setting thread stack size");
+	for (t = 0; t < threads; t++) if (pthread_create(&thr[t].thread, &attr, cwtool_multi_read_thread, &thr[t]) != 0) error_message("error while creating thread");
+	for (t = 0; t < threads; t++) pthread_join(thr[t].thread, NULL);
+	pthread_attr_destroy(&attr);
+	pool_deinit(&pol);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch_lock
+ ****************************************************************************/
+static void
+cwtool_batch_lock(
+	struct cwtool_batch_job		*bat_job)
+
+	{
+	struct cmdline_batch_job	*cmd_bat = &bat_job->cmd_bat;
+	int				controllers = 0;
+	int				c, i;
+
+	/*
+	 * collect the controllers of all devices used by this job. the
+	 * mutexes are always locked in the same order, so jobs can not
+	 * block each other forever
+	 */
+
+	for (i = 0; i < cmd_bat->files; i++)
+		{
+		if ((cmd_bat->mode == CMDLINE_MODE_READ) && (i == cmd_bat->files - 1)) continue;
+		if ((cmd_bat->mode == CMDLINE_MODE_WRITE) && (i == 0)) continue;
+		c = drive_get_controller(cmd_bat->file[i]);
+		if (c != -1) controllers |= 1 << c;
+		}
+	for (c = 0; c < CW_NR_CONTROLLERS; c++)
+		{
+		if (! (controllers & (1 << c))) continue;
+		pthread_mutex_lock(&batch_controller_mutex[c]);
+		bat_job->controllers |= 1 << c;
+		}
+	if (cmd_bat->mode != CMDLINE_MODE_STATISTICS) return;
+	pthread_mutex_lock(&batch_statistics_mutex);
+	bat_job->statistics = CW_BOOL_TRUE;
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch_done
+ ****************************************************************************/
+static void
+cwtool_batch_done(
+	void				*arg)
+
+	{
+	struct cwtool_batch_job		*bat_job = (struct cwtool_batch_job *) arg;
+	struct disk_summary		*sum = &bat_job->sum;
+	const char			*status = "ok";
+	const char			*message = error_get_last();
+	int				c;
+
+	/*
+	 * called when the job ends, regardless if the job was completed or
+	 * terminated by an error. so files left open by an aborted job are
+	 * closed here
+	 */
+
+	file_close_all();
+	if (bat_job->statistics) pthread_mutex_unlock(&batch_statistics_mutex);
+	for (c = 0; c < CW_NR_CONTROLLERS; c++) if (bat_job->controllers & (1 << c)) pthread_mutex_unlock(&batch_controller_mutex[c]);
+
+	/* print status line of this job */
+
+	if (! bat_job->done) status = "failed";
+	else if (sum->sectors_bad > 0) status = "bad";
+	pthread_mutex_lock(&info_mutex);
+	if (! string_equal(status, "ok")) exit_code = 1;
+	printf("line %d %s tracks %d good %d weak %d bad %d%s%s\n", bat_job->line_number, status,
+		sum->tracks, sum->sectors_good, sum->sectors_weak, sum->sectors_bad,
+		(bat_job->done) ? "" : " error ", (bat_job->done) ? "" : message);
+	pthread_mutex_unlock(&info_mutex);
+
+	/* free slot, an aborted job also terminates its worker */
+
+	pthread_mutex_lock(&batch_mutex);
+	batch_job[bat_job->slot] = NULL;
+	if (! bat_job->done)
+		{
+		batch_worker[bat_job->slot].running = CW_BOOL_FALSE;
+		batch_workers--;
+		}
+	pthread_cond_broadcast(&batch_cond);
+	pthread_mutex_unlock(&batch_mutex);
+	free(bat_job);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch_run
+ ****************************************************************************/
+static void
+cwtool_batch_run(
+	struct cwtool_batch_job		*bat_job)
+
+	{
+	struct cmdline_batch_job	*cmd_bat = &bat_job->cmd_bat;
+	struct disk			*dsk;
+	struct disk_option		dsk_opt;
+	cw_flag_t			flags = DISK_OPTION_FLAG_NONE;
+
+	/*
+	 * errors in this job only terminate this worker thread,
+	 * cwtool_batch_done() is called in any case
+	 */
+
+	error_set_thread_exit(CW_BOOL_TRUE);
+	pthread_cleanup_push(cwtool_batch_done, bat_job);
+	cmdline_parse_batch_job(cmd_bat, bat_job->line);
+	bat_job->dsk = *cwtool_get_disk(cmd_bat->disk_name);
+	dsk = &bat_job->dsk;
+	if (cmd_bat->flags & CMDLINE_FLAG_IGNORE_SIZE) flags |= DISK_OPTION_FLAG_IGNORE_SIZE;
+	if (cmd_bat->flags & CMDLINE_FLAG_RESUME) flags |= DISK_OPTION_FLAG_RESUME;
+	dsk_opt     = DISK_OPTION_INIT(cwtool_batch_info_print, cmd_bat->retry, flags);
+	dsk_opt.job = bat_job->slot;
+	dsk_opt.pol = bat_job->pol;
+	cwtool_batch_lock(bat_job);
+	if (cmd_bat->mode == CMDLINE_MODE_READ) disk_read(dsk, &dsk_opt, cmd_bat->file, cmd_bat->files - 1, cmd_bat->file[cmd_bat->files - 1], NULL);
+	else if (cmd_bat->mode == CMDLINE_MODE_WRITE) disk_write(dsk, &dsk_opt, cmd_bat->file[0], cmd_bat->file[1]);
+	else disk_statistics(dsk, cmd_bat->file[0]);
+	bat_job->done = CW_BOOL_TRUE;
+	pthread_cleanup_pop(1);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch_worker
+ ****************************************************************************/
+static void *
+cwtool_batch_worker(
+	void				*arg)
+
+	{
+	struct cwtool_batch_worker	*bat_wrk = (struct cwtool_batch_worker *) arg;
+	struct cwtool_batch_job		*bat_job;
+
+	/* take the pending job until the end of the jobfile is reached */
+
+	while (1)
+		{
+		pthread_mutex_lock(&batch_mutex);
+		while ((batch_pending == NULL) && (! batch_eof)) pthread_cond_wait(&batch_cond, &batch_mutex);
+		bat_job       = batch_pending;
+		batch_pending = NULL;
+		if (bat_job != NULL)
+			{
+			bat_job->slot            = bat_wrk->slot;
+			batch_job[bat_wrk->slot] = bat_job;
+			}
+		pthread_cond_broadcast(&batch_cond);
+		pthread_mutex_unlock(&batch_mutex);
+		if (bat_job == NULL) break;
+		cwtool_batch_run(bat_job);
+		}
+	pthread_mutex_lock(&batch_mutex);
+	bat_wrk->running = CW_BOOL_FALSE;
+	batch_workers--;
+	pthread_cond_broadcast(&batch_cond);
+	pthread_mutex_unlock(&batch_mutex);
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch_start_workers
+ ****************************************************************************/
+static void
+cwtool_batch_start_workers(
+	pthread_attr_t			*attr,
+	int				jobs)
+
+	{
+	pthread_t			thread;
+	int				s;
+
+	/*
+	 * called with batch_mutex locked, starts the workers not yet
+	 * running or terminated by an error
+	 */
+
+	for (s = 0; s < jobs; s++)
+		{
+		if (batch_worker[s].running) continue;
+		batch_worker[s] = (struct cwtool_batch_worker) { .slot = s, .running = CW_BOOL_TRUE };
+		if (pthread_create(&thread, attr, cwtool_batch_worker, &batch_worker[s]) != 0) error_message("error while creating thread");
+		batch_workers++;
+		}
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch_line_empty
+ ****************************************************************************/
+static int
+cwtool_batch_line_empty(
+	const char			*line)
+
+	{
+	while ((*line == ' ') || (*line == '\t') || (*line == '\r')) line++;
+	if ((*line == '\0') || (*line == '\n') || (*line == '#')) return (1);
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch
+ ****************************************************************************/
+static void
+cwtool_batch(
+	void)
+
+	{
+	struct cwtool_batch_job		*bat_job;
+	struct pool			pol;
+	pthread_attr_t			attr;
+	FILE				*fp = stdin;
+	char				*path = cmdline_get_file(0);
+	int				jobs, line_number, l, s;
+
+	/*
+	 * config is only read once and the disk table is shared by all
+	 * jobs, also the pool limiting the number of tracks decoded at the
+	 * same time
+	 */
+
+	cmdline_read_config();
+	if (options_get_always_initialize()) drive_init_all_devices();
+	pool_init(&pol, options_get_decode_threads());
+	jobs = options_get_batch_jobs();
+	if (jobs == 0) jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs < 1) jobs = 1;
+	if (jobs > GLOBAL_NR_THREADS) jobs = GLOBAL_NR_THREADS;
+	for (s = 0; s < CW_NR_CONTROLLERS; s++) if (pthread_mutex_init(&batch_controller_mutex[s], NULL) != 0) error_message("error while initializing controller mutex");
+	if (pthread_attr_init(&attr) != 0) error_message("error while initializing thread attributes");
+	if (pthread_attr_setstacksize(&attr, CWTOOL_THREAD_STACK_SIZE) != 0) error_message("error while setting thread stack size");
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0) error_message("error while setting thread detach state");
+	if ((! string_equal(path, "-")) && ((fp = fopen(path, "r")) == NULL)) error_perror_message("error while opening '%s'", path);
+	setlinebuf(stdout);
+	verbose_message(GENERIC, 1, "running up to %d jobs at the same time", jobs);
+
+	/* hand over each line of the jobfile to the workers */
+
+	for (line_number = 1; ; line_number++)
+		{
+		bat_job = (struct cwtool_batch_job *) malloc(sizeof (struct cwtool_batch_job));
+		if (bat_job == NULL) error_oom();
+		if (fgets(bat_job->line, sizeof (bat_job->line), fp) == NULL)
+			{
+			free(bat_job);
+			break;
+			}
+		l = string_length(bat_job->line);
+		if ((l == sizeof (bat_job->line) - 1) && (bat_job->line[l - 1] != '\n')) error_message("line %d of '%s' too long", line_number, path);
+		if (cwtool_batch_line_empty(bat_job->line))
+			{
+			free(bat_job);
+			continue;
+			}
+		bat_job->pol         = &pol;
+		bat_job->line_number = line_number;
+		bat_job->sum         = (struct disk_summary) { };
+		bat_job->controllers = 0;
+		bat_job->statistics  = CW_BOOL_FALSE;
+		bat_job->done        = CW_BOOL_FALSE;
+
+		/* wait until the previous job was taken by a worker */
+
+		pthread_mutex_lock(&batch_mutex);
+		while (batch_pending != NULL)
+			{
+			cwtool_batch_start_workers(&attr, jobs);
+			pthread_cond_wait(&batch_cond, &batch_mutex);
+			}
+		batch_pending = bat_job;
+		cwtool_batch_start_workers(&attr, jobs);
+		pthread_cond_broadcast(&batch_cond);
+		pthread_mutex_unlock(&batch_mutex);
+		}
+	if (ferror(fp)) error_perror_message("error while reading '%s'", path);
+
+	/* wait until all jobs are done and all workers are terminated */
+
+	pthread_mutex_lock(&batch_mutex);
+	while (batch_pending != NULL)
+		{
+		cwtool_batch_start_workers(&attr, jobs);
+		pthread_cond_wait(&batch_cond, &batch_mutex);
+		}
+	batch_eof = CW_BOOL_TRUE;
+	pthread_cond_broadcast(&batch_cond);
+	while (batch_workers > 0) pthread_cond_wait(&batch_cond, &batch_mutex);
+	pthread_mutex_unlock(&batch_mutex);
+	if (fp != stdin) fclose(fp);
+	pthread_attr_destroy(&attr);
+	pool_deinit(&pol);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_render
+ ****************************************************************************/
+static void
+cwtool_render(
+	void)
+
+	{
+	struct file			fil_src, fil_dst;
+
+	file_open(&fil_src, cmdline_get_file(0), FILE_MODE_READ, FILE_FLAG_NONE);
+	file_open(&fil_dst, cmdline_get_file(1), FILE_MODE_CREATE, FILE_FLAG_NONE);
+	dump_render(&fil_src, &fil_dst);
+	file_close(&fil_dst);
+	file_close(&fil_src);
+	}
+
+
+
 /****************************************************************************
  * main
  ****************************************************************************/
@@ -359,8 +1061,12 @@ main(
 	else if (mode == CMDLINE_MODE_INITIALIZE) cwtool_initialize();
 	else if (mode == CMDLINE_MODE_LIST)       cwtool_list();
 	else if (mode == CMDLINE_MODE_STATISTICS) cwtool_statistics();
+	else if (mode == CMDLINE_MODE_PROBE)      cwtool_probe();
 	else if (mode == CMDLINE_MODE_READ)       cwtool_read();
 	else if (mode == CMDLINE_MODE_WRITE)      cwtool_write();
+	else if (mode == CMDLINE_MODE_MULTI_READ) cwtool_multi_read();
+	else if (mode == CMDLINE_MODE_BATCH)      cwtool_batch();
+	else if (mode == CMDLINE_MODE_RENDER)     cwtool_render();
 	else debug_error();
 
 	/* done */
@@ -10,9 +10,12 @@
 
 
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
 
 #include "disk.h"
 #include "error.h"
@@ -26,15 +29,154 @@
 #include "trackmap.h"
 #include "setvalue.h"
 #include "string.h"
+#include "pool.h"
+#include "cache.h"
+#include "statistics.h"
+#include "dump.h"
+#include "scratch.h"
+#include "resume.h"
 
 
 
+#define STATE_FLAG_DONE			(1 << 0)
+#define STATE_FLAG_WRITE		(1 << 1)
+#define STATE_FLAG_READ			(1 << 2)
+#define STATE_FLAG_PENDING		(1 << 3)
+#define STATE_FLAG_FINISHED		(1 << 4)
+#define STATE_FLAG_RESTORED		(1 << 5)
+#define STATE_FLAG_CONTAINER		(1 << 6)
+
+/*
+ * a container takes several megabytes, so only this many pending tracks
+ * keep theirs from one retry pass to the next
+ */
+
+#define STATE_NR_CONTAINERS		16
+
 struct disk_track_buffer
 	{
 	unsigned char			*data;
 	int				size;
 	};
 
+struct disk_track_state
+	{
+	cw_index_t			trackmap_index;
+	cw_count_t			cwtool_track;
+	int				flags;
+	int				tries;
+	unsigned char			*data;
+	struct fifo			ffo_dst;
+	struct container		*con;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	};
+
+/*
+ * if the destination image supports positioned writes, each track is
+ * written at its offset in the image as soon as its data is final, in
+ * whatever order the tracks are read. the resume journal records the
+ * sectors of each track already in the image
+ */
+
+struct disk_commit
+	{
+	cw_bool_t			positioned;
+	cw_bool_t			journal;
+	int				offset[GLOBAL_NR_TRACKS];
+	struct resume			rsm;
+	};
+
+/*
+ * disk_probe() decodes each captured track with all disks using the
+ * same capture parameters, so a track is read only once for all of
+ * them. timeouts and revolutions are not compared, one capture is
+ * enough to find the sectors of the first revolution
+ */
+
+#define PROBE_TRACK_FLAGS		(IMAGE_TRACK_FLAG_INDEXED_READ | IMAGE_TRACK_FLAG_FLIP_SIDE)
+
+struct disk_probe_capture
+	{
+	cw_count_t			cwtool_track;
+	struct image_track		img_trk;
+	cw_bool_t			ok;
+	unsigned char			*data;
+	struct fifo			ffo;
+	};
+
+struct disk_probe_captures
+	{
+	struct disk_probe_capture	dsk_prb_cap[DISK_PROBE_NR_CAPTURES];
+	cw_count_t			captures;
+	};
+
+struct disk_track_states
+	{
+	struct disk_track_state		*dsk_trk_stt;
+	cw_count_t			entries;
+	cw_count_t			containers;
+	};
+
+struct disk_images
+	{
+	struct image_desc		*img_dsc;
+	union image			**img;
+	cw_count_t			entries;
+	};
+
+#define JOB_FLAG_ENCODE			(1 << 0)
+#define JOB_FLAG_DONE			(1 << 1)
+#define JOB_FLAG_FAILED			(1 << 2)
+#define JOB_FLAG_ERROR			(1 << 3)
+
+struct disk_track_job
+	{
+	cw_index_t			trackmap_index;
+	cw_count_t			cwtool_track;
+	cw_count_t			format_track;
+	cw_count_t			format_side;
+	int				flags;
+	unsigned char			*data;
+	struct fifo			ffo_src;
+	struct fifo			ffo_dst;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	unsigned char			*data_src;
+	unsigned char			*data_dst;
+	char				error[ERROR_MESSAGE_SIZE];
+	};
+
+/*
+ * tracks are read from the source image and written to the destination
+ * in the order given by order[], the encoding is done in between by
+ * several threads. queued jobs are read from the source image, but may
+ * not yet be encoded
+ */
+
+struct disk_write_queue
+	{
+	pthread_mutex_t			mutex;
+	pthread_cond_t			cond;
+	struct disk			*dsk;
+	struct pool			*pol;
+	struct disk_track_job		*dsk_trk_job[GLOBAL_NR_TRACKS];
+	cw_count_t			queued;
+	cw_index_t			next;
+	cw_bool_t			stop;
+	pthread_t			thread[GLOBAL_NR_THREADS];
+	cw_count_t			threads;
+	};
+
+/*
+ * an error in an encoder thread only terminates this thread, the job it
+ * was encoding gets the message and the writing thread fails with it
+ */
+
+struct disk_write_worker
+	{
+	struct disk_write_queue		*dsk_wr_que;
+	struct disk_track_job		*dsk_trk_job;
+	};
+
 
 
 
@@ -47,6 +189,183 @@ struct disk_track_buffer
 
 
 
+/****************************************************************************
+ * disk_cleanup_free
+ ****************************************************************************/
+static void
+disk_cleanup_free(
+	void				*arg)
+
+	{
+
+	/*
+	 * the disk_cleanup_*() functions are pthread cleanup handlers. they
+	 * release memory and pool slots if an error terminates only the
+	 * current thread (cwtool -B), otherwise the process exits anyway
+	 */
+
+	free(arg);
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_images
+ ****************************************************************************/
+static void
+disk_cleanup_images(
+	void				*arg)
+
+	{
+	struct disk_images		*dsk_img = (struct disk_images *) arg;
+	int				i;
+
+	/* tracks kept in memory by an image are freed by its release() */
+
+	for (i = 0; i < dsk_img->entries; i++)
+		{
+		if (dsk_img->img[i] == NULL) continue;
+		if (dsk_img->img_dsc->release != NULL) dsk_img->img_dsc->release(dsk_img->img[i]);
+		free(dsk_img->img[i]);
+		}
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_container
+ ****************************************************************************/
+static void
+disk_cleanup_container(
+	void				*arg)
+
+	{
+	container_deinit((struct container *) arg);
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_track_states
+ ****************************************************************************/
+static void
+disk_cleanup_track_states(
+	void				*arg)
+
+	{
+	struct disk_track_states	*dsk_trk_stts = (struct disk_track_states *) arg;
+	int				i;
+
+	for (i = 0; i < dsk_trk_stts->entries; i++)
+		{
+		if (dsk_trk_stts->dsk_trk_stt[i].con != NULL) container_deinit(dsk_trk_stts->dsk_trk_stt[i].con);
+		if (dsk_trk_stts->dsk_trk_stt[i].data != NULL) free(dsk_trk_stts->dsk_trk_stt[i].data);
+		}
+	free(dsk_trk_stts->dsk_trk_stt);
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_commit
+ ****************************************************************************/
+static void
+disk_cleanup_commit(
+	void				*arg)
+
+	{
+	resume_free(&((struct disk_commit *) arg)->rsm);
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_statistics
+ ****************************************************************************/
+static void
+disk_cleanup_statistics(
+	void				*arg)
+
+	{
+	if (arg != NULL) statistics_deinit((struct statistics *) arg);
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_pool
+ ****************************************************************************/
+static void
+disk_cleanup_pool(
+	void				*arg)
+
+	{
+	pool_leave((struct pool *) arg);
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_write_worker
+ ****************************************************************************/
+static void
+disk_cleanup_write_worker(
+	void				*arg)
+
+	{
+	struct disk_write_worker	*dsk_wr_wrk = (struct disk_write_worker *) arg;
+	struct disk_write_queue		*dsk_wr_que = dsk_wr_wrk->dsk_wr_que;
+	struct disk_track_job		*dsk_trk_job = dsk_wr_wrk->dsk_trk_job;
+
+	pthread_mutex_lock(&dsk_wr_que->mutex);
+	string_copy(dsk_trk_job->error, sizeof (dsk_trk_job->error), error_get_last());
+	dsk_trk_job->flags |= JOB_FLAG_DONE | JOB_FLAG_ERROR;
+	pthread_cond_broadcast(&dsk_wr_que->cond);
+	pthread_mutex_unlock(&dsk_wr_que->mutex);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_job_free
+ ****************************************************************************/
+static void
+disk_track_job_free(
+	struct disk_track_job		*dsk_trk_job)
+
+	{
+	if (dsk_trk_job->data_src != NULL) free(dsk_trk_job->data_src);
+	if (dsk_trk_job->data_dst != NULL) free(dsk_trk_job->data_dst);
+	free(dsk_trk_job);
+	}
+
+
+
+/****************************************************************************
+ * disk_cleanup_write_queue
+ ****************************************************************************/
+static void
+disk_cleanup_write_queue(
+	void				*arg)
+
+	{
+	struct disk_write_queue		*dsk_wr_que = (struct disk_write_queue *) arg;
+	int				i;
+
+	/* running encoders finish their current track before they stop */
+
+	pthread_mutex_lock(&dsk_wr_que->mutex);
+	dsk_wr_que->stop = CW_BOOL_TRUE;
+	pthread_cond_broadcast(&dsk_wr_que->cond);
+	pthread_mutex_unlock(&dsk_wr_que->mutex);
+	for (i = 0; i < dsk_wr_que->threads; i++) pthread_join(dsk_wr_que->thread[i], NULL);
+	for (i = 0; i < GLOBAL_NR_TRACKS; i++) if (dsk_wr_que->dsk_trk_job[i] != NULL) disk_track_job_free(dsk_wr_que->dsk_trk_job[i]);
+	pthread_cond_destroy(&dsk_wr_que->cond);
+	pthread_mutex_destroy(&dsk_wr_que->mutex);
+	}
+
+
+
 /****************************************************************************
  * disk_sectors_init
  ****************************************************************************/
@@ -87,6 +406,15 @@ disk_sectors_init(
 	/* set fifo limits for write or read */
 
 	size = dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1);
+
+	/*
+	 * the caller may pass an uninitialized buffer (usually from
+	 * scratch_alloc()), so clear the sector area here. sectors not
+	 * found by the decoder or not delivered by the image reader
+	 * are written as zeros
+	 */
+
+	memset(data, 0, size);
 	if (write) fifo_set_limit(ffo, size);
 	else if (sectors > 0) fifo_set_wr_ofs(ffo, size);
 
@@ -166,34 +494,81 @@ disk_info_update_path(
 
 
 /****************************************************************************
- * disk_dump_bad_sector_lines
+ * disk_summary_start
  ****************************************************************************/
-static cw_void_t
-disk_dump_bad_sector_lines(
-	struct file			*fil,
-	struct container		*con,
-	cw_index_t			index,
+static void
+disk_summary_start(
+	struct disk_summary		*dsk_sum,
+	struct timeval			*tv)
+
+	{
+	if (gettimeofday(tv, NULL) == -1) error_perror_message("error while gettimeofday()");
+	dsk_sum->steps = -1;
+	}
+
+
+
+/****************************************************************************
+ * disk_summary_steps
+ ****************************************************************************/
+static void
+disk_summary_steps(
+	struct disk_summary		*dsk_sum,
+	struct image_desc		*img_dsc,
+	union image			*img)
+
+	{
+	int				steps;
+
+	/* steps stays -1 if no image has a head to move */
+
+	if (img_dsc->head_steps == NULL) return;
+	steps = img_dsc->head_steps(img);
+	if (steps == -1) return;
+	if (dsk_sum->steps == -1) dsk_sum->steps = 0;
+	dsk_sum->steps += steps;
+	}
+
+
+
+/****************************************************************************
+ * disk_summary_stop
+ ****************************************************************************/
+static void
+disk_summary_stop(
+	struct disk_summary		*dsk_sum,
+	struct timeval			*tv)
+
+	{
+	struct timeval			tv2;
+
+	if (gettimeofday(&tv2, NULL) == -1) error_perror_message("error while gettimeofday()");
+	dsk_sum->milliseconds = 1000 * (tv2.tv_sec - tv->tv_sec) + (tv2.tv_usec - tv->tv_usec) / 1000;
+	}
+
+
+
+/****************************************************************************
+ * disk_dump_bad_sector_segment
+ ****************************************************************************/
+static struct dump_segment
+disk_dump_bad_sector_segment(
+	cw_type_t			type,
+	cw_count_t			sector,
+	cw_count_t			occurrence,
 	cw_count_t			start,
 	cw_count_t			end)
 
 	{
-	cw_raw8_t			*data;
-	cw_raw8_t			*error;
-	struct container_lookup		*lkp;
-	cw_char_t			string[0x10000];
-	cw_index_t			i, j;
-
-	data  = container_get_data(con, index);
-	error = container_get_error(con, index);
-	lkp   = container_get_lookup(con, index);
-	for (i = start, j = 0; i < end; i++)
+	if (end < start) end = start;
+	return ((struct dump_segment)
 		{
-		j += string_snprintf(&string[j], sizeof (string) - j, "%02x # %2d %d\n", data[i] & 0x7f, error[i], lkp[i].length);
-		if (j < sizeof (string) / 2) continue;
-		file_write(fil, string, j);
-		j = 0;
-		}
-	if (j > 0) file_write(fil, string, j);
+		.type       = type,
+		.sector     = sector,
+		.occurrence = occurrence,
+		.start      = start,
+		.end        = end
+		});
 	}
 
 
@@ -207,33 +582,29 @@ disk_dump_bad_sector(
 	struct container		*con,
 	cw_count_t			track,
 	cw_mode_t			clock,
-	cw_count_t			sector)
+	cw_count_t			sector,
+	cw_bool_t			*first)
 
 	{
 	struct range_sector		*rng_sec;
+	struct container_lookup		*lkp;
+	struct dump_segment		dmp_seg[3 * CONTAINER_NR_RANGES];
+	struct dump_track		dmp_trk;
+	cw_raw8_t			*length;
 	cw_flag_t			flags = 8;	/* UGLY: flag "no correction" hard coded */
 	cw_count_t			entries, range_entries, start, end, limit;
-	cw_index_t			i, j, k, l, t;
+	cw_index_t			i, j, k, s, t;
 
 	entries = container_get_entries(con);
 	for (i = j = t = 0; i < entries; i++)
 		{
 		limit = container_get_limit(con, i);
 		range_entries = container_get_range_entries(con, i);
-		for (k = l = 0; k < range_entries; k++)
-			{
-			rng_sec = container_get_range_sector(con, i, k);
-			if (range_sector_get_number(rng_sec) == sector) l++;
-			}
-		if (l == 0) continue;
-		file_write_sprintf(fil, "track_data_hex %d %d %d {\n", track, clock, flags);
-		t++;
-		for (k = 0; k < range_entries; k++)
+		for (k = s = 0; k < range_entries; k++)
 			{
 			rng_sec = container_get_range_sector(con, i, k);
 			if (range_sector_get_number(rng_sec) != sector) continue;
 			j++;
-			file_write_sprintf(fil, "##### start track %d sector %d (%d) #####\n", track, sector, j);
 
 			/* sector header and sector gap */
 
@@ -246,12 +617,10 @@ disk_dump_bad_sector(
 
 				if (start > 128) start -= 128;
 				else start = 0;
-				file_write_string(fil, "### sector header ###\n");
-				disk_dump_bad_sector_lines(fil, con, i, start, end);
+				dmp_seg[s++] = disk_dump_bad_sector_segment(DUMP_SEGMENT_HEADER, sector, j, start, end);
 				start = end;
 				end   = container_lookup_position(con, i, range_get_start(range_sector_data(rng_sec)));
-				file_write_string(fil, "### sector gap between header and data ###\n");
-				disk_dump_bad_sector_lines(fil, con, i, start, end);
+				dmp_seg[s++] = disk_dump_bad_sector_segment(DUMP_SEGMENT_GAP, sector, j, start, end);
 				}
 
 			/* sector data */
@@ -263,12 +632,35 @@ disk_dump_bad_sector(
 
 			if (end < limit - 128) end += 128;
 			else end = limit;
-			file_write_string(fil, "### sector data ###\n");
-			disk_dump_bad_sector_lines(fil, con, i, start, end);
-
-			file_write_sprintf(fil, "##### end track %d sector %d (%d) #####\n", track, sector, j);
+			dmp_seg[s++] = disk_dump_bad_sector_segment(DUMP_SEGMENT_DATA, sector, j, start, end);
 			}
-		file_write_string(fil, "}\n");
+		if (s == 0) continue;
+		t++;
+
+		/*
+		 * the dump only needs the lookup lengths, not the
+		 * accumulated lengths also stored in struct container_lookup
+		 */
+
+		lkp    = container_get_lookup(con, i);
+		length = scratch_alloc((limit + 1) * sizeof (cw_raw8_t));
+		for (k = 0; k < limit; k++) length[k] = lkp[k].length;
+		dmp_trk = (struct dump_track)
+			{
+			.track    = track,
+			.clock    = clock,
+			.flags    = flags,
+			.first    = *first,
+			.data     = container_get_data(con, i),
+			.error    = container_get_error(con, i),
+			.length   = length,
+			.seg      = dmp_seg,
+			.segments = s
+			};
+		if (options_get_output_binary()) dump_write_binary(fil, &dmp_trk);
+		else dump_write_text(fil, &dmp_trk);
+		scratch_free(length);
+		*first = CW_BOOL_FALSE;
 		}
 	return (t);
 	}
@@ -282,552 +674,1693 @@ static cw_void_t
 disk_dump_bad_sectors(
 	struct disk_track		*dsk_trk,
 	struct disk_sector		*dsk_sct,
+	struct disk_info		*dsk_nfo,
 	struct file			*fil,
 	struct container		*con,
 	cw_count_t			track,
 	cw_mode_t			clock)
 
 	{
-	static cw_count_t		t = 0;
-	static cw_bool_t		known = CW_BOOL_FALSE;
+	struct dump_track		dmp_trk = { .track = track, .clock = clock, .first = CW_BOOL_TRUE };
 	cw_count_t			sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
-	cw_count_t			i, j;
+	cw_count_t			i, j, t;
 
 	if (track < options_get_output_track_start()) return;
 	if (track > options_get_output_track_end()) return;
 	if (fil == NULL) return;
 	for (i = j = 0; i < sectors; i++) if (dsk_sct[i].err.errors != 0) j++;
 	if (j == 0) return;
-	file_write_string(fil, "# cwtool raw text 3\n");
+
+	/*
+	 * the binary dump has only one magic at the beginning of the file,
+	 * written by disk_read(), and no comments. an empty record is
+	 * written instead, if no sector of this track could be dumped
+	 */
+
+	if (! options_get_output_binary()) file_write_string(fil, "# cwtool raw text 3\n");
 	if (! (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_OUTPUT))
 		{
-		file_write_sprintf(fil, "# track %d: format '%s' does not support raw output of bad sectors\n", track, dsk_trk->fmt_dsc->name);
+		if (options_get_output_binary()) dump_write_binary(fil, &dmp_trk);
+		else file_write_sprintf(fil, "# track %d: format '%s' does not support raw output of bad sectors\n", track, dsk_trk->fmt_dsc->name);
 		return;
 		}
-	for (i = 0; i < sectors; i++)
+	for (i = t = 0; i < sectors; i++)
 		{
 		if (dsk_sct[i].err.errors == 0) continue;
-		t += disk_dump_bad_sector(fil, con, track, clock, dsk_sct[i].number);
+		t += disk_dump_bad_sector(fil, con, track, clock, dsk_sct[i].number, &dmp_trk.first);
 		}
+	if ((options_get_output_binary()) && (dmp_trk.first)) dump_write_binary(fil, &dmp_trk);
 
 	/*
-	 * UGLY: using local static variables to count overall number of
-	 *       tracks and using IMAGE_RAW_NR_HINTS directly
+	 * UGLY: using IMAGE_RAW_NR_HINTS directly. the tracks are counted
+	 *       per job, because each job writes its own output file
 	 */
 
-	if ((t >= IMAGE_RAW_NR_HINTS) && (! known))
-		{
-		error_warning("created bad sector output has too many tracks to be read at once");
-		known = CW_BOOL_TRUE;
-		}
+	if ((dsk_nfo->dumped_tracks < IMAGE_RAW_NR_HINTS) && (dsk_nfo->dumped_tracks + t >= IMAGE_RAW_NR_HINTS)) error_warning("created bad sector output has too many tracks to be read at once");
+	dsk_nfo->dumped_tracks += t;
 	}
 
 
 
 /****************************************************************************
- * disk_track_statistics
+ * disk_track_decode_key
  ****************************************************************************/
 static void
-disk_track_statistics(
-	struct disk			*dsk,
-	union image			*img,
-	int				trackmap_index)
+disk_track_decode_key(
+	struct cache_key		*cch_key,
+	struct disk_track		*dsk_trk,
+	struct fifo			*ffo_src,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	cw_count_t			cwtool_track,
+	cw_count_t			format_track,
+	cw_count_t			format_side)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct fifo			ffo = FIFO_INIT(data, sizeof (data));
-	cw_count_t			cwtool_track, format_track, format_side;
-
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
-	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-
-	/* if this track is not within the wanted range, ignore it */
-
-	if (cwtool_track < options_get_disk_track_start()) goto done;
-	if (cwtool_track > options_get_disk_track_end()) goto done;
-
-	/* skip this track if no format is defined */
-
-	if (dsk_trk->fmt_dsc == NULL) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_statistics == NULL);
+	int				value[9];
+	int				i;
 
-	/* skip this track if it is optional and we got no data */
+	/*
+	 * everything a decoder gets as input goes into the key: format
+	 * settings including bounds, track numbers, options changing the
+	 * decoding, the raw data and the sectors found so far
+	 */
 
-	if (! dsk->img_dsc_l0->track_read(img, &dsk_trk->img_trk, &ffo, NULL, 0, cwtool_track))
+	*cch_key = CACHE_KEY_INIT;
+	cache_key_add(cch_key, dsk_trk->fmt_dsc->name, string_length(dsk_trk->fmt_dsc->name));
+	cache_key_add(cch_key, &dsk_trk->fmt, sizeof (union format));
+	value[0] = cwtool_track;
+	value[1] = format_track;
+	value[2] = format_side;
+	value[3] = options_get_exhaustive_read();
+	value[4] = options_get_output();
+	value[5] = fifo_get_wr_ofs(ffo_src);
+	value[6] = fifo_get_flags(ffo_src);
+	value[7] = sectors;
+	value[8] = options_get_bounds_calibrate();
+	cache_key_add(cch_key, value, sizeof (value));
+	cache_key_add(cch_key, fifo_get_data(ffo_src), fifo_get_wr_ofs(ffo_src));
+	for (i = 0; i < sectors; i++)
 		{
-		if (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL) goto done;
-		error_message("no data available for track %d", cwtool_track);
+		cache_key_add(cch_key, &dsk_sct[i].number, sizeof (dsk_sct[i].number));
+		cache_key_add(cch_key, &dsk_sct[i].err, sizeof (struct disk_error));
+		cache_key_add(cch_key, dsk_sct[i].data, dsk_sct[i].size);
 		}
-	dsk_trk->fmt_dsc->track_statistics(&dsk_trk->fmt, &ffo, cwtool_track, format_track, format_side);
-done:
-	dsk->img_dsc_l0->track_done(img, &dsk_trk->img_trk, cwtool_track);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_greedy2
+ * disk_track_decode
  ****************************************************************************/
 static int
-disk_track_read_greedy2(
-	struct disk			*dsk,
-	struct disk_sector		*dsk_sct,
-	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
-	union image			*img_src,
-	union image			*img_dst,
+disk_track_decode(
+	struct disk_track		*dsk_trk,
 	struct container		*con,
 	struct fifo			*ffo_src,
 	struct fifo			*ffo_dst,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			cwtool_track,
+	cw_count_t			format_track,
+	cw_count_t			format_side)
+
+	{
+	struct cache_key		cch_key;
+	struct disk_sector		dsk_sct2[GLOBAL_NR_SECTORS];
+	unsigned char			*data;
+	int				sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	int				i, found, result = 1;
+
+	if (! cache_enabled()) return (dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side));
+
+	/*
+	 * look up a copy of dsk_sct in the cache, so the decoded result may
+	 * be compared with the cached one if cache_verify is set
+	 */
+
+	disk_track_decode_key(&cch_key, dsk_trk, ffo_src, dsk_sct, sectors, cwtool_track, format_track, format_side);
+	data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	for (i = 0; i < sectors; i++)
+		{
+		dsk_sct2[i] = dsk_sct[i];
+		dsk_sct2[i].data = &data[dsk_sct[i].offset];
+		}
+	found = cache_lookup(&cch_key, dsk_sct2, sectors);
+	if ((found) && (! options_get_cache_verify()))
+		{
+		for (i = 0; i < sectors; i++)
+			{
+			dsk_sct[i].err = dsk_sct2[i].err;
+			memcpy(dsk_sct[i].data, dsk_sct2[i].data, dsk_sct[i].size);
+			}
+		goto done;
+		}
+	if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side))
+		{
+		result = 0;
+		goto done;
+		}
+
+	/*
+	 * if the decoder used the container (match_simple or -o), the
+	 * result depends on previous tries stored there and is not
+	 * cached
+	 */
+
+	if ((con != NULL) && (container_get_entries(con) > 0)) goto done;
+	for (i = 0; (found) && (i < sectors); i++)
+		{
+		if ((memcmp(&dsk_sct[i].err, &dsk_sct2[i].err, sizeof (struct disk_error)) == 0) &&
+			(memcmp(dsk_sct[i].data, dsk_sct2[i].data, dsk_sct[i].size) == 0)) continue;
+		error_warning("cached data of track %d differs from decoded data, replacing it", cwtool_track);
+		found = 0;
+		}
+	if (! found) cache_store(&cch_key, dsk_sct, sectors);
+done:
+	scratch_free(data);
+	return (result);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_statistics
+ ****************************************************************************/
+static void
+disk_track_statistics(
+	struct disk			*dsk,
+	union image			*img,
+	struct statistics		*stt,
 	int				trackmap_index)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
-	int				offset = dsk->img_dsc->offset(img_dst);
-	cw_count_t			cwtool_track, image_track;
-	cw_count_t			format_track, format_side;
-	int				t;
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
+	cw_count_t			cwtool_track, format_track, format_side;
 
 	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
 	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
 	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
 	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
 	dsk_trk = &dsk->trk[cwtool_track];
-	for (t = 0; t <= dsk_opt->retry; t++)
-		{
-		fifo_reset(ffo_src);
 
-		/*
-		 * currently greedy is only used with format "raw". because
-		 * it uses fifo-functions to append the data, we need to
-		 * reset the fifo pointers before doing another try
-		 */
+	/* if this track is not within the wanted range, ignore it */
 
-		fifo_reset(ffo_dst);
+	if (cwtool_track < options_get_disk_track_start()) goto done;
+	if (cwtool_track > options_get_disk_track_end()) goto done;
 
-		/*
-		 * if this track is optional and we could not read
-		 * it, because the drive only supports double steps,
-		 * we simply ignore this track
-		 */
+	/* skip this track if no format is defined */
 
-		if (! dsk->img_dsc_l0->track_read(img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
-		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
-		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
-		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
-		dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+	if (dsk_trk->fmt_dsc == NULL) goto done;
+	debug_error_condition(dsk_trk->fmt_dsc->track_statistics == NULL);
+
+	/* skip this track if it is optional and we got no data */
+
+	if (! dsk->img_dsc_l0->track_read(img, &dsk_trk->img_trk, &ffo, NULL, 0, cwtool_track))
+		{
+		if (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL) goto done;
+		error_message("no data available for track %d", cwtool_track);
 		}
-	return (t);
+
+	/* with stt given, the data is only collected for statistics_print() */
+
+	if (stt != NULL) statistics_add_track(stt, &ffo, cwtool_track, dsk_trk->img_trk.clock);
+	else dsk_trk->fmt_dsc->track_statistics(&dsk_trk->fmt, &ffo, cwtool_track, format_track, format_side);
+done:
+	dsk->img_dsc_l0->track_done(img, &dsk_trk->img_trk, cwtool_track);
+	scratch_free(data);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_greedy
+ * disk_probe_side
  ****************************************************************************/
-static void
-disk_track_read_greedy(
+static cw_index_t
+disk_probe_side(
 	struct disk			*dsk,
-	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
-	char				**path_src,
-	union image			**img_src,
-	int				img_src_count,
-	union image			*img_dst,
-	struct file			*fil_output,
-	int				trackmap_index)
+	cw_count_t			side)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
-	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct container		*con;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
-	int				offset  = dsk->img_dsc->offset(img_dst);
-	cw_count_t			cwtool_track;
-	int				i, t = 0;
-
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_count_t			cwtool_track, format_side;
+	cw_index_t			i;
 
 	/*
-	 * if this track is not within the wanted range, ignore it. because
-	 * the format is greedy there is no fixed size for the data to be
-	 * written, so nothing is written to img_dst
+	 * returns the trackmap index of the first track on the given side
+	 * with sectors to decode, formats like fill or raw give no hint
+	 * about the disk. without format_side in the trackmap the formats
+	 * take the side from the cwtool track number, so it is done here
+	 * too
 	 */
 
-	if (cwtool_track < options_get_disk_track_start()) goto done;
-	if (cwtool_track > options_get_disk_track_end()) goto done;
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+		if (format_side == -1) format_side = cwtool_track % 2;
+		if (format_side != side) continue;
+		dsk_trk = &dsk->trk[cwtool_track];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) continue;
+		if (dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt) > 0) return (i);
+		}
+	return (-1);
+	}
+
+
+
+/****************************************************************************
+ * disk_probe_capture
+ ****************************************************************************/
+static struct fifo *
+disk_probe_capture(
+	struct disk			*dsk,
+	struct disk_probe_captures	*dsk_prb_cps,
+	struct statistics		*stt,
+	char				*path,
+	cw_count_t			cwtool_track)
+
+	{
+	struct disk_probe_capture	*dsk_prb_cap;
+	struct image_track		*img_trk = &dsk->trk[cwtool_track].img_trk;
+	union image			img;
+	cw_index_t			i;
+
+	for (i = 0; i < dsk_prb_cps->captures; i++)
+		{
+		dsk_prb_cap = &dsk_prb_cps->dsk_prb_cap[i];
+		if ((dsk_prb_cap->cwtool_track == cwtool_track) &&
+			(dsk_prb_cap->img_trk.clock == img_trk->clock) &&
+			(dsk_prb_cap->img_trk.side_offset == img_trk->side_offset) &&
+			((dsk_prb_cap->img_trk.flags & PROBE_TRACK_FLAGS) == (img_trk->flags & PROBE_TRACK_FLAGS))) goto done;
+		}
+	if (dsk_prb_cps->captures >= DISK_PROBE_NR_CAPTURES)
+		{
+		error_warning("too many different captures, track %d of disk '%s' not probed", cwtool_track, dsk->name);
+		return (NULL);
+		}
 
 	/*
-	 * skip this track if ffo_dst would contain 0 bytes, this is the case
-	 * with format fill
+	 * a track may be read from an image file only once, so the image
+	 * is opened again for each capture
 	 */
 
-	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+	dsk_prb_cap  = &dsk_prb_cps->dsk_prb_cap[dsk_prb_cps->captures++];
+	*dsk_prb_cap = (struct disk_probe_capture)
+		{
+		.cwtool_track = cwtool_track,
+		.img_trk      = *img_trk,
+		.data         = malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char))
+		};
+	if (dsk_prb_cap->data == NULL) error_oom();
+	dsk_prb_cap->ffo = FIFO_INIT(dsk_prb_cap->data, GLOBAL_MAX_TRACK_SIZE);
+	dsk->img_dsc_l0->open(&img, path, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
+	dsk_prb_cap->ok = dsk->img_dsc_l0->track_read(&img, img_trk, &dsk_prb_cap->ffo, NULL, 0, cwtool_track);
+	dsk->img_dsc_l0->close(&img);
+	if (! dsk_prb_cap->ok) goto done;
 
-	con = container_init(NULL);
-	for (i = 0; i < img_src_count; i++)
+	/*
+	 * side_offset or flip_side may give the same physical track, its
+	 * histogram is shown only once
+	 */
+
+	for (i = 0; i < dsk_prb_cps->captures - 1; i++)
 		{
-		disk_info_update_path(dsk_nfo, path_src[i]);
-		t += disk_track_read_greedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], img_dst, con, &ffo_src, &ffo_dst, trackmap_index);
+		if ((! dsk_prb_cps->dsk_prb_cap[i].ok) ||
+			(fifo_get_wr_ofs(&dsk_prb_cps->dsk_prb_cap[i].ffo) != fifo_get_wr_ofs(&dsk_prb_cap->ffo)) ||
+			(memcmp(dsk_prb_cps->dsk_prb_cap[i].data, dsk_prb_cap->data, fifo_get_wr_ofs(&dsk_prb_cap->ffo)) != 0)) continue;
+		goto done;
 		}
-	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
-	container_deinit(con);
-	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
+	statistics_add_track(stt, &dsk_prb_cap->ffo, cwtool_track, img_trk->clock);
 done:
-	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	return ((dsk_prb_cap->ok) ? &dsk_prb_cap->ffo : NULL);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_nongreedy2
+ * disk_probe_track
  ****************************************************************************/
-static int
-disk_track_read_nongreedy2(
-	struct disk			*dsk,
-	struct disk_sector		*dsk_sct,
-	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
-	union image			*img_src,
-	struct container		*con,
-	struct fifo			*ffo_src,
-	struct fifo			*ffo_dst,
-	int				offset,
-	int				trackmap_index)
+static void
+disk_probe_track(
+	struct disk_probe		*dsk_prb,
+	struct disk_probe_captures	*dsk_prb_cps,
+	struct statistics		*stt,
+	char				*path,
+	cw_index_t			trackmap_index)
 
 	{
+	struct disk			*dsk = dsk_prb->dsk;
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
+	unsigned char			*data_src = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	unsigned char			*data_dst = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct container		*con;
+	struct fifo			*ffo;
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
 	cw_count_t			cwtool_track, format_track, format_side;
-	int				b, t;
+	int				sectors, i;
 
 	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
 	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
 	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
 	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
 	dsk_trk = &dsk->trk[cwtool_track];
-	for (b = -1, t = 0; (b != 0) && (t <= dsk_opt->retry); t++)
+	disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0);
+	sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	dsk_prb->tracks++;
+	dsk_prb->sectors += sectors;
+
+	/*
+	 * the decoder gets a copy of the captured data, because some
+	 * options like postcomp_simple modify the data. data that is too
+	 * long for this format simply does not match
+	 */
+
+	ffo = disk_probe_capture(dsk, dsk_prb_cps, stt, path, cwtool_track);
+	if (ffo == NULL) goto done;
+	memcpy(data_src, fifo_get_data(ffo), fifo_get_wr_ofs(ffo));
+	fifo_set_wr_ofs(&ffo_src, fifo_get_wr_ofs(ffo));
+	fifo_set_flags(&ffo_src, fifo_get_flags(ffo));
+	con = container_init(scratch_alloc(sizeof (struct container)));
+	i = dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, &ffo_src, &ffo_dst, dsk_sct, cwtool_track, format_track, format_side);
+	container_deinit(con);
+	scratch_free(con);
+	if (! i) goto done;
+
+	/* a sector is found, if the decoder got its header */
+
+	for (i = 0; i < sectors; i++)
 		{
-		fifo_reset(ffo_src);
+		if (dsk_sct[i].err.flags & DISK_ERROR_FLAG_NOT_FOUND) continue;
+		dsk_prb->sectors_found++;
+		if (dsk_sct[i].err.errors == 0) dsk_prb->sectors_good++;
+		}
+done:
+	scratch_free(data_dst);
+	scratch_free(data_src);
+	}
 
-		/*
-		 * if this track is optional and we could not read
-		 * it, because the drive only supports double steps,
-		 * we simply ignore this track
-		 */
 
-		if (! dsk->img_dsc_l0->track_read(img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
-		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
-		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
-		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
-		b = dsk_nfo->sectors_bad;
+
+/****************************************************************************
+ * disk_greedy
+ ****************************************************************************/
+static cw_bool_t
+disk_greedy(
+	struct disk			*dsk)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			i;
+
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		dsk_trk = &dsk->trk[trackmap_entry_get_cwtool_track(dsk->trm, trm_ent)];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
+		if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) return (CW_BOOL_TRUE);
 		}
-	return (t);
+	return (CW_BOOL_FALSE);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_nongreedy
+ * disk_commit_positioned
  ****************************************************************************/
-static void
-disk_track_read_nongreedy(
+static cw_bool_t
+disk_commit_positioned(
 	struct disk			*dsk,
-	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
-	char				**path_src,
-	union image			**img_src,
-	int				img_src_count,
-	union image			*img_dst,
-	struct file			*fil_output,
-	int				trackmap_index)
+	struct disk_commit		*dsk_cmt,
+	union image			*img_dst)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
-	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct container		*con;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
-	int				offset  = dsk->img_dsc->offset(img_dst);
-	int				i, t = 0;
-	cw_count_t			cwtool_track, image_track;
-
-	/*
-	 * skip this track if ffo_dst would contain 0 bytes, this is the case
-	 * with format fill
-	 */
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			i;
+	int				size;
 
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	image_track = trackmap_entry_get_image_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+	if ((dsk->img_dsc->reserve == NULL) || (dsk->img_dsc->track_write_at == NULL)) return (CW_BOOL_FALSE);
 
 	/*
-	 * if this track is not within the wanted range, just write zeros
-	 * to img_dst and skip all reading routines. thats why
-	 * disk_sectors_init() can not be skipped
+	 * the offset of each track is the sum of the sizes of all tracks
+	 * before it in trackmap order, like in disk_track_read_nongreedy().
+	 * greedy formats have no fixed size, so they need to be written
+	 * in order
 	 */
 
-	if (cwtool_track < options_get_disk_track_start()) goto done_write;
-	if (cwtool_track > options_get_disk_track_end()) goto done_write;
-
-	con = container_init(NULL);
-	for (i = 0; i < img_src_count; i++)
+	if (disk_greedy(dsk)) return (CW_BOOL_FALSE);
+	for (i = size = 0; i < entries; i++)
 		{
-		disk_info_update_path(dsk_nfo, path_src[i]);
-		t += disk_track_read_nongreedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], con, &ffo_src, &ffo_dst, offset, trackmap_index);
-		if ((t > 0) && (dsk_nfo->sectors_bad == 0)) break;
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		dsk_trk = &dsk->trk[trackmap_entry_get_cwtool_track(dsk->trm, trm_ent)];
+		dsk_cmt->offset[i] = size;
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		if (dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt) == 0) continue;
+		size += dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1);
 		}
-	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
-	container_deinit(con);
-	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
-done_write:
-	dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, &ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
-done:
-	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	if (! dsk->img_dsc->reserve(img_dst, size)) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_commit_init
+ ****************************************************************************/
+static void
+disk_commit_init(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_commit		*dsk_cmt,
+	union image			*img_dst,
+	char				*path_dst)
+
+	{
+	cw_bool_t			load = (dsk_opt->flags & DISK_OPTION_FLAG_RESUME) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+
+	/*
+	 * the journal needs a path next to the image, so there is none if
+	 * the image is written to stdout. greedy formats have no fixed
+	 * track size, so their tracks are not recorded either
+	 */
+
+	dsk_cmt->positioned = disk_commit_positioned(dsk, dsk_cmt, img_dst);
+	if ((string_equal(path_dst, "-")) || (disk_greedy(dsk)))
+		{
+		if (load) error_warning("no resume journal for disk '%s' written to '%s', --resume is ignored", dsk->name, path_dst);
+		return;
+		}
+	resume_open(&dsk_cmt->rsm, path_dst, dsk->name, trackmap_entries(dsk->trm), load);
+	dsk_cmt->journal = CW_BOOL_TRUE;
+	}
+
+
+
+/****************************************************************************
+ * disk_commit_deinit
+ ****************************************************************************/
+static void
+disk_commit_deinit(
+	struct disk_commit		*dsk_cmt)
+
+	{
+	if (dsk_cmt->journal) resume_close(&dsk_cmt->rsm, CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_commit_restore
+ ****************************************************************************/
+static cw_mode_t
+disk_commit_restore(
+	struct disk_commit		*dsk_cmt,
+	struct disk_track		*dsk_trk,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_dst,
+	int				trackmap_index,
+	cw_count_t			cwtool_track)
+
+	{
+	struct resume_track		*rsm_trk;
+	int				i;
+
+	/*
+	 * dsk_sct and ffo_dst have to be initialized by
+	 * disk_sectors_init(), sectors read later replace the ones from
+	 * the journal only if they are better
+	 */
+
+	if ((! dsk_cmt->journal) || (dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt) == 0)) return (RESUME_TRACK_NONE);
+	rsm_trk = resume_track_get(&dsk_cmt->rsm, trackmap_index);
+	if (rsm_trk == NULL) return (RESUME_TRACK_NONE);
+	if ((rsm_trk->sectors != dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt)) ||
+		(rsm_trk->size != dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1)))
+		{
+		verbose_message(GENERIC, 1, "format of track %d differs from resume journal, reading it again", cwtool_track);
+		return (RESUME_TRACK_NONE);
+		}
+	memcpy(fifo_get_data(ffo_dst), rsm_trk->data, rsm_trk->size);
+	for (i = 0; i < rsm_trk->sectors; i++) dsk_sct[i].err = rsm_trk->err[i];
+	return (rsm_trk->status);
+	}
+
+
+
+/****************************************************************************
+ * disk_commit_offset
+ ****************************************************************************/
+static int
+disk_commit_offset(
+	struct disk			*dsk,
+	struct disk_commit		*dsk_cmt,
+	union image			*img_dst,
+	int				trackmap_index)
+
+	{
+	if (dsk_cmt->positioned) return (dsk_cmt->offset[trackmap_index]);
+	return (dsk->img_dsc->offset(img_dst));
+	}
+
+
+
+/****************************************************************************
+ * disk_commit_track
+ ****************************************************************************/
+static void
+disk_commit_track(
+	struct disk			*dsk,
+	struct disk_commit		*dsk_cmt,
+	union image			*img_dst,
+	struct disk_track		*dsk_trk,
+	struct fifo			*ffo_dst,
+	struct disk_sector		*dsk_sct,
+	int				trackmap_index,
+	cw_count_t			image_track,
+	cw_bool_t			record)
+
+	{
+	int				sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+
+	if (dsk_cmt->positioned) dsk->img_dsc->track_write_at(img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, sectors, image_track, dsk_cmt->offset[trackmap_index]);
+	else dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, sectors, image_track);
+
+	/*
+	 * add the track to the journal only after its data was written,
+	 * tracks not read at all are not recorded, the ones taken from the
+	 * journal are still in there. tracks without sectors (like with
+	 * gcr_g64) have no fixed size, they are read again anyway
+	 */
+
+	if ((dsk_cmt->journal) && (record) && (sectors > 0)) resume_track_write(&dsk_cmt->rsm, trackmap_index, dsk_sct, sectors, fifo_get_data(ffo_dst), dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1));
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_greedy2
+ ****************************************************************************/
+static int
+disk_track_read_greedy2(
+	struct disk			*dsk,
+	struct disk_sector		*dsk_sct,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	union image			*img_src,
+	union image			*img_dst,
+	struct container		*con,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	int				offset = dsk->img_dsc->offset(img_dst);
+	cw_count_t			cwtool_track, image_track;
+	cw_count_t			format_track, format_side;
+	int				t;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	for (t = 0; t <= dsk_opt->retry; t++)
+		{
+		fifo_reset(ffo_src);
+
+		/*
+		 * currently greedy is only used with format "raw". because
+		 * it uses fifo-functions to append the data, we need to
+		 * reset the fifo pointers before doing another try
+		 */
+
+		fifo_reset(ffo_dst);
+
+		/*
+		 * if this track is optional and we could not read
+		 * it, because the drive only supports double steps,
+		 * we simply ignore this track
+		 */
+
+		if (! dsk->img_dsc_l0->track_read(img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
+		pool_enter(dsk_opt->pol);
+		pthread_cleanup_push(disk_cleanup_pool, dsk_opt->pol);
+		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+		pthread_cleanup_pop(1);
+		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+		}
+	return (t);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_greedy
+ ****************************************************************************/
+static void
+disk_track_read_greedy(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct file			*fil_output,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
+	unsigned char			*data_src = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	unsigned char			*data_dst = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct container		*con;
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
+	int				offset  = dsk->img_dsc->offset(img_dst);
+	cw_count_t			cwtool_track;
+	int				i, t = 0;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+
+	/*
+	 * if this track is not within the wanted range, ignore it. because
+	 * the format is greedy there is no fixed size for the data to be
+	 * written, so nothing is written to img_dst
+	 */
+
+	if (cwtool_track < options_get_disk_track_start()) goto done;
+	if (cwtool_track > options_get_disk_track_end()) goto done;
+
+	/*
+	 * skip this track if ffo_dst would contain 0 bytes, this is the case
+	 * with format fill
+	 */
+
+	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+
+	con = container_init(scratch_alloc(sizeof (struct container)));
+	pthread_cleanup_push(disk_cleanup_container, con);
+	for (i = 0; i < img_src_count; i++)
+		{
+		disk_info_update_path(dsk_nfo, path_src[i]);
+		t += disk_track_read_greedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], img_dst, con, &ffo_src, &ffo_dst, trackmap_index);
+		}
+	disk_dump_bad_sectors(dsk_trk, dsk_sct, dsk_nfo, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+	pthread_cleanup_pop(1);
+	scratch_free(con);
+	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	scratch_free(data_dst);
+	scratch_free(data_src);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_nongreedy2
+ ****************************************************************************/
+static int
+disk_track_read_nongreedy2(
+	struct disk			*dsk,
+	struct disk_sector		*dsk_sct,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	union image			*img_src,
+	struct image_track		*img_trk,
+	struct container		*con,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	int				offset,
+	int				trackmap_index,
+	int				try,
+	int				tries)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track, format_track, format_side;
+	int				b, t;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	for (b = -1, t = try; (b != 0) && (t < tries); t++)
+		{
+		fifo_reset(ffo_src);
+
+		/*
+		 * if this track is optional and we could not read
+		 * it, because the drive only supports double steps,
+		 * we simply ignore this track
+		 */
+
+		if (! dsk->img_dsc_l0->track_read(img_src, img_trk, ffo_src, NULL, 0, cwtool_track)) break;
+		pool_enter(dsk_opt->pol);
+		pthread_cleanup_push(disk_cleanup_pool, dsk_opt->pol);
+		if (! disk_track_decode(dsk_trk, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+		pthread_cleanup_pop(1);
+		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		b = dsk_nfo->sectors_bad;
+		}
+	return (t - try);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_nongreedy
+ ****************************************************************************/
+static void
+disk_track_read_nongreedy(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct file			*fil_output,
+	struct disk_commit		*dsk_cmt,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
+	unsigned char			*data_src = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	unsigned char			*data_dst = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct container		*con;
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
+	int				offset  = disk_commit_offset(dsk, dsk_cmt, img_dst, trackmap_index);
+	int				i, t = 0;
+	cw_mode_t			status = RESUME_TRACK_NONE;
+	cw_count_t			cwtool_track, image_track;
+
+	/*
+	 * skip this track if ffo_dst would contain 0 bytes, this is the case
+	 * with format fill
+	 */
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	image_track = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+
+	/*
+	 * if this track is not within the wanted range, just write zeros
+	 * to img_dst and skip all reading routines. thats why
+	 * disk_sectors_init() can not be skipped
+	 */
+
+	if (cwtool_track < options_get_disk_track_start()) goto done_write;
+	if (cwtool_track > options_get_disk_track_end()) goto done_write;
+
+	/*
+	 * with --resume a track without bad sectors in the journal is not
+	 * read again, the sectors of a bad one are the starting point for
+	 * the new tries
+	 */
+
+	status = disk_commit_restore(dsk_cmt, dsk_trk, dsk_sct, &ffo_dst, trackmap_index, cwtool_track);
+	if (status == RESUME_TRACK_GOOD)
+		{
+		disk_info_update_path(dsk_nfo, dsk_cmt->rsm.path);
+		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, 0, offset, 1);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		goto done_write;
+		}
+	con = container_init(scratch_alloc(sizeof (struct container)));
+	pthread_cleanup_push(disk_cleanup_container, con);
+	for (i = 0; i < img_src_count; i++)
+		{
+		disk_info_update_path(dsk_nfo, path_src[i]);
+		t += disk_track_read_nongreedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], &dsk_trk->img_trk, con, &ffo_src, &ffo_dst, offset, trackmap_index, 0, dsk_opt->retry + 1);
+		if ((t > 0) && (dsk_nfo->sectors_bad == 0)) break;
+		}
+	disk_dump_bad_sectors(dsk_trk, dsk_sct, dsk_nfo, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+	pthread_cleanup_pop(1);
+	scratch_free(con);
+	if ((t == 0) && (status == RESUME_TRACK_NONE) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
+done_write:
+	disk_commit_track(dsk, dsk_cmt, img_dst, dsk_trk, &ffo_dst, dsk_sct, trackmap_index, image_track, (t > 0));
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	scratch_free(data_dst);
+	scratch_free(data_src);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read
+ ****************************************************************************/
+static void
+disk_track_read(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct file			*fil_output,
+	struct disk_commit		*dsk_cmt,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+
+	/* skip this track if no format is defined */
+
+	if (dsk_trk->fmt_dsc == NULL) return;
+	debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
+	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) disk_track_read_greedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
+	else disk_track_read_nongreedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, dsk_cmt, trackmap_index);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_order
+ ****************************************************************************/
+static cw_count_t
+disk_track_order(
+	struct disk			*dsk,
+	union image			*img,
+	cw_index_t			*order)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	int				position[GLOBAL_NR_TRACKS];
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			i, j, ct;
+
+	debug_error_condition(dsk->img_dsc_l0->track_position == NULL);
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		dsk_trk = &dsk->trk[ct];
+		position[i] = dsk->img_dsc_l0->track_position(img, &dsk_trk->img_trk, ct);
+
+		/*
+		 * insertion sort by position on the device, so both sides
+		 * of a cylinder follow each other. entries with the same
+		 * position keep their trackmap order
+		 */
+
+		for (j = i; (j > 0) && (position[order[j - 1]] > position[i]); j--) order[j] = order[j - 1];
+		order[j] = i;
+		}
+	return (entries);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_state_init
+ ****************************************************************************/
+static void
+disk_track_state_init(
+	struct disk			*dsk,
+	struct disk_commit		*dsk_cmt,
+	struct disk_track_state		*dsk_trk_stt,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track;
+	cw_mode_t			status;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	*dsk_trk_stt = (struct disk_track_state)
+		{
+		.trackmap_index = trackmap_index,
+		.cwtool_track   = cwtool_track
+		};
+
+	/*
+	 * same decisions as in disk_track_read() and
+	 * disk_track_read_nongreedy(), but only remember them in
+	 * dsk_trk_stt->flags
+	 */
+
+	if (dsk_trk->fmt_dsc == NULL) return;
+	dsk_trk_stt->data = malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	if (dsk_trk_stt->data == NULL) error_oom();
+	dsk_trk_stt->ffo_dst = FIFO_INIT(dsk_trk_stt->data, GLOBAL_MAX_TRACK_SIZE);
+	dsk_trk_stt->flags   = STATE_FLAG_DONE;
+	if (disk_sectors_init(dsk_trk_stt->dsk_sct, dsk_trk, &dsk_trk_stt->ffo_dst, 0) == 0) return;
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+	dsk_trk_stt->flags |= STATE_FLAG_WRITE;
+	if (cwtool_track < options_get_disk_track_start()) return;
+	if (cwtool_track > options_get_disk_track_end()) return;
+	dsk_trk_stt->flags |= STATE_FLAG_READ | STATE_FLAG_PENDING;
+	status = disk_commit_restore(dsk_cmt, dsk_trk, dsk_trk_stt->dsk_sct, &dsk_trk_stt->ffo_dst, trackmap_index, cwtool_track);
+	if (status != RESUME_TRACK_NONE) dsk_trk_stt->flags |= STATE_FLAG_RESTORED;
+	if (status == RESUME_TRACK_GOOD) dsk_trk_stt->flags &= ~STATE_FLAG_PENDING;
+	}
+
+
+
+/****************************************************************************
+ * disk_track_state_read
+ ****************************************************************************/
+static void
+disk_track_state_read(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	struct disk_track_states	*dsk_trk_stts,
+	struct disk_track_state		*dsk_trk_stt,
+	union image			*img_src,
+	struct fifo			*ffo_src)
+
+	{
+	struct disk_track		*dsk_trk = &dsk->trk[dsk_trk_stt->cwtool_track];
+	struct image_track		img_trk = dsk_trk->img_trk;
+	int				t;
+
+	if (! (dsk_trk_stt->flags & STATE_FLAG_PENDING)) return;
+
+	/*
+	 * with seek_optimize 2 each retry steps onto the track from the
+	 * other direction than the try before. only a copy of img_trk is
+	 * changed, dsk may be used by other jobs at the same time
+	 */
+
+	if ((options_get_seek_optimize() > 1) && (dsk_trk_stt->tries > 0)) img_trk.flags |= (dsk_trk_stt->tries & 1) ? IMAGE_TRACK_FLAG_SEEK_ABOVE : IMAGE_TRACK_FLAG_SEEK_BELOW;
+	if (dsk_trk_stt->con == NULL) dsk_trk_stt->con = container_init(NULL);
+	t = disk_track_read_nongreedy2(dsk, dsk_trk_stt->dsk_sct, dsk_opt, dsk_nfo, img_src, &img_trk, dsk_trk_stt->con, ffo_src, &dsk_trk_stt->ffo_dst, 0, dsk_trk_stt->trackmap_index, dsk_trk_stt->tries, dsk_trk_stt->tries + 1);
+	dsk_trk_stt->tries += t;
+
+	/*
+	 * keep the container only as long as further tries will follow
+	 * and at most for STATE_NR_CONTAINERS tracks at once. the other
+	 * pending tracks start with an empty container on each pass
+	 */
+
+	if ((t > 0) && (dsk_nfo->sectors_bad > 0) && (dsk_trk_stt->tries <= dsk_opt->retry))
+		{
+		if (dsk_trk_stt->flags & STATE_FLAG_CONTAINER) return;
+		if (dsk_trk_stts->containers < STATE_NR_CONTAINERS)
+			{
+			dsk_trk_stts->containers++;
+			dsk_trk_stt->flags |= STATE_FLAG_CONTAINER;
+			return;
+			}
+		}
+	else dsk_trk_stt->flags &= ~STATE_FLAG_PENDING;
+	if (dsk_trk_stt->flags & STATE_FLAG_CONTAINER) dsk_trk_stts->containers--;
+	dsk_trk_stt->flags &= ~STATE_FLAG_CONTAINER;
+	container_deinit(dsk_trk_stt->con);
+	dsk_trk_stt->con = NULL;
+	}
+
+
+
+/****************************************************************************
+ * disk_track_state_finish
+ ****************************************************************************/
+static void
+disk_track_state_finish(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	struct disk_track_state		*dsk_trk_stt,
+	union image			*img_src,
+	union image			*img_dst,
+	struct disk_commit		*dsk_cmt)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk = &dsk->trk[dsk_trk_stt->cwtool_track];
+	int				offset;
+	cw_bool_t			restored;
+	cw_count_t			cwtool_track = dsk_trk_stt->cwtool_track;
+	cw_count_t			image_track;
+
+	if (dsk_trk_stt->flags & STATE_FLAG_FINISHED) return;
+	dsk_trk_stt->flags |= STATE_FLAG_FINISHED;
+	offset = disk_commit_offset(dsk, dsk_cmt, img_dst, dsk_trk_stt->trackmap_index);
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, dsk_trk_stt->trackmap_index);
+	image_track = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	restored = (dsk_trk_stt->flags & STATE_FLAG_RESTORED) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	if (dsk_trk_stt->flags & STATE_FLAG_READ)
+		{
+		if ((dsk_trk_stt->tries == 0) && (! restored) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+		if ((dsk_trk_stt->tries == 0) && (restored)) disk_info_update_path(dsk_nfo, dsk_cmt->rsm.path);
+		disk_info_update(dsk_nfo, dsk_trk, dsk_trk_stt->dsk_sct, cwtool_track, dsk_trk_stt->tries, offset, 1);
+		if ((dsk_trk_stt->tries == 0) && (restored) && (dsk_opt->info_func != NULL)) dsk_opt->info_func(dsk_nfo, 0);
+		}
+	if (dsk_trk_stt->flags & STATE_FLAG_WRITE) disk_commit_track(dsk, dsk_cmt, img_dst, dsk_trk, &dsk_trk_stt->ffo_dst, dsk_trk_stt->dsk_sct, dsk_trk_stt->trackmap_index, image_track, (dsk_trk_stt->flags & STATE_FLAG_READ) && (dsk_trk_stt->tries > 0));
+	if (dsk_trk_stt->flags & STATE_FLAG_DONE) dsk->img_dsc_l0->track_done(img_src, &dsk_trk->img_trk, cwtool_track);
+	if (dsk_trk_stt->data != NULL) free(dsk_trk_stt->data);
+	dsk_trk_stt->data = NULL;
+	}
+
+
+
+/****************************************************************************
+ * disk_read_scheduled
+ ****************************************************************************/
+static cw_bool_t
+disk_read_scheduled(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct file			*fil_output,
+	struct disk_commit		*dsk_cmt)
+
+	{
+	struct disk_track_state		*dsk_trk_stt;
+	struct disk_track_states	dsk_trk_stts;
+	unsigned char			*data_src;
+	struct fifo			ffo_src;
+	cw_index_t			order[GLOBAL_NR_TRACKS];
+	cw_count_t			entries;
+	cw_index_t			i, j, k, p;
+
+	/*
+	 * tracks are only reordered if reading from one device. the bad
+	 * sector output and greedy formats need the data of a track
+	 * immediately, so they are also read the old way
+	 */
+
+	if (options_get_seek_optimize() == 0) return (CW_BOOL_FALSE);
+	if ((img_src_count != 1) || (fil_output != NULL)) return (CW_BOOL_FALSE);
+	if (dsk->img_dsc_l0->head_steps == NULL) return (CW_BOOL_FALSE);
+	if (dsk->img_dsc_l0->head_steps(img_src[0]) == -1) return (CW_BOOL_FALSE);
+	if (disk_greedy(dsk)) return (CW_BOOL_FALSE);
+	entries = trackmap_entries(dsk->trm);
+
+	/*
+	 * first pass reads all tracks sorted by cylinder, the retry passes
+	 * only revisit the tracks with bad sectors and change direction
+	 * each time, so the head moves in serpentine order
+	 */
+
+	dsk_trk_stt = calloc(entries, sizeof (struct disk_track_state));
+	if (dsk_trk_stt == NULL) error_oom();
+	dsk_trk_stts = (struct disk_track_states) { .dsk_trk_stt = dsk_trk_stt, .entries = entries };
+	pthread_cleanup_push(disk_cleanup_track_states, &dsk_trk_stts);
+	data_src = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	ffo_src  = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	for (i = 0; i < entries; i++) disk_track_state_init(dsk, dsk_cmt, &dsk_trk_stt[i], i);
+	disk_track_order(dsk, img_src[0], order);
+	disk_info_update_path(dsk_nfo, path_src[0]);
+	for (p = k = 0; p <= dsk_opt->retry; p++)
+		{
+		for (i = 0; i < entries; i++)
+			{
+			j = (p & 1) ? order[entries - i - 1] : order[i];
+			disk_track_state_read(dsk, dsk_opt, dsk_nfo, &dsk_trk_stts, &dsk_trk_stt[j], img_src[0], &ffo_src);
+
+			/*
+			 * with positioned writes a track is committed to
+			 * img_dst as soon as no further tries will follow.
+			 * without them the tracks are committed in trackmap
+			 * order, each one as soon as it and all tracks
+			 * before it are final. so the resume journal grows
+			 * during the read in both cases
+			 */
+
+			if ((dsk_cmt->positioned) && (! (dsk_trk_stt[j].flags & STATE_FLAG_PENDING))) disk_track_state_finish(dsk, dsk_opt, dsk_nfo, &dsk_trk_stt[j], img_src[0], img_dst, dsk_cmt);
+			for ( ; (k < entries) && (! (dsk_trk_stt[k].flags & STATE_FLAG_PENDING)); k++) disk_track_state_finish(dsk, dsk_opt, dsk_nfo, &dsk_trk_stt[k], img_src[0], img_dst, dsk_cmt);
+			}
+		}
+
+	/* write all remaining tracks to img_dst in trackmap order */
+
+	for (i = 0; i < entries; i++) disk_track_state_finish(dsk, dsk_opt, dsk_nfo, &dsk_trk_stt[i], img_src[0], img_dst, dsk_cmt);
+	scratch_free(data_src);
+	pthread_cleanup_pop(1);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_write_data_size
+ ****************************************************************************/
+static cw_size_t
+disk_write_data_size(
+	struct disk			*dsk,
+	cw_bool_t			force)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_bool_t			needed = CW_BOOL_FALSE;
+	cw_count_t			entries;
+	cw_index_t			i, ct;
+	cw_count_t			o;
+	cw_size_t			s, size = 0;
+
+	entries = trackmap_entries(dsk->trm);
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		dsk_trk = &dsk->trk[ct];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		if (dsk_trk->fmt_dsc->get_data_offset == NULL) continue;
+		if (dsk_trk->fmt_dsc->get_data_size == NULL) continue;
+		o = dsk_trk->fmt_dsc->get_data_offset(&dsk_trk->fmt);
+		s = dsk_trk->fmt_dsc->get_data_size(&dsk_trk->fmt);
+		if ((o >= 0) && (s >= 0)) needed = CW_BOOL_TRUE;
+		size += dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1);
+		}
+	if ((! needed) && (! force)) size = 0;
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * disk_write_data_get
+ ****************************************************************************/
+static cw_void_t
+disk_write_data_get(
+	struct disk			*dsk,
+	struct disk_track_buffer	*dsk_trk_buf,
+	union image			*img)
+
+	{
+	unsigned char			*data = dsk_trk_buf[0].data;
+	unsigned char			*data_tmp = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	cw_size_t			size = dsk_trk_buf[0].size;
+	cw_count_t			entries;
+	cw_index_t			i, j, ct, it;
+	cw_size_t			s;
+
+	entries = trackmap_entries(dsk->trm);
+	for (i = j = 0; i < entries; i++)
+		{
+		struct trackmap_entry	*trm_ent;
+		struct disk_track	*dsk_trk;
+		struct disk_sector	dsk_sct[GLOBAL_NR_SECTORS] = { };
+		struct fifo		ffo_tmp = FIFO_INIT(data_tmp, GLOBAL_MAX_TRACK_SIZE);
+
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		it = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+		dsk_trk = &dsk->trk[ct];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		disk_sectors_init(dsk_sct, dsk_trk, &ffo_tmp, 1);
+		if (fifo_get_limit(&ffo_tmp) == 0) continue;
+		dsk->img_dsc->track_read(
+			img,
+			&dsk_trk->img_trk,
+			&ffo_tmp,
+			dsk_sct,
+			dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt),
+			it);
+		s = fifo_get_wr_ofs(&ffo_tmp);
+		if (s == 0) continue;
+		error_condition(j + s > size);
+		dsk_trk_buf[ct + 1] = (struct disk_track_buffer)
+			{
+			.data = &data[j],
+			.size = s
+			};
+		memcpy(&data[j], fifo_get_data(&ffo_tmp), s);
+		j += s;
+		}
+	scratch_free(data_tmp);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_write_prepare
+ ****************************************************************************/
+static cw_bool_t
+disk_track_write_prepare(
+	struct disk			*dsk,
+	struct disk_track_buffer	*dsk_trk_buf,
+	union image			*img_src,
+	struct disk_track_job		*dsk_trk_job,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	int				offset, size;
+	cw_count_t			cwtool_track, image_track;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	dsk_trk_job->trackmap_index = trackmap_index;
+	dsk_trk_job->cwtool_track   = cwtool_track;
+	dsk_trk_job->format_track   = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	dsk_trk_job->format_side    = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk_job->ffo_src        = FIFO_INIT(dsk_trk_job->data_src, GLOBAL_MAX_TRACK_SIZE);
+	dsk_trk_job->ffo_dst        = FIFO_INIT(dsk_trk_job->data_dst, GLOBAL_MAX_TRACK_SIZE);
+
+	/* skip this track if no format is defined */
+
+	if (dsk_trk->fmt_dsc == NULL) return (CW_BOOL_FALSE);
+	disk_sectors_init(dsk_trk_job->dsk_sct, dsk_trk, &dsk_trk_job->ffo_src, 1);
+	debug_error_condition(dsk_trk->fmt_dsc->track_write == NULL);
+
+	/*
+	 * skip this track if we got 0 bytes but expected more than
+	 * that from the image reader, but this will currently
+	 * not happen. with format fill also 0 bytes are
+	 * expected, so in this case we do not skip this track
+	 */
+
+	if (fifo_get_limit(&dsk_trk_job->ffo_src) > 0)
+		{
+		if (dsk_trk_buf != NULL)
+			{
+
+			/*
+			 * get data from dsk_trk_buf. dsk_trk_buf[0]
+			 * contains size for while image
+			 */
+
+			offset = dsk_trk->fmt_dsc->get_data_offset(&dsk_trk->fmt);
+			size   = dsk_trk->fmt_dsc->get_data_size(&dsk_trk->fmt);
+			if ((offset < 0) || (size < 0)) dsk_trk_job->data = NULL;
+			else if (offset + size > dsk_trk_buf[0].size) dsk_trk_job->data = NULL;
+			else dsk_trk_job->data = &dsk_trk_buf[0].data[offset];
+			fifo_write_block(
+				&dsk_trk_job->ffo_src,
+				dsk_trk_buf[cwtool_track + 1].data,
+				dsk_trk_buf[cwtool_track + 1].size);
+			}
+		else dsk->img_dsc->track_read(img_src, &dsk_trk->img_trk, &dsk_trk_job->ffo_src, dsk_trk_job->dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+		if (fifo_get_wr_ofs(&dsk_trk_job->ffo_src) == 0) return (CW_BOOL_FALSE);
+		}
+
+	/*
+	 * if this track is not within the wanted range, do no encoding and
+	 * do not write to img_dsc_l0
+	 */
+	
+	if (cwtool_track < options_get_disk_track_start()) return (CW_BOOL_FALSE);
+	if (cwtool_track > options_get_disk_track_end()) return (CW_BOOL_FALSE);
+	dsk_trk_job->flags |= JOB_FLAG_ENCODE;
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_write_encode
+ ****************************************************************************/
+static void
+disk_track_write_encode(
+	struct disk			*dsk,
+	struct disk_track_job		*dsk_trk_job)
+
+	{
+	struct disk_track		*dsk_trk = &dsk->trk[dsk_trk_job->cwtool_track];
+
+	/*
+	 * only dsk_trk_job is changed here, so several tracks may be
+	 * encoded at the same time
+	 */
+
+	if (! dsk_trk->fmt_dsc->track_write(&dsk_trk->fmt, &dsk_trk_job->ffo_src, dsk_trk_job->dsk_sct, &dsk_trk_job->ffo_dst, dsk_trk_job->data, dsk_trk_job->cwtool_track, dsk_trk_job->format_track, dsk_trk_job->format_side)) dsk_trk_job->flags |= JOB_FLAG_FAILED;
+	}
+
+
+
+/****************************************************************************
+ * disk_track_write_verify
+ ****************************************************************************/
+static cw_bool_t
+disk_track_write_verify(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	union image			*img_vfy,
+	struct disk_track_job		*dsk_trk_job,
+	struct disk_sector		*dsk_sct)
+
+	{
+	struct disk_track		*dsk_trk = &dsk->trk[dsk_trk_job->cwtool_track];
+	struct container		*con;
+	unsigned char			*data_src;
+	unsigned char			*data_dst;
+	struct fifo			ffo_src;
+	struct fifo			ffo_dst;
+	cw_bool_t			result = CW_BOOL_TRUE;
+	int				sectors, i;
+
+	/*
+	 * read the track again while the head is still there and decode
+	 * it. dsk_sct gets the errors of the decoded sectors, a sector
+	 * with other content than written counts as checksum error. the
+	 * data pointers of dsk_sct are only valid within this function.
+	 * on write the sectors in dsk_trk_job->dsk_sct are shuffled
+	 * according to skew and interleave, so the written data is found
+	 * by the offset of each sector
+	 */
+
+	sectors  = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	data_src = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	data_dst = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	ffo_src  = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	ffo_dst  = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
+	disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0);
+	if (! dsk->img_dsc_l0->track_read(img_vfy, &dsk_trk->img_trk, &ffo_src, NULL, 0, dsk_trk_job->cwtool_track)) goto done;
+	con = container_init(scratch_alloc(sizeof (struct container)));
+	pthread_cleanup_push(disk_cleanup_container, con);
+	pool_enter(dsk_opt->pol);
+	pthread_cleanup_push(disk_cleanup_pool, dsk_opt->pol);
+	if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, &ffo_src, &ffo_dst, dsk_sct, dsk_trk_job->cwtool_track, dsk_trk_job->format_track, dsk_trk_job->format_side)) error_message("data too long on track %d", dsk_trk_job->cwtool_track);
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
+	scratch_free(con);
+	for (i = 0; i < sectors; i++)
+		{
+		if ((dsk_sct[i].err.errors == 0) && (memcmp(dsk_sct[i].data, &dsk_trk_job->data_src[dsk_sct[i].offset], dsk_sct[i].size) != 0))
+			{
+			dsk_sct[i].err.flags |= DISK_ERROR_FLAG_CHECKSUM;
+			dsk_sct[i].err.errors++;
+			}
+		if (dsk_sct[i].err.errors > 0) result = CW_BOOL_FALSE;
+		}
+done:
+	scratch_free(data_dst);
+	scratch_free(data_src);
+	return (result);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_write_finish
+ ****************************************************************************/
+static void
+disk_track_write_finish(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	union image			*img_dst,
+	union image			*img_vfy,
+	struct disk_track_job		*dsk_trk_job)
+
+	{
+	struct disk_track		*dsk_trk = &dsk->trk[dsk_trk_job->cwtool_track];
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	struct disk_sector		*dsk_sct_nfo = dsk_trk_job->dsk_sct;
+	cw_count_t			cwtool_track = dsk_trk_job->cwtool_track;
+	int				w;
+
+	if (! (dsk_trk_job->flags & JOB_FLAG_ENCODE)) return;
+	if (dsk_trk_job->flags & JOB_FLAG_FAILED) error_message("data too long on track %d", cwtool_track);
+
+	/*
+	 * greedy formats (like raw) can not be verified, they need the
+	 * data of more than one track. tracks without sectors (like with
+	 * format fill) are not verified either
+	 */
+
+	if ((img_vfy != NULL) && (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY)) img_vfy = NULL;
+	if ((img_vfy != NULL) && (dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt) == 0)) img_vfy = NULL;
+	for (w = 0; ; w++)
+		{
+
+		/*
+		 * if this track is optional and we could not write it,
+		 * because the drive only supports double steps, we simply
+		 * continue with the next track
+		 */
+
+		if (! dsk->img_dsc_l0->track_write(img_dst, &dsk_trk->img_trk, &dsk_trk_job->ffo_dst, NULL, 0, cwtool_track)) return;
+		if (img_vfy == NULL) break;
+		if (w == 0) dsk_nfo->sum.verified++;
+
+		/*
+		 * the sectors found while verifying are reported, so bad
+		 * sectors are shown if the last rewrite also failed
+		 */
+
+		dsk_sct_nfo = dsk_sct;
+		if (disk_track_write_verify(dsk, dsk_opt, img_vfy, dsk_trk_job, dsk_sct)) break;
+		dsk_nfo->sum.verify_failed++;
+		if (w >= options_get_write_verify_retry()) break;
+		verbose_message(GENERIC, 1, "verify of track %d failed, writing it again", cwtool_track);
+		}
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct_nfo, cwtool_track, 0, 0, 1);
+	if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read
+ * disk_track_write
  ****************************************************************************/
 static void
-disk_track_read(
+disk_track_write(
 	struct disk			*dsk,
 	struct disk_option		*dsk_opt,
 	struct disk_info		*dsk_nfo,
-	char				**path_src,
-	union image			**img_src,
-	int				img_src_count,
+	struct disk_track_buffer	*dsk_trk_buf,
+	union image			*img_src,
 	union image			*img_dst,
-	struct file			*fil_output,
+	union image			*img_vfy,
 	cw_index_t			trackmap_index)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	cw_count_t			cwtool_track;
-
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-
-	/* skip this track if no format is defined */
+	struct disk_track_job		dsk_trk_job = { };
 
-	if (dsk_trk->fmt_dsc == NULL) return;
-	debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
-	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) disk_track_read_greedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
-	else disk_track_read_nongreedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
+	dsk_trk_job.data_src = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	dsk_trk_job.data_dst = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	if (disk_track_write_prepare(dsk, dsk_trk_buf, img_src, &dsk_trk_job, trackmap_index))
+		{
+		disk_track_write_encode(dsk, &dsk_trk_job);
+		disk_track_write_finish(dsk, dsk_opt, dsk_nfo, img_dst, img_vfy, &dsk_trk_job);
+		}
+	scratch_free(dsk_trk_job.data_dst);
+	scratch_free(dsk_trk_job.data_src);
 	}
 
 
 
 /****************************************************************************
- * disk_write_data_size
+ * disk_write_thread
  ****************************************************************************/
-static cw_size_t
-disk_write_data_size(
-	struct disk			*dsk)
+static void *
+disk_write_thread(
+	void				*arg)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	cw_bool_t			needed = CW_BOOL_FALSE;
-	cw_count_t			entries;
-	cw_index_t			i, ct;
-	cw_count_t			o;
-	cw_size_t			s, size = 0;
+	struct disk_write_queue		*dsk_wr_que = (struct disk_write_queue *) arg;
+	struct disk_write_worker	dsk_wr_wrk = { .dsk_wr_que = dsk_wr_que };
+	struct disk_track_job		*dsk_trk_job;
 
-	entries = trackmap_entries(dsk->trm);
-	for (i = 0; i < entries; i++)
+	/*
+	 * jobs are taken in order, so the writing thread always gets
+	 * the failed job, even if no encoder thread is left
+	 */
+
+	error_set_thread_exit(CW_BOOL_TRUE);
+	pthread_mutex_lock(&dsk_wr_que->mutex);
+	while (1)
 		{
-		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
-		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-		dsk_trk = &dsk->trk[ct];
-		if (dsk_trk->fmt_dsc == NULL) continue;
-		if (dsk_trk->fmt_dsc->get_data_offset == NULL) continue;
-		if (dsk_trk->fmt_dsc->get_data_size == NULL) continue;
-		o = dsk_trk->fmt_dsc->get_data_offset(&dsk_trk->fmt);
-		s = dsk_trk->fmt_dsc->get_data_size(&dsk_trk->fmt);
-		if ((o >= 0) && (s >= 0)) needed = CW_BOOL_TRUE;
-		size += dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1);
+		while ((! dsk_wr_que->stop) && (dsk_wr_que->next >= dsk_wr_que->queued)) pthread_cond_wait(&dsk_wr_que->cond, &dsk_wr_que->mutex);
+		if (dsk_wr_que->stop) break;
+		dsk_trk_job = dsk_wr_que->dsk_trk_job[dsk_wr_que->next++];
+		pthread_mutex_unlock(&dsk_wr_que->mutex);
+		if (dsk_trk_job->flags & JOB_FLAG_ENCODE)
+			{
+			dsk_wr_wrk.dsk_trk_job = dsk_trk_job;
+			pthread_cleanup_push(disk_cleanup_write_worker, &dsk_wr_wrk);
+			pool_enter(dsk_wr_que->pol);
+			pthread_cleanup_push(disk_cleanup_pool, dsk_wr_que->pol);
+			disk_track_write_encode(dsk_wr_que->dsk, dsk_trk_job);
+			pthread_cleanup_pop(1);
+			pthread_cleanup_pop(0);
+			}
+		pthread_mutex_lock(&dsk_wr_que->mutex);
+		dsk_trk_job->flags |= JOB_FLAG_DONE;
+		pthread_cond_broadcast(&dsk_wr_que->cond);
 		}
-	if (! needed) size = 0;
-	return (size);
+	pthread_mutex_unlock(&dsk_wr_que->mutex);
+	return (NULL);
 	}
 
 
 
 /****************************************************************************
- * disk_write_data_get
+ * disk_write_pipelined
  ****************************************************************************/
-static cw_void_t
-disk_write_data_get(
+static void
+disk_write_pipelined(
 	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
 	struct disk_track_buffer	*dsk_trk_buf,
-	union image			*img)
+	union image			*img_src,
+	union image			*img_dst,
+	union image			*img_vfy,
+	cw_index_t			*order,
+	cw_count_t			entries,
+	cw_count_t			threads)
 
 	{
-	unsigned char			*data = dsk_trk_buf[0].data;
-	cw_size_t			size = dsk_trk_buf[0].size;
-	cw_count_t			entries;
-	cw_index_t			i, j, ct, it;
-	cw_size_t			s;
+	struct disk_write_queue		dsk_wr_que = { .dsk = dsk, .pol = dsk_opt->pol };
+	struct disk_track_job		*dsk_trk_job;
+	cw_count_t			ahead = 2 * threads;
+	cw_index_t			i, r;
 
-	entries = trackmap_entries(dsk->trm);
-	for (i = j = 0; i < entries; i++)
-		{
-		struct trackmap_entry	*trm_ent;
-		struct disk_track	*dsk_trk;
-		struct disk_sector	dsk_sct[GLOBAL_NR_SECTORS] = { };
-		unsigned char		data_tmp[GLOBAL_MAX_TRACK_SIZE] = { };
-		struct fifo		ffo_tmp = FIFO_INIT(data_tmp, sizeof (data_tmp));
+	/*
+	 * at most ahead tracks are read and encoded before they are
+	 * written, this limits the needed memory. the writing is done by
+	 * this thread, so img_dst only has to wait for the device
+	 */
 
-		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
-		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-		it = trackmap_entry_get_image_track(dsk->trm, trm_ent);
-		dsk_trk = &dsk->trk[ct];
-		if (dsk_trk->fmt_dsc == NULL) continue;
-		disk_sectors_init(dsk_sct, dsk_trk, &ffo_tmp, 1);
-		if (fifo_get_limit(&ffo_tmp) == 0) continue;
-		dsk->img_dsc->track_read(
-			img,
-			&dsk_trk->img_trk,
-			&ffo_tmp,
-			dsk_sct,
-			dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt),
-			it);
-		s = fifo_get_wr_ofs(&ffo_tmp);
-		if (s == 0) continue;
-		error_condition(j + s > size);
-		dsk_trk_buf[ct + 1] = (struct disk_track_buffer)
+	verbose_message(GENERIC, 1, "encoding tracks with %d threads", threads);
+	if (pthread_mutex_init(&dsk_wr_que.mutex, NULL) != 0) error_message("error while initializing write queue mutex");
+	if (pthread_cond_init(&dsk_wr_que.cond, NULL) != 0) error_message("error while initializing write queue condition");
+	pthread_cleanup_push(disk_cleanup_write_queue, &dsk_wr_que);
+	for (i = 0; i < threads; i++)
+		{
+		if (pthread_create(&dsk_wr_que.thread[i], NULL, disk_write_thread, &dsk_wr_que) != 0) error_message("error while creating thread");
+		dsk_wr_que.threads++;
+		}
+	for (i = r = 0; i < entries; i++)
+		{
+		for ( ; (r < entries) && (r < i + ahead); r++)
 			{
-			.data = &data[j],
-			.size = s
-			};
-		memcpy(&data[j], fifo_get_data(&ffo_tmp), s);
-		j += s;
+			/*
+			 * the buffers of a job travel between threads, so
+			 * they are allocated here and not by scratch_alloc()
+			 */
+
+			dsk_trk_job = calloc(1, sizeof (struct disk_track_job));
+			if (dsk_trk_job == NULL) error_oom();
+			dsk_wr_que.dsk_trk_job[r] = dsk_trk_job;
+			dsk_trk_job->data_src = malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+			dsk_trk_job->data_dst = malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+			if ((dsk_trk_job->data_src == NULL) || (dsk_trk_job->data_dst == NULL)) error_oom();
+			disk_track_write_prepare(dsk, dsk_trk_buf, img_src, dsk_trk_job, order[r]);
+			pthread_mutex_lock(&dsk_wr_que.mutex);
+			dsk_wr_que.queued++;
+			pthread_cond_broadcast(&dsk_wr_que.cond);
+			pthread_mutex_unlock(&dsk_wr_que.mutex);
+			}
+		dsk_trk_job = dsk_wr_que.dsk_trk_job[i];
+		pthread_mutex_lock(&dsk_wr_que.mutex);
+		while (! (dsk_trk_job->flags & JOB_FLAG_DONE)) pthread_cond_wait(&dsk_wr_que.cond, &dsk_wr_que.mutex);
+		pthread_mutex_unlock(&dsk_wr_que.mutex);
+		if (dsk_trk_job->flags & JOB_FLAG_ERROR) error_forward(dsk_trk_job->error);
+		disk_track_write_finish(dsk, dsk_opt, dsk_nfo, img_dst, img_vfy, dsk_trk_job);
+		disk_track_job_free(dsk_trk_job);
+		dsk_wr_que.dsk_trk_job[i] = NULL;
 		}
+	pthread_cleanup_pop(1);
 	}
 
 
 
 /****************************************************************************
- * disk_track_write
+ * disk_write_tracks
  ****************************************************************************/
 static void
-disk_track_write(
+disk_write_tracks(
 	struct disk			*dsk,
 	struct disk_option		*dsk_opt,
 	struct disk_info		*dsk_nfo,
 	struct disk_track_buffer	*dsk_trk_buf,
 	union image			*img_src,
 	union image			*img_dst,
-	cw_index_t			trackmap_index)
+	union image			*img_vfy,
+	cw_index_t			*order,
+	cw_count_t			entries)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			*data = NULL;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
-	int				offset, size;
-	cw_count_t			cwtool_track, image_track, format_track, format_side;
-
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
-	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
-	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-
-	/* skip this track if no format is defined */
-
-	if (dsk_trk->fmt_dsc == NULL) return;
-	disk_sectors_init(dsk_sct, dsk_trk, &ffo_src, 1);
-	debug_error_condition(dsk_trk->fmt_dsc->track_write == NULL);
-
-	/*
-	 * skip this track if we got 0 bytes but expected more than
-	 * that from the image reader, but this will currently
-	 * not happen. with format fill also 0 bytes are
-	 * expected, so in this case we do not skip this track
-	 */
+	cw_count_t			threads = options_get_encode_threads();
+	cw_index_t			i;
 
-	if (fifo_get_limit(&ffo_src) > 0)
-		{
-		if (dsk_trk_buf != NULL)
-			{
+	/* encode_threads == 0 means one thread for each online cpu */
 
-			/*
-			 * get data from dsk_trk_buf. dsk_trk_buf[0]
-			 * contains size for while image
-			 */
+	if (threads == 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > GLOBAL_NR_THREADS) threads = GLOBAL_NR_THREADS;
+	if ((threads > 1) && (entries > 1)) disk_write_pipelined(dsk, dsk_opt, dsk_nfo, dsk_trk_buf, img_src, img_dst, img_vfy, order, entries, threads);
+	else for (i = 0; i < entries; i++) disk_track_write(dsk, dsk_opt, dsk_nfo, dsk_trk_buf, img_src, img_dst, img_vfy, order[i]);
+	}
 
-			offset = dsk_trk->fmt_dsc->get_data_offset(&dsk_trk->fmt);
-			size   = dsk_trk->fmt_dsc->get_data_size(&dsk_trk->fmt);
-			if (offset + size > dsk_trk_buf[0].size) data = NULL;
-			else data = &dsk_trk_buf[0].data[offset];
-			fifo_write_block(
-				&ffo_src,
-				dsk_trk_buf[cwtool_track + 1].data,
-				dsk_trk_buf[cwtool_track + 1].size);
-			}
-		else dsk->img_dsc->track_read(img_src, &dsk_trk->img_trk, &ffo_src, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
-		if (fifo_get_wr_ofs(&ffo_src) == 0) return;
-		}
 
-	/*
-	 * if this track is not within the wanted range, do no encoding and
-	 * do not write to img_dsc_l0
-	 */
-	
-	if (cwtool_track < options_get_disk_track_start()) return;
-	if (cwtool_track > options_get_disk_track_end()) return;
 
-	/* encode the data */
+/****************************************************************************
+ * disk_sector_wanted
+ ****************************************************************************/
+static cw_bool_t
+disk_sector_wanted(
+	struct disk_sector		*dsk_sct)
 
-	if (! dsk_trk->fmt_dsc->track_write(&dsk_trk->fmt, &ffo_src, dsk_sct, &ffo_dst, data, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	{
+	if (options_get_exhaustive_read()) return (CW_BOOL_TRUE);
+	if (dsk_sct->err.errors > 0) return (CW_BOOL_TRUE);
+	if (dsk_sct->err.warnings > 0) return (CW_BOOL_TRUE);
 
 	/*
-	 * if this track is optional and we could not write it,
-	 * because the drive only supports double steps, we simply
-	 * continue with the next track
+	 * a sector without errors and warnings can not be replaced by a
+	 * better one in disk_sector_read(), so decoders do not need to
+	 * decode its data again on further retries. with exhaustive_read
+	 * all sectors are decoded every time
 	 */
 
-	if (! dsk->img_dsc_l0->track_write(img_dst, &dsk_trk->img_trk, &ffo_dst, NULL, 0, cwtool_track)) return;
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, 0, 0, 1);
-	if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+	return (CW_BOOL_FALSE);
 	}
 
 
 
-
 /****************************************************************************
  *
  * global functions
@@ -1303,6 +2836,20 @@ disk_set_timeout_write(
 
 
 
+/****************************************************************************
+ * disk_set_revolutions
+ ****************************************************************************/
+int
+disk_set_revolutions(
+	struct disk_track		*dsk_trk,
+	int				revolutions)
+
+	{
+	return (setvalue_uchar(&dsk_trk->img_trk.revolutions, revolutions, 0, GLOBAL_NR_REVOLUTIONS));
+	}
+
+
+
 /****************************************************************************
  * disk_set_read_option
  ****************************************************************************/
@@ -1572,6 +3119,61 @@ disk_sector_read(
 
 
 
+/****************************************************************************
+ * disk_sector_skip
+ ****************************************************************************/
+cw_bool_t
+disk_sector_skip(
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				sector,
+	struct container		*con)
+
+	{
+
+	/*
+	 * returns CW_BOOL_TRUE if decoders may skip the data field of
+	 * sector. decoders call this only after the checksum of the sector
+	 * header was verified, so a corrupt sector number never skips a
+	 * wanted sector. if a container is given all ranges are needed, so
+	 * nothing is skipped then
+	 */
+
+	if ((con != NULL) || (sector < 0) || (sector >= sectors)) return (CW_BOOL_FALSE);
+	if (disk_sector_wanted(&dsk_sct[sector])) return (CW_BOOL_FALSE);
+	verbose_message(GENERIC, 1, "skipping sector %d, already read without errors", sector);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_sectors_wanted
+ ****************************************************************************/
+cw_bool_t
+disk_sectors_wanted(
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	struct container		*con)
+
+	{
+	int				i;
+
+	/*
+	 * returns CW_BOOL_FALSE if all sectors are already read without
+	 * errors, decoders stop scanning the remaining track data then.
+	 * captures usually contain more than one revolution, so this saves
+	 * decoding the further ones. if a container is given, ranges of
+	 * all sectors are needed, so everything is read
+	 */
+
+	if (con != NULL) return (CW_BOOL_TRUE);
+	for (i = 0; i < sectors; i++) if (disk_sector_wanted(&dsk_sct[i])) return (CW_BOOL_TRUE);
+	return (CW_BOOL_FALSE);
+	}
+
+
+
 /****************************************************************************
  * disk_sector_write
  ****************************************************************************/
@@ -1596,7 +3198,10 @@ disk_statistics(
 	char				*path)
 
 	{
-	union image			img;
+	union image			*img = NULL;
+	struct disk_images		dsk_img = { .img_dsc = dsk->img_dsc_l0, .img = &img, .entries = 1 };
+	struct statistics		stt, *p_stt = NULL;
+	cw_mode_t			format = options_get_statistics_format();
 	cw_count_t			entries;
 	cw_index_t			i;
 
@@ -1606,16 +3211,32 @@ disk_statistics(
 
 	/* open image */
 
-	dsk->img_dsc_l0->open(&img, path, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
+	pthread_cleanup_push(disk_cleanup_images, &dsk_img);
+	img = (union image *) malloc(sizeof (union image));
+	if (img == NULL) error_oom();
+	dsk->img_dsc_l0->open(img, path, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
 
-	/* iterate over all defined tracks */
+	/*
+	 * iterate over all defined tracks. the machine readable formats
+	 * first collect the raw data of all tracks and analyze them in
+	 * parallel afterwards
+	 */
 
 	entries = trackmap_entries(dsk->trm);
-	for (i = 0; i < entries; i++) disk_track_statistics(dsk, &img, i);
+	if (format != OPTIONS_STATISTICS_FORMAT_TEXT) statistics_init(p_stt = &stt, entries);
+	pthread_cleanup_push(disk_cleanup_statistics, p_stt);
+	for (i = 0; i < entries; i++) disk_track_statistics(dsk, img, p_stt, i);
 
 	/* close image */
 
-	dsk->img_dsc_l0->close(&img);
+	dsk->img_dsc_l0->close(img);
+	if (p_stt != NULL)
+		{
+		statistics_calculate(&stt, options_get_decode_threads());
+		statistics_print(&stt, dsk->name, format);
+		}
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
 
 	/* done */
 
@@ -1624,6 +3245,49 @@ disk_statistics(
 
 
 
+/****************************************************************************
+ * disk_probe
+ ****************************************************************************/
+int
+disk_probe(
+	struct disk_probe		*dsk_prb,
+	int				disks,
+	char				*path,
+	struct statistics		*stt)
+
+	{
+	struct disk_probe_captures	dsk_prb_cps = { };
+	cw_index_t			i, j, s;
+
+	/*
+	 * only the first track of each side is decoded with each disk,
+	 * the score is given in 1/10 percent. a good sector counts twice
+	 * as much as a sector with errors, a sector not found counts
+	 * nothing
+	 */
+
+	for (i = 0; i < disks; i++)
+		{
+		debug_error_condition(dsk_prb[i].dsk->img_dsc_l0->open == NULL);
+		debug_error_condition(dsk_prb[i].dsk->img_dsc_l0->close == NULL);
+		debug_error_condition(dsk_prb[i].dsk->img_dsc_l0->track_read == NULL);
+		for (s = 0; s < 2; s++)
+			{
+			j = disk_probe_side(dsk_prb[i].dsk, s);
+			if (j != -1) disk_probe_track(&dsk_prb[i], &dsk_prb_cps, stt, path, j);
+			}
+		if (dsk_prb[i].sectors == 0) continue;
+		dsk_prb[i].score = 500 * (dsk_prb[i].sectors_good + dsk_prb[i].sectors_found) / dsk_prb[i].sectors;
+		}
+	for (i = 0; i < dsk_prb_cps.captures; i++) free(dsk_prb_cps.dsk_prb_cap[i].data);
+
+	/* done */
+
+	return (dsk_prb_cps.captures);
+	}
+
+
+
 /****************************************************************************
  * disk_read
  ****************************************************************************/
@@ -1645,10 +3309,13 @@ disk_read(
 	 * on the stack and malloc each struct image later
 	 */
 
-	struct disk_info		dsk_nfo = { };
-	union image			*img_src[GLOBAL_NR_IMAGES], img_dst;
+	struct disk_info		dsk_nfo = { .job = dsk_opt->job };
+	union image			*img_src[GLOBAL_NR_IMAGES] = { }, img_dst;
+	struct disk_images		dsk_img = { .img_dsc = dsk->img_dsc_l0, .img = img_src, .entries = GLOBAL_NR_IMAGES };
 	struct file			fil;
 	struct file			*fil_output = NULL;
+	struct disk_commit		dsk_cmt = { };
+	struct timeval			tv;
 	cw_count_t			entries;
 	cw_index_t			i;
 
@@ -1661,6 +3328,8 @@ disk_read(
 
 	/* open images */
 
+	pthread_cleanup_push(disk_cleanup_images, &dsk_img);
+	pthread_cleanup_push(disk_cleanup_commit, &dsk_cmt);
 	for (i = 0; i < path_src_count; i++)
 		{
 		img_src[i] = (union image *) malloc(sizeof (union image));
@@ -1668,19 +3337,30 @@ disk_read(
 		dsk->img_dsc_l0->open(img_src[i], path_src[i], IMAGE_MODE_READ, IMAGE_FLAG_NONE);
 		}
 	dsk->img_dsc->open(&img_dst, path_dst, IMAGE_MODE_WRITE, IMAGE_FLAG_NONE);
+	disk_commit_init(dsk, dsk_opt, &dsk_cmt, &img_dst, path_dst);
 
 	/* open output file for raw bad sectors */
 
 	if (path_output != NULL)
 		{
 		file_open(&fil, path_output, FILE_MODE_CREATE, FILE_FLAG_NONE);
+		if (options_get_output_binary()) dump_write_magic(&fil);
 		fil_output = &fil;
 		}
 
-	/* iterate over all tracks */
+	/*
+	 * iterate over all tracks, with seek_optimize in the order of the
+	 * tracks on the device if possible
+	 */
 
-	entries = trackmap_entries(dsk->trm);
-	for (i = 0; i < entries; i++) disk_track_read(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output, i);
+	disk_summary_start(&dsk_nfo.sum, &tv);
+	if (! disk_read_scheduled(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output, &dsk_cmt))
+		{
+		entries = trackmap_entries(dsk->trm);
+		for (i = 0; i < entries; i++) disk_track_read(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output, &dsk_cmt, i);
+		}
+	for (i = 0; i < path_src_count; i++) disk_summary_steps(&dsk_nfo.sum, dsk->img_dsc_l0, img_src[i]);
+	disk_summary_stop(&dsk_nfo.sum, &tv);
 	if (dsk_opt->info_func != NULL) dsk_opt->info_func(&dsk_nfo, 1);
 
 	/* close output file */
@@ -1689,12 +3369,11 @@ disk_read(
 
 	/* close images */
 
-	for (i = 0; i < path_src_count; i++)
-		{
-		dsk->img_dsc_l0->close(img_src[i]);
-		free(img_src[i]);
-		}
+	for (i = 0; i < path_src_count; i++) dsk->img_dsc_l0->close(img_src[i]);
 	dsk->img_dsc->close(&img_dst);
+	disk_commit_deinit(&dsk_cmt);
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
 
 	/* done */
 
@@ -1716,8 +3395,11 @@ disk_write(
 	{
 	struct disk_info		dsk_nfo = { };
 	struct disk_track_buffer	dsk_trk_buf[GLOBAL_NR_TRACKS + 1] = { };
-	union image			img_src, img_dst;
+	union image			img_src, img_dst, img_vfy, *p_img_vfy = NULL;
 	int				flags = (dsk_opt->flags & DISK_OPTION_FLAG_IGNORE_SIZE) ? IMAGE_FLAG_IGNORE_SIZE : IMAGE_FLAG_NONE;
+	cw_bool_t			scheduled = CW_BOOL_FALSE;
+	struct timeval			tv;
+	cw_index_t			order[GLOBAL_NR_TRACKS];
 	cw_count_t			entries;
 	cw_index_t			i;
 
@@ -1733,31 +3415,62 @@ disk_write(
 	dsk->img_dsc->open(&img_src, path_src, IMAGE_MODE_READ, flags);
 	dsk->img_dsc_l0->open(&img_dst, path_dst, IMAGE_MODE_WRITE, IMAGE_FLAG_NONE);
 
+	/*
+	 * with write_verify each track is read back through a second
+	 * handle of the device, because img_dst is opened write only
+	 */
+
+	if (options_get_write_verify())
+		{
+		if ((dsk->img_dsc_l0->head_steps != NULL) && (dsk->img_dsc_l0->head_steps(&img_dst) != -1))
+			{
+			p_img_vfy = &img_vfy;
+			dsk->img_dsc_l0->open(p_img_vfy, path_dst, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
+			}
+		else error_warning("write_verify is only possible with a device, '%s' is not verified", path_dst);
+		}
+
+	/*
+	 * with seek_optimize tracks are written in the order of the tracks
+	 * on the device. images can only be read sequentially, so the image
+	 * has to be read into memory first
+	 */
+
+	disk_summary_start(&dsk_nfo.sum, &tv);
+	if ((options_get_seek_optimize() > 0) && (dsk->img_dsc_l0->head_steps != NULL) && (dsk->img_dsc_l0->head_steps(&img_dst) != -1)) scheduled = CW_BOOL_TRUE;
+	entries = trackmap_entries(dsk->trm);
+	for (i = 0; i < entries; i++) order[i] = i;
+	if (scheduled) disk_track_order(dsk, &img_dst, order);
+
 	/*
 	 * if a format wants specific data from an image, the image is read
 	 * first completely and stored into memory
 	 */
 
-	entries = trackmap_entries(dsk->trm);
-	dsk_trk_buf[0].size = disk_write_data_size(dsk);
+	dsk_trk_buf[0].size = disk_write_data_size(dsk, scheduled);
 	if (dsk_trk_buf[0].size > 0)
 		{
 		dsk_trk_buf[0].data = malloc(dsk_trk_buf[0].size * sizeof (unsigned char));
 		if (dsk_trk_buf[0].data == NULL) error_oom();
+		pthread_cleanup_push(disk_cleanup_free, dsk_trk_buf[0].data);
 		disk_write_data_get(dsk, dsk_trk_buf, &img_src);
-		for (i = 0; i < entries; i++) disk_track_write(dsk, dsk_opt, &dsk_nfo, dsk_trk_buf, NULL, &img_dst, i);
-		free(dsk_trk_buf[0].data);
+		disk_write_tracks(dsk, dsk_opt, &dsk_nfo, dsk_trk_buf, NULL, &img_dst, p_img_vfy, order, entries);
+		pthread_cleanup_pop(1);
 		}
 	else
 		{
-		for (i = 0; i < entries; i++) disk_track_write(dsk, dsk_opt, &dsk_nfo, NULL, &img_src, &img_dst, i);
+		for (i = 0; i < entries; i++) order[i] = i;
+		disk_write_tracks(dsk, dsk_opt, &dsk_nfo, NULL, &img_src, &img_dst, p_img_vfy, order, entries);
 		}
+	disk_summary_steps(&dsk_nfo.sum, dsk->img_dsc_l0, &img_dst);
+	disk_summary_stop(&dsk_nfo.sum, &tv);
 	if (dsk_opt->info_func != NULL) dsk_opt->info_func(&dsk_nfo, 1);
 
 	/* close images */
 
 	dsk->img_dsc->close(&img_src);
 	dsk->img_dsc_l0->close(&img_dst);
+	if (p_img_vfy != NULL) dsk->img_dsc_l0->close(p_img_vfy);
 
 	/* done */
 
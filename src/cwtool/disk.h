@@ -33,6 +33,7 @@ struct disk_track
 #define DISK_INIT(r)			(struct disk) { .revision = r }
 
 struct trackmap;
+struct container;
 
 #define DISK_FLAG_TRACKMAP_SET		(1 << 0)
 
@@ -84,6 +85,10 @@ struct disk_summary
 	int				sectors_good;
 	int				sectors_weak;
 	int				sectors_bad;
+	int				steps;
+	int				milliseconds;
+	int				verified;
+	int				verify_failed;
 	};
 
 struct disk_sector_info
@@ -95,11 +100,13 @@ struct disk_sector_info
 struct disk_info
 	{
 	char				path[GLOBAL_MAX_PATH_SIZE];
+	int				job;
 	int				track;
 	int				try;
 	int				sectors_good;
 	int				sectors_weak;
 	int				sectors_bad;
+	int				dumped_tracks;
 	struct disk_summary		sum;
 	struct disk_sector_info		sct_nfo[GLOBAL_NR_TRACKS][GLOBAL_NR_SECTORS];
 	};
@@ -107,12 +114,37 @@ struct disk_info
 #define DISK_OPTION_INIT(i, r, f)	(struct disk_option) { .info_func = i, .retry = r, .flags = f }
 #define DISK_OPTION_FLAG_NONE		0
 #define DISK_OPTION_FLAG_IGNORE_SIZE	(1 << 0)
+#define DISK_OPTION_FLAG_RESUME		(1 << 1)
+
+struct pool;
 
 struct disk_option
 	{
 	void				(*info_func)(struct disk_info *, int);
 	int				retry;
 	int				flags;
+	int				job;
+	struct pool			*pol;
+	};
+
+/*
+ * result of disk_probe() for one disk, a sector is found if the decoder
+ * got its header. the score is given in 1/10 percent
+ */
+
+#define DISK_PROBE_NR_CAPTURES		16
+
+struct statistics;
+
+struct disk_probe
+	{
+	struct disk			*dsk;
+	int				index;
+	int				tracks;
+	int				sectors;
+	int				sectors_good;
+	int				sectors_found;
+	int				score;
 	};
 
 extern struct disk			*disk_get(int);
@@ -138,6 +170,7 @@ extern int				disk_set_clock(struct disk_track *, int);
 extern int				disk_set_side_offset(struct disk_track *, int);
 extern int				disk_set_timeout_read(struct disk_track *, int);
 extern int				disk_set_timeout_write(struct disk_track *, int);
+extern int				disk_set_revolutions(struct disk_track *, int);
 extern int				disk_set_read_option(struct disk_track *, struct format_option *, int, int);
 extern int				disk_set_write_option(struct disk_track *, struct format_option *, int, int);
 extern int				disk_set_rw_option(struct disk_track *, struct format_option *, int, int);
@@ -155,8 +188,11 @@ extern struct format_option		*disk_get_rw_options(struct disk_track *);
 extern int				disk_error_add(struct disk_error *, int, int);
 extern int				disk_warning_add(struct disk_error *, int);
 extern int				disk_sector_read(struct disk_sector *, struct disk_error *, unsigned char *);
+extern cw_bool_t			disk_sector_skip(struct disk_sector *, int, int, struct container *);
+extern cw_bool_t			disk_sectors_wanted(struct disk_sector *, int, struct container *);
 extern int				disk_sector_write(unsigned char *, struct disk_sector *);
 extern int				disk_statistics(struct disk *, char *);
+extern int				disk_probe(struct disk_probe *, int, char *, struct statistics *);
 extern int				disk_read(struct disk *, struct disk_option *, char **, int, char *, char *);
 extern int				disk_write(struct disk *, struct disk_option *, char *, char *);
 
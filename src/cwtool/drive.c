@@ -11,6 +11,8 @@
 
 
 #include <stdio.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 
 #include "drive.h"
 #include "error.h"
@@ -288,4 +290,28 @@ drive_init_all_devices(
 	for (i = 0; (drv = drive_get(i)) != NULL; i++) drive_init_device(drv);
 	return (1);
 	}
+
+
+
+/****************************************************************************
+ * drive_get_controller
+ ****************************************************************************/
+int
+drive_get_controller(
+	const char			*path)
+
+	{
+	struct stat			st;
+
+	/*
+	 * the minor number of a catweasel device contains the controller
+	 * in bits 6 and 7 (see get_controller() in driver/floppy.c).
+	 * return -1 if path is no character device, this is the case
+	 * for regular files and pipes
+	 */
+
+	if (stat(path, &st) == -1) return (-1);
+	if (! S_ISCHR(st.st_mode)) return (-1);
+	return ((minor(st.st_rdev) >> 6) & (CW_NR_CONTROLLERS - 1));
+	}
 /******************************************************** Karsten Scheibler */
@@ -37,6 +37,7 @@ extern int				drive_set_flag(struct drive *, int, int);
 extern const char			*drive_get_path(struct drive *);
 extern const char			*drive_get_info(struct drive *);
 extern int				drive_init_all_devices(void);
+extern int				drive_get_controller(const char *);
 
 #define drive_set_inverted_diskchange(d, v)	drive_set_flag(d, v, CW_FLOPPYINFO_FLAG_INVERTED_DISKCHANGE)
 #define drive_set_ignore_diskchange(d, v)	drive_set_flag(d, v, CW_FLOPPYINFO_FLAG_IGNORE_DISKCHANGE)
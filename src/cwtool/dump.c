@@ -0,0 +1,423 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * dump.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dump.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "file.h"
+#include "import.h"
+#include "export.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define BUFFER_SIZE			0x10000
+#define LINE_SIZE			16
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * dump_line
+ ****************************************************************************/
+static cw_count_t
+dump_line(
+	cw_char_t			*string,
+	cw_raw8_t			data,
+	cw_raw8_t			error,
+	cw_raw8_t			length)
+
+	{
+	static const cw_char_t		hex[] = "0123456789abcdef";
+	cw_index_t			i = 0;
+
+	/*
+	 * same as string_snprintf(string, size, "%02x # %2d %d\n", data &
+	 * GLOBAL_PULSE_LENGTH_MASK, error, length), but much faster. all
+	 * values are unsigned bytes, so LINE_SIZE bytes are sufficient
+	 */
+
+	data &= GLOBAL_PULSE_LENGTH_MASK;
+	string[i++] = hex[data >> 4];
+	string[i++] = hex[data & 0xf];
+	string[i++] = ' ';
+	string[i++] = '#';
+	string[i++] = ' ';
+	if (error >= 100) string[i++] = '0' + error / 100;
+	if (error >= 10) string[i++] = '0' + error / 10 % 10;
+	else string[i++] = ' ';
+	string[i++] = '0' + error % 10;
+	string[i++] = ' ';
+	if (length >= 100) string[i++] = '0' + length / 100;
+	if (length >= 10) string[i++] = '0' + length / 10 % 10;
+	string[i++] = '0' + length % 10;
+	string[i++] = '\n';
+	return (i);
+	}
+
+
+
+/****************************************************************************
+ * dump_write_lines
+ ****************************************************************************/
+static cw_void_t
+dump_write_lines(
+	struct file			*fil,
+	struct dump_track		*dmp_trk,
+	struct dump_segment		*dmp_seg)
+
+	{
+	cw_char_t			string[BUFFER_SIZE];
+	cw_index_t			i, j;
+
+	for (i = dmp_seg->start, j = 0; i < dmp_seg->end; i++)
+		{
+		j += dump_line(&string[j], dmp_trk->data[i], dmp_trk->error[i], dmp_trk->length[i]);
+		if (j < sizeof (string) - LINE_SIZE) continue;
+		file_write(fil, string, j);
+		j = 0;
+		}
+	if (j > 0) file_write(fil, string, j);
+	}
+
+
+
+/****************************************************************************
+ * dump_write_pulses
+ ****************************************************************************/
+static cw_void_t
+dump_write_pulses(
+	struct file			*fil,
+	struct dump_track		*dmp_trk,
+	struct dump_segment		*dmp_seg)
+
+	{
+	cw_raw8_t			data[BUFFER_SIZE];
+	cw_index_t			i, j;
+
+	for (i = dmp_seg->start, j = 0; i < dmp_seg->end; i++)
+		{
+		data[j++] = dmp_trk->data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		if (j < sizeof (data)) continue;
+		file_write(fil, data, j);
+		j = 0;
+		}
+	if (j > 0) file_write(fil, data, j);
+	}
+
+
+
+/****************************************************************************
+ * dump_get_size
+ ****************************************************************************/
+static cw_size_t
+dump_get_size(
+	struct dump_track		*dmp_trk)
+
+	{
+	cw_size_t			size;
+	cw_index_t			i;
+
+	for (i = size = 0; i < dmp_trk->segments; i++) size += dmp_trk->seg[i].end - dmp_trk->seg[i].start;
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * dump_render_alloc
+ ****************************************************************************/
+static cw_void_t *
+dump_render_alloc(
+	cw_void_t			*data,
+	cw_size_t			size)
+
+	{
+	data = realloc(data, (size > 0) ? size : 1);
+	if (data == NULL) error_oom();
+	return (data);
+	}
+
+
+
+/****************************************************************************
+ * dump_cleanup_free
+ ****************************************************************************/
+static cw_void_t
+dump_cleanup_free(
+	cw_void_t			*arg)
+
+	{
+
+	/*
+	 * pthread cleanup handler, arg points to the pointer, because
+	 * dump_render_alloc() may move the buffer
+	 */
+
+	free(*(cw_void_t **) arg);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * dump_write_magic
+ ****************************************************************************/
+cw_void_t
+dump_write_magic(
+	struct file			*fil)
+
+	{
+	static const cw_char_t		magic[DUMP_MAGIC_SIZE] = DUMP_MAGIC;
+
+	file_write(fil, magic, DUMP_MAGIC_SIZE);
+	}
+
+
+
+/****************************************************************************
+ * dump_write_binary
+ ****************************************************************************/
+cw_void_t
+dump_write_binary(
+	struct file			*fil,
+	struct dump_track		*dmp_trk)
+
+	{
+	struct dump_segment		*dmp_seg;
+	cw_u8_t				header[DUMP_HEADER_SIZE];
+	cw_u8_t				segment[DUMP_SEGMENT_SIZE];
+	cw_index_t			i;
+
+	/* record header and pulses, readable as raw data track */
+
+	header[0] = DUMP_TRACK_MAGIC;
+	header[1] = dmp_trk->track;
+	header[2] = dmp_trk->clock;
+	header[3] = dmp_trk->flags;
+	export_u32_le(&header[4], dump_get_size(dmp_trk));
+	file_write(fil, header, DUMP_HEADER_SIZE);
+	for (i = 0; i < dmp_trk->segments; i++) dump_write_pulses(fil, dmp_trk, &dmp_trk->seg[i]);
+
+	/* index of sector parts, followed by error bytes and lookup lengths */
+
+	memset(header, 0, DUMP_HEADER_SIZE);
+	header[0] = DUMP_INDEX_MAGIC;
+	header[1] = (dmp_trk->first) ? DUMP_FLAG_FIRST : 0;
+	export_u32_le(&header[4], dmp_trk->segments);
+	file_write(fil, header, DUMP_HEADER_SIZE);
+	for (i = 0; i < dmp_trk->segments; i++)
+		{
+		dmp_seg = &dmp_trk->seg[i];
+		memset(segment, 0, DUMP_SEGMENT_SIZE);
+		segment[0] = dmp_seg->type;
+		export_u32_le(&segment[4], dmp_seg->sector);
+		export_u32_le(&segment[8], dmp_seg->occurrence);
+		export_u32_le(&segment[12], dmp_seg->end - dmp_seg->start);
+		file_write(fil, segment, DUMP_SEGMENT_SIZE);
+		}
+	for (i = 0; i < dmp_trk->segments; i++)
+		{
+		dmp_seg = &dmp_trk->seg[i];
+		file_write(fil, &dmp_trk->error[dmp_seg->start], dmp_seg->end - dmp_seg->start);
+		}
+	for (i = 0; i < dmp_trk->segments; i++)
+		{
+		dmp_seg = &dmp_trk->seg[i];
+		file_write(fil, &dmp_trk->length[dmp_seg->start], dmp_seg->end - dmp_seg->start);
+		}
+	}
+
+
+
+/****************************************************************************
+ * dump_write_text
+ ****************************************************************************/
+cw_void_t
+dump_write_text(
+	struct file			*fil,
+	struct dump_track		*dmp_trk)
+
+	{
+	struct dump_segment		*dmp_seg;
+	cw_index_t			i;
+
+	file_write_sprintf(fil, "track_data_hex %d %d %d {\n", dmp_trk->track, dmp_trk->clock, dmp_trk->flags);
+	for (i = 0; i < dmp_trk->segments; i++)
+		{
+		dmp_seg = &dmp_trk->seg[i];
+		if ((i == 0) || (dmp_trk->seg[i - 1].type == DUMP_SEGMENT_DATA))
+			{
+			file_write_sprintf(fil, "##### start track %d sector %d (%d) #####\n", dmp_trk->track, dmp_seg->sector, dmp_seg->occurrence);
+			}
+		if (dmp_seg->type == DUMP_SEGMENT_HEADER)   file_write_string(fil, "### sector header ###\n");
+		else if (dmp_seg->type == DUMP_SEGMENT_GAP) file_write_string(fil, "### sector gap between header and data ###\n");
+		else                                        file_write_string(fil, "### sector data ###\n");
+		dump_write_lines(fil, dmp_trk, dmp_seg);
+		if (dmp_seg->type != DUMP_SEGMENT_DATA) continue;
+		file_write_sprintf(fil, "##### end track %d sector %d (%d) #####\n", dmp_trk->track, dmp_seg->sector, dmp_seg->occurrence);
+		}
+	file_write_string(fil, "}\n");
+	}
+
+
+
+/****************************************************************************
+ * dump_skip_index
+ ****************************************************************************/
+cw_void_t
+dump_skip_index(
+	struct file			*fil,
+	cw_size_t			size)
+
+	{
+	cw_u8_t				header[DUMP_HEADER_SIZE];
+	cw_u8_t				data[BUFFER_SIZE];
+	cw_count_t			segments;
+	cw_size_t			skip, s;
+
+	/*
+	 * the raw image reader only needs the pulses of a record, so
+	 * the following index, error bytes and lookup lengths are read
+	 * and thrown away. this works for pipes as well
+	 */
+
+	file_read_strict(fil, header, DUMP_HEADER_SIZE);
+	if (header[0] != DUMP_INDEX_MAGIC) error_message("wrong index magic in file '%s'", file_get_path(fil));
+	segments = import_u32_le(&header[4]);
+	if ((segments < 0) || (segments > size)) error_message("invalid index in file '%s'", file_get_path(fil));
+	skip = segments * DUMP_SEGMENT_SIZE + 2 * size;
+	while (skip > 0)
+		{
+		s = (skip < sizeof (data)) ? skip : sizeof (data);
+		file_read_strict(fil, data, s);
+		skip -= s;
+		}
+	}
+
+
+
+/****************************************************************************
+ * dump_render
+ ****************************************************************************/
+cw_void_t
+dump_render(
+	struct file			*fil_src,
+	struct file			*fil_dst)
+
+	{
+	static const cw_char_t		magic[DUMP_MAGIC_SIZE] = DUMP_MAGIC;
+	struct dump_track		dmp_trk;
+	cw_char_t			buffer[DUMP_MAGIC_SIZE];
+	cw_u8_t				header[DUMP_HEADER_SIZE];
+	cw_u8_t				segment[DUMP_SEGMENT_SIZE];
+	cw_raw8_t			*data = NULL;
+	struct dump_segment		*seg = NULL;
+	cw_size_t			size, length, s;
+	cw_index_t			i;
+
+	pthread_cleanup_push(dump_cleanup_free, &data);
+	pthread_cleanup_push(dump_cleanup_free, &seg);
+	file_read_strict(fil_src, buffer, DUMP_MAGIC_SIZE);
+	if (memcmp(buffer, magic, DUMP_MAGIC_SIZE) != 0) error_message("file '%s' is not a binary bad sector dump", file_get_path(fil_src));
+	while (1)
+		{
+		s = file_read(fil_src, header, DUMP_HEADER_SIZE);
+		if (s == 0) break;
+		if (s != DUMP_HEADER_SIZE) error_message("file '%s' truncated", file_get_path(fil_src));
+		if (header[0] != DUMP_TRACK_MAGIC) error_message("wrong header magic in file '%s'", file_get_path(fil_src));
+		size = import_u32_le(&header[4]);
+		if ((size < 0) || (size > GLOBAL_MAX_TRACK_SIZE)) error_message("track too large in file '%s'", file_get_path(fil_src));
+		dmp_trk = (struct dump_track)
+			{
+			.track = header[1],
+			.clock = header[2],
+			.flags = header[3],
+			.data  = data = dump_render_alloc(data, 3 * size)
+			};
+		dmp_trk.error  = &data[size];
+		dmp_trk.length = &data[2 * size];
+		file_read_strict(fil_src, dmp_trk.data, size);
+
+		/* index, the segments have to cover the pulses exactly */
+
+		file_read_strict(fil_src, header, DUMP_HEADER_SIZE);
+		if (header[0] != DUMP_INDEX_MAGIC) error_message("wrong index magic in file '%s'", file_get_path(fil_src));
+		dmp_trk.first    = (header[1] & DUMP_FLAG_FIRST) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+		dmp_trk.segments = import_u32_le(&header[4]);
+		if ((dmp_trk.segments < 0) || (dmp_trk.segments > size)) error_message("invalid index in file '%s'", file_get_path(fil_src));
+		dmp_trk.seg = seg = dump_render_alloc(seg, dmp_trk.segments * sizeof (struct dump_segment));
+		for (i = s = 0; i < dmp_trk.segments; i++)
+			{
+			file_read_strict(fil_src, segment, DUMP_SEGMENT_SIZE);
+			length = import_u32_le(&segment[12]);
+			if ((segment[0] > DUMP_SEGMENT_DATA) || (length < 0) || (length > size - s)) error_message("invalid index in file '%s'", file_get_path(fil_src));
+			seg[i] = (struct dump_segment)
+				{
+				.type       = segment[0],
+				.sector     = import_u32_le(&segment[4]),
+				.occurrence = import_u32_le(&segment[8]),
+				.start      = s,
+				.end        = s + length
+				};
+			s = seg[i].end;
+			}
+		if (s != size) error_message("invalid index in file '%s'", file_get_path(fil_src));
+		file_read_strict(fil_src, dmp_trk.error, size);
+		file_read_strict(fil_src, dmp_trk.length, size);
+
+		/*
+		 * records without segments only keep the magic line of a
+		 * track, for which no sector could be dumped
+		 */
+
+		if (dmp_trk.first) file_write_string(fil_dst, "# cwtool raw text 3\n");
+		if (dmp_trk.segments > 0) dump_write_text(fil_dst, &dmp_trk);
+		}
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
+	}
+/******************************************************** Karsten Scheibler */
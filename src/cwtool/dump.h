@@ -0,0 +1,125 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * dump.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_DUMP_H
+#define CWTOOL_DUMP_H
+
+#include "types.h"
+#include "file.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * binary dump of bad sectors. the file starts with DUMP_MAGIC padded to
+ * DUMP_MAGIC_SIZE bytes, followed by one record per container entry
+ * with bad sectors. each record starts with the same 8 byte header and
+ * pulse data as a track in a raw data image, so the raw image reader
+ * only has to skip the appended index:
+ *
+ *   u8  0xca, track, clock, flags, size (u32 le)
+ *   u8  pulses[size]
+ *   u8  0xcb, flags, 0, 0, segments (u32 le)
+ *   segments * { u8 type, 0, 0, 0, sector (u32 le), occurrence (u32 le),
+ *                size (u32 le) }
+ *   u8  errors[size]
+ *   u8  lookup_lengths[size]
+ *
+ * the segments describe consecutive parts of the pulse data in the same
+ * order as they appear in the text output. DUMP_FLAG_FIRST marks the
+ * first record written for a track, the text output starts there with
+ * another magic line
+ */
+
+#define DUMP_MAGIC			"cwtool raw dump 3"
+#define DUMP_MAGIC_SIZE			32
+#define DUMP_TRACK_MAGIC		0xca
+#define DUMP_INDEX_MAGIC		0xcb
+#define DUMP_HEADER_SIZE		8
+#define DUMP_SEGMENT_SIZE		16
+#define DUMP_FLAG_FIRST			(1 << 0)
+
+#define DUMP_SEGMENT_HEADER		0
+#define DUMP_SEGMENT_GAP		1
+#define DUMP_SEGMENT_DATA		2
+
+struct dump_segment
+	{
+	cw_type_t			type;
+	cw_count_t			sector;
+	cw_count_t			occurrence;
+	cw_index_t			start;
+	cw_index_t			end;
+	};
+
+struct dump_track
+	{
+	cw_count_t			track;
+	cw_mode_t			clock;
+	cw_flag_t			flags;
+	cw_bool_t			first;
+	cw_raw8_t			*data;
+	cw_raw8_t			*error;
+	cw_raw8_t			*length;
+	struct dump_segment		*seg;
+	cw_count_t			segments;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+dump_write_magic(
+	struct file			*fil);
+
+extern cw_void_t
+dump_write_binary(
+	struct file			*fil,
+	struct dump_track		*dmp_trk);
+
+extern cw_void_t
+dump_write_text(
+	struct file			*fil,
+	struct dump_track		*dmp_trk);
+
+extern cw_void_t
+dump_skip_index(
+	struct file			*fil,
+	cw_size_t			size);
+
+extern cw_void_t
+dump_render(
+	struct file			*fil_src,
+	struct file			*fil_dst);
+
+
+
+#endif /* !CWTOOL_DUMP_H */
+/******************************************************** Karsten Scheibler */
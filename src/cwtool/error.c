@@ -11,6 +11,7 @@
 
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -22,6 +23,27 @@
 
 
 
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * with cwtool -B each job runs in its own thread. an error should only
+ * terminate this thread and not the whole process, the message is
+ * remembered for the status line of the job
+ */
+
+static __thread cw_bool_t		error_thread_exit;
+static __thread cw_char_t		error_last[ERROR_MESSAGE_SIZE];
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -39,11 +61,59 @@ error_exit(
 	cw_void_t)
 
 	{
+	if (error_thread_exit) pthread_exit(NULL);
 	exit(1);
 	}
 
 
 
+/****************************************************************************
+ * error_set_thread_exit
+ ****************************************************************************/
+cw_void_t
+error_set_thread_exit(
+	cw_bool_t			value)
+
+	{
+	error_thread_exit = value;
+	error_last[0]     = '\0';
+	}
+
+
+
+/****************************************************************************
+ * error_get_last
+ ****************************************************************************/
+const cw_char_t *
+error_get_last(
+	cw_void_t)
+
+	{
+	return (error_last);
+	}
+
+
+
+/****************************************************************************
+ * error_forward
+ ****************************************************************************/
+cw_void_t
+error_forward(
+	const cw_char_t			*message)
+
+	{
+
+	/*
+	 * terminate with an error, which was already printed by another
+	 * thread. message becomes the one returned by error_get_last()
+	 */
+
+	snprintf(error_last, sizeof (error_last), "%s", message);
+	error_exit();
+	}
+
+
+
 /****************************************************************************
  * error_message2
  ****************************************************************************/
@@ -58,19 +128,28 @@ error_message2(
 	{
 	va_list				args;
 	const cw_char_t			empty[] = "";
+	cw_char_t			message[ERROR_MESSAGE_SIZE] = "";
+	const cw_char_t			*reason = strerror(errno);
 
 	va_start(args, format);
 	if (prepend == NULL) prepend = empty;
 	if (append == NULL) append = empty;
 	if (format != NULL)
 		{
-		fprintf(stderr, "%s: %s", global_program_name(), prepend);
-		vfprintf(stderr, format, args);
-		fprintf(stderr, "%s\n", append);
+		vsnprintf(message, sizeof (message), format, args);
+		fprintf(stderr, "%s: %s%s%s\n", global_program_name(), prepend, message, append);
 		}
 	va_end(args);
-	if (flags & ERROR_FLAG_PERROR) fprintf(stderr, "%s: %s\n", global_program_name(), strerror(errno));
-	if (flags & ERROR_FLAG_EXIT) error_exit();
+	if (flags & ERROR_FLAG_PERROR) fprintf(stderr, "%s: %s\n", global_program_name(), reason);
+
+	/* remember the message of a fatal error for error_get_last() */
+
+	if (! (flags & ERROR_FLAG_EXIT)) return;
+	if (! (flags & ERROR_FLAG_PERROR)) reason = NULL;
+	if (format == NULL) snprintf(error_last, sizeof (error_last), "%s", (reason != NULL) ? reason : "");
+	else if (reason == NULL) snprintf(error_last, sizeof (error_last), "%s%s%s", prepend, message, append);
+	else snprintf(error_last, sizeof (error_last), "%s%s%s: %s", prepend, message, append, reason);
+	error_exit();
 	}
 
 
@@ -31,6 +31,20 @@ extern cw_void_t
 error_exit(
 	cw_void_t);
 
+extern cw_void_t
+error_set_thread_exit(
+	cw_bool_t			value);
+
+extern const cw_char_t *
+error_get_last(
+	cw_void_t);
+
+extern cw_void_t
+error_forward(
+	const cw_char_t			*message);
+
+#define ERROR_MESSAGE_SIZE		1024
+
 #define ERROR_FLAG_NONE			0
 #define ERROR_FLAG_EXIT			(1 << 0)
 #define ERROR_FLAG_PERROR		(1 << 1)
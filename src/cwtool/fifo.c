@@ -284,6 +284,107 @@ fifo_write_bits(
 
 
 
+/****************************************************************************
+ * fifo_write_bits_block
+ ****************************************************************************/
+int
+fifo_write_bits_block(
+	struct fifo			*ffo,
+	const cw_u32_t			*val,
+	int				bits,
+	int				size)
+
+	{
+	cw_u64_t			reg;
+	int				avail  = ffo->wr_bitofs & 7;
+	int				wr_ofs = ffo->wr_bitofs / 8;
+	int				i;
+
+	/*
+	 * does the same as calling fifo_write_bits(ffo, val[i], bits) for
+	 * each value, but with a 64 bit register, so values with up to 32
+	 * bits are possible. if the data does not fit into the fifo, it
+	 * falls back to fifo_write_bits() to stop at the same bit offset
+	 */
+
+	debug_error_condition((bits < 1) || (bits > 32));
+	if (wr_ofs + (avail + bits * size) / 8 >= ffo->limit)
+		{
+		for (i = 0; i < size; i++)
+			{
+			if ((bits > 16) && (fifo_write_bits(ffo, val[i] >> 16, bits - 16) == -1)) return (-1);
+			if (fifo_write_bits(ffo, val[i] & 0xffff, (bits > 16) ? 16 : bits) == -1) return (-1);
+			}
+		return (0);
+		}
+	reg = ffo->reg & 0xff;
+	for (i = 0; i < size; i++)
+		{
+		debug_error_condition((bits < 32) && (val[i] >= (1U << bits)));
+		reg   = (reg << bits) | val[i];
+		avail += bits;
+		while (avail > 7)
+			{
+			avail -= 8;
+			ffo->data[wr_ofs++] = reg >> avail;
+			}
+		}
+	ffo->reg = reg & 0xffff;
+	ffo->wr_bitofs += bits * size;
+	ffo->wr_ofs = (ffo->wr_bitofs + 7) / 8;
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * fifo_read_msb_bytes
+ ****************************************************************************/
+int
+fifo_read_msb_bytes(
+	struct fifo			*ffo,
+	unsigned char			*data,
+	int				*offsets,
+	int				size)
+
+	{
+	int				bitofs = ffo->rd_bitofs;
+	int				i, o, z, w;
+
+	/*
+	 * read self synchronizing bytes like the gcr nybbles of apple
+	 * disks: zero bits are skipped until a set bit is found, this bit
+	 * is the msb of the next byte. the bit offset of each byte is
+	 * stored in offsets. this does the same as fifo_read_bits(ffo, 8)
+	 * followed by fifo_read_bits(ffo, 1) as long as the msb is 0, but
+	 * skips whole bytes of zero bits at once
+	 */
+
+	for (i = 0; i < size; i++)
+		{
+		while (1)
+			{
+			if (bitofs + 8 >= ffo->wr_bitofs) return (-1);
+			o = bitofs >> 3;
+			w = (ffo->data[o] << 16) | (ffo->data[o + 1] << 8);
+			if (o + 2 < ffo->wr_ofs) w |= ffo->data[o + 2];
+			w = (w << (bitofs & 7)) & 0xffffff;
+			if (w >= 0x010000) break;
+			bitofs += 8;
+			}
+		for (z = 0; w < 0x800000; z++) w <<= 1;
+		bitofs += z;
+		if (bitofs + 8 >= ffo->wr_bitofs) return (-1);
+		data[i]    = (w >> 16) & 0xff;
+		offsets[i] = bitofs;
+		bitofs += 8;
+		}
+	fifo_set_rd_bitofs(ffo, bitofs);
+	return (0);
+	}
+
+
+
 /****************************************************************************
  * fifo_read_count
  ****************************************************************************/
@@ -310,6 +411,58 @@ fifo_read_count(
 
 
 
+/****************************************************************************
+ * fifo_read_counts
+ ****************************************************************************/
+int
+fifo_read_counts(
+	struct fifo			*ffo,
+	int				*counts,
+	int				size)
+
+	{
+	cw_u32_t			w;
+	int				b = ffo->rd_bitofs, s = b, end = ffo->wr_bitofs - 1;
+	int				i, o, z;
+
+	/*
+	 * does the same as calling fifo_read_count() up to size times, but
+	 * looks at 32 bits at once. __builtin_clz() gives the number of
+	 * zero bits up to the next set bit, so the loops run once per
+	 * count instead of once per bit. like with fifo_read_count() the
+	 * last bit before wr_bitofs is never taken. returns the number of
+	 * counts stored, less than size only at the end of the data
+	 */
+
+	for (i = 0; (i < size) && (b < end); )
+		{
+		o = b >> 3;
+		if (o + 4 <= ffo->wr_ofs) w = ((cw_u32_t) ffo->data[o] << 24) | (ffo->data[o + 1] << 16) | (ffo->data[o + 2] << 8) | ffo->data[o + 3];
+		else for (w = z = 0; z < 4; z++) w = (w << 8) | ((o + z < ffo->wr_ofs) ? ffo->data[o + z] : 0);
+		w <<= b & 7;
+		while ((w != 0) && (i < size))
+			{
+			z = __builtin_clz(w);
+			if (b + z >= end) goto done;
+			counts[i++] = b + z - s;
+			b = s = b + z + 1;
+			w = (w << z) << 1;
+			}
+		if (i < size) b = (o << 3) + 32;
+		}
+done:
+
+	/* rd_ofs and reg as fifo_read_count() would have left them */
+
+	if (s == ffo->rd_bitofs) return (i);
+	ffo->rd_bitofs = s;
+	ffo->rd_ofs    = (s + 7) >> 3;
+	ffo->reg       = (ffo->data[(s - 1) >> 3] << (((s - 1) & 7) + 1)) & 0x1ff;
+	return (i);
+	}
+
+
+
 /****************************************************************************
  * fifo_read_byte
  ****************************************************************************/
@@ -533,4 +686,34 @@ fifo_get_speed(
 	{
 	return (ffo->speed);
 	}
+
+
+
+/****************************************************************************
+ * fifo_get_index_offsets
+ ****************************************************************************/
+int
+fifo_get_index_offsets(
+	struct fifo			*ffo,
+	int				*offsets,
+	int				max)
+
+	{
+	int				i, index, previous, count = 0;
+
+	/*
+	 * return the offsets of the rising edges of the index signal, this
+	 * is only possible if the index was stored in bit 7 of the data
+	 */
+
+	if ((! (ffo->flags & FIFO_FLAG_INDEX_STORED)) || (ffo->wr_ofs == 0)) return (0);
+	previous = ffo->data[0] & GLOBAL_PULSE_INDEX_MASK;
+	for (i = 0; (i < ffo->wr_ofs) && (count < max); i++)
+		{
+		index = ffo->data[i] & GLOBAL_PULSE_INDEX_MASK;
+		if ((index) && (! previous)) offsets[count++] = i;
+		previous = index;
+		}
+	return (count);
+	}
 /******************************************************** Karsten Scheibler */
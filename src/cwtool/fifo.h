@@ -77,7 +77,10 @@ extern int				fifo_last_bit_read(struct fifo *);
 extern int				fifo_last_bit_written(struct fifo *);
 extern int				fifo_read_bits(struct fifo *, int);
 extern int				fifo_write_bits(struct fifo *, int, int);
+extern int				fifo_write_bits_block(struct fifo *, const cw_u32_t *, int, int);
+extern int				fifo_read_msb_bytes(struct fifo *, unsigned char *, int *, int);
 extern int				fifo_read_count(struct fifo *);
+extern int				fifo_read_counts(struct fifo *, int *, int);
 extern int				fifo_read_byte(struct fifo *);
 extern int				fifo_write_byte(struct fifo *, int);
 extern int				fifo_read_block(struct fifo *, unsigned char *, int);
@@ -90,6 +93,7 @@ extern int				fifo_clear_flags(struct fifo *, int);
 extern int				fifo_get_flags(struct fifo *);
 extern int				fifo_set_speed(struct fifo *, int);
 extern int				fifo_get_speed(struct fifo *);
+extern int				fifo_get_index_offsets(struct fifo *, int *, int);
 
 #define fifo_write_count(ffo, count)	fifo_write_bits(ffo, 1, count + 1)
 
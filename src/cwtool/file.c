@@ -12,6 +12,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -32,6 +33,32 @@
 
 
 
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * remember the fds each thread opened, so they can be closed with
+ * file_close_all() if a thread was terminated by an error (cwtool -B)
+ */
+
+#define NR_FDS				64
+
+static __thread cw_int_t		file_fd[NR_FDS];
+static __thread cw_count_t		file_fds;
+
+/* the number in the name of tmp files is shared by all jobs */
+
+static pthread_mutex_t			file_tmp_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+
 /****************************************************************************
  *
  * local functions
@@ -53,18 +80,51 @@ file_tmp(
 	struct timeval			tv;
 	cw_char_t			*path    = malloc(size);
 	cw_char_t			*tmp_dir = getenv("TMPDIR");
-	cw_count_t			len;
+	cw_count_t			len, c;
 
 	if (path == NULL) error_oom();
 	if (tmp_dir == NULL) tmp_dir = "/tmp";
 	if (gettimeofday(&tv, NULL) == -1) error_perror_message("error while gettimeofday()");
-	len = snprintf(path, size, "%s/%s-%010d-%010ld-%06ld-%05d", tmp_dir, global_program_name(), count++, tv.tv_sec, tv.tv_usec, getpid());
+	pthread_mutex_lock(&file_tmp_mutex);
+	c = count++;
+	pthread_mutex_unlock(&file_tmp_mutex);
+	len = snprintf(path, size, "%s/%s-%010d-%010ld-%06ld-%05d", tmp_dir, global_program_name(), c, tv.tv_sec, tv.tv_usec, getpid());
 	if ((len == -1) || (len >= size)) error_message("path for tmp file too long");
 	return (path);
 	}
 
 
 
+/****************************************************************************
+ * file_fd_add
+ ****************************************************************************/
+static cw_void_t
+file_fd_add(
+	cw_int_t			fd)
+
+	{
+	if ((fd == STDIN_FILENO) || (fd == STDOUT_FILENO)) return;
+	if (file_fds < NR_FDS) file_fd[file_fds++] = fd;
+	}
+
+
+
+/****************************************************************************
+ * file_fd_remove
+ ****************************************************************************/
+static cw_void_t
+file_fd_remove(
+	cw_int_t			fd)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < file_fds; i++) if (file_fd[i] == fd) break;
+	if (i < file_fds) file_fd[i] = file_fd[--file_fds];
+	}
+
+
+
 /****************************************************************************
  * file_try_again
  ****************************************************************************/
@@ -164,6 +224,7 @@ file_open(
 		if (flags & FILE_FLAG_RETURN) return (CW_BOOL_FAIL);
 		error_perror_message("error while opening '%s'", path);
 		}
+	file_fd_add(fil->fd);
 
 	/*
 	 * tmp files are unlinked after creation, just keeping the fd open is
@@ -188,6 +249,7 @@ file_close(
 	struct file			*fil)
 
 	{
+	file_fd_remove(fil->fd);
 	if (close(fil->fd) == -1) error_perror_message("error while closing '%s'", fil->path);
 	if (fil->allocated) free(fil->path);
 	*fil = (struct file) { .fd = -1 };
@@ -195,6 +257,39 @@ file_close(
 
 
 
+/****************************************************************************
+ * file_close_all
+ ****************************************************************************/
+cw_void_t
+file_close_all(
+	cw_void_t)
+
+	{
+
+	/*
+	 * close all files still opened by the calling thread, errors are
+	 * ignored here
+	 */
+
+	while (file_fds > 0) close(file_fd[--file_fds]);
+	}
+
+
+
+/****************************************************************************
+ * file_unlink
+ ****************************************************************************/
+cw_void_t
+file_unlink(
+	const cw_char_t			*path)
+
+	{
+	verbose_message(GENERIC, 2, "unlinking '%s'", path);
+	if (unlink(path) == -1) error_perror_message("error while unlinking '%s'", path);
+	}
+
+
+
 /****************************************************************************
  * file_get_path
  ****************************************************************************/
@@ -239,6 +334,25 @@ file_is_writable(
 
 
 
+/****************************************************************************
+ * file_is_regular
+ ****************************************************************************/
+cw_bool_t
+file_is_regular(
+	struct file			*fil)
+
+	{
+	struct stat			st;
+
+	/* stdout, pipes and devices can not be written out of order */
+
+	if (fstat(fil->fd, &st) == -1) error_perror_message("error while getting status of '%s'", fil->path);
+	if (S_ISREG(st.st_mode)) return (CW_BOOL_TRUE);
+	return (CW_BOOL_FALSE);
+	}
+
+
+
 /****************************************************************************
  * file_ioctl2
  ****************************************************************************/
@@ -302,6 +416,25 @@ file_seek(
 
 
 
+/****************************************************************************
+ * file_truncate
+ ****************************************************************************/
+cw_void_t
+file_truncate(
+	struct file			*fil,
+	cw_size_t			size)
+
+	{
+	debug_error_condition(! file_is_writable(fil));
+	while (ftruncate(fil->fd, size) == -1)
+		{
+		if (file_try_again(errno)) continue;
+		error_perror_message("error while truncating '%s'", fil->path);
+		}
+	}
+
+
+
 /****************************************************************************
  * file_read
  ****************************************************************************/
@@ -380,6 +513,40 @@ file_write(
 
 
 
+/****************************************************************************
+ * file_pwrite
+ ****************************************************************************/
+cw_count_t
+file_pwrite(
+	struct file			*fil,
+	const cw_void_t			*data,
+	cw_size_t			size,
+	cw_count_t			position)
+
+	{
+	cw_int_t			result;
+	cw_count_t			ofs = 0;
+
+	/* like file_write(), but at the given position in the file */
+
+	debug_error_condition(! file_is_writable(fil));
+	while (size > 0)
+		{
+		result = pwrite(fil->fd, data, size, position + ofs);
+		if (result == -1)
+			{
+			if (file_try_again(errno)) continue;
+			error_perror_message("error while writing to '%s'", fil->path);
+			}
+		data += result;
+		size -= result;
+		ofs += result;
+		}
+	return (ofs);
+	}
+
+
+
 /****************************************************************************
  * file_write_string
  ****************************************************************************/
@@ -66,6 +66,14 @@ extern cw_void_t
 file_close(
 	struct file			*fil);
 
+extern cw_void_t
+file_close_all(
+	cw_void_t);
+
+extern cw_void_t
+file_unlink(
+	const cw_char_t			*path);
+
 extern const cw_char_t *
 file_get_path(
 	struct file			*fil);
@@ -78,6 +86,10 @@ extern cw_bool_t
 file_is_writable(
 	struct file			*fil);
 
+extern cw_bool_t
+file_is_regular(
+	struct file			*fil);
+
 extern cw_int_t
 file_ioctl2(
 	struct file			*fil,
@@ -91,6 +103,11 @@ file_seek(
 	cw_count_t			ofs,
 	cw_flag_t			flags);
 
+extern cw_void_t
+file_truncate(
+	struct file			*fil,
+	cw_size_t			size);
+
 extern cw_count_t
 file_read(
 	struct file			*fil,
@@ -109,6 +126,13 @@ file_write(
 	const cw_void_t			*data,
 	cw_size_t			size);
 
+extern cw_count_t
+file_pwrite(
+	struct file			*fil,
+	const cw_void_t			*data,
+	cw_size_t			size,
+	cw_count_t			position);
+
 extern cw_count_t
 file_write_string(
 	struct file			*fil,
@@ -20,6 +20,22 @@
 #include "../options.h"
 #include "../fifo.h"
 #include "bounds.h"
+#include "histogram.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define PLL_BLOCK_SIZE			1024
+#define WRITE_BLOCK_SIZE		1024
 
 
 
@@ -80,6 +96,112 @@ bitstream_read_lookup2(
 
 
 
+/****************************************************************************
+ * bitstream_read_pll2
+ ****************************************************************************/
+static int
+bitstream_read_pll2(
+	struct fifo			*ffo_l0,
+	struct fifo			*ffo_l1,
+	struct bounds			*bnd,
+	int				bnd_size,
+	int				phase_gain,
+	int				frequency_gain,
+	struct bitstream_map		*bst_map,
+	int				bst_map_size)
+
+	{
+	unsigned char			*data = fifo_get_data(ffo_l0);
+	int				value[PLL_BLOCK_SIZE];
+	int				count[PLL_BLOCK_SIZE];
+	int				error[PLL_BLOCK_SIZE];
+	int				cells[GLOBAL_NR_PULSE_LENGTHS];
+	int				c, c_min, c_max, e, n, p, x, invalid;
+	int				i, j, o, s, size;
+
+	/*
+	 * instead of mapping each counter value on its own, a software
+	 * pll follows the clock of the data. c is the length of one bit
+	 * cell and p the phase of the clock, both in 1/256 counter values
+	 * like in struct bounds. the nominal cell length is taken from the
+	 * write values of the bounds, the pll may deviate from it by 1/8.
+	 * a counter value is rounded to n cells, the remaining phase error
+	 * e adjusts the cell length by frequency_gain / 256 and the clock
+	 * phase by phase_gain / 256. n cells give a count of n - 1, cell
+	 * numbers not occurring in bnd give the same invalid count as
+	 * counter values out of bounds in bitstream_read_lookup2()
+	 */
+
+	for (i = j = 0; i < bnd_size; i++) if (bnd[i].count > j) j = bnd[i].count;
+	for (i = 0, invalid = j + 1; i < GLOBAL_NR_PULSE_LENGTHS; i++) cells[i] = invalid;
+	for (i = c = n = 0; i < bnd_size; i++)
+		{
+		debug_error_condition(bnd[i].count + 1 >= GLOBAL_NR_PULSE_LENGTHS);
+		cells[bnd[i].count + 1] = bnd[i].count;
+		c += bnd[i].write;
+		n += bnd[i].count + 1;
+		}
+	c     = c / n;
+	c_min = c - c / 8;
+	c_max = c + c / 8;
+	debug_error_condition(c_min <= 0);
+
+	/*
+	 * pulses are processed in blocks, the first and the last loop
+	 * do not depend on previous values and may be vectorized by the
+	 * compiler, only the pll itself has to run sequentially
+	 */
+
+	debug_message(GENERIC, 3, "bitstream_read_pll ffo_l0->wr_ofs = %d, nominal cell length = 0x%04x", fifo_get_wr_ofs(ffo_l0), c);
+	for (j = 0, s = 0, p = 0, o = fifo_get_rd_ofs(ffo_l0); (j < bst_map_size) && (o < fifo_get_wr_ofs(ffo_l0)); o += size)
+		{
+		size = fifo_get_wr_ofs(ffo_l0) - o;
+		if (size > bst_map_size - j) size = bst_map_size - j;
+		if (size > PLL_BLOCK_SIZE) size = PLL_BLOCK_SIZE;
+		for (i = 0; i < size; i++) value[i] = (data[o + i] & GLOBAL_PULSE_LENGTH_MASK) << 8;
+		for (i = 0; i < size; i++)
+			{
+			x = value[i] + p;
+			n = (x + c / 2) / c;
+			if ((n < 1) || (n >= GLOBAL_NR_PULSE_LENGTHS) || (cells[n] == invalid))
+				{
+				count[i] = invalid;
+				error[i] = 0xff;
+				p        = 0;
+				continue;
+				}
+			e        = x - n * c;
+			count[i] = cells[n];
+			error[i] = (((e < 0) ? -e : e) + 0x80) >> 8;
+			c        += (e * frequency_gain) / (0x100 * n);
+			if (c < c_min) c = c_min;
+			if (c > c_max) c = c_max;
+			p        = e - (e * phase_gain) / 0x100;
+			}
+		for (i = 0; i < size; i++, j++)
+			{
+			if (bst_map != NULL)
+				{
+				s += count[i] + 1;
+				bst_map[j] = (struct bitstream_map)
+					{
+					.length     = count[i] + 1,
+					.length_sum = s,
+					.error      = error[i]
+					};
+				}
+			if (ffo_l1 == NULL) continue;
+			if (fifo_write_count(ffo_l1, count[i]) == -1) debug_error();
+			}
+		}
+	fifo_set_rd_ofs(ffo_l0, o);
+	if (ffo_l1 != NULL) fifo_write_flush(ffo_l1);
+	debug_message(GENERIC, 3, "bitstream_read_pll ffo_l0->rd_ofs = %d, cell length = 0x%04x", o, c);
+	return (j);
+	}
+
+
+
 
 /****************************************************************************
  *
@@ -171,8 +293,17 @@ bitstream_read(
 	int				bnd_size)
 
 	{
+	struct bounds			bnd_cal[GLOBAL_NR_BOUNDS];
 	int				i, lookup[GLOBAL_NR_PULSE_LENGTHS];
 
+	/* optionally adapt bounds to the pulses of this track */
+
+	if ((options_get_bounds_calibrate()) && (histogram_calibrate(ffo_l0, bnd, bnd_cal, bnd_size)))
+		{
+		for (i = 0; i < bnd_size; i++) verbose_message(GENERIC, 2, "calibrated bounds 0x%04x 0x%04x 0x%04x -> 0x%04x 0x%04x", bnd[i].read_low, bnd[i].write, bnd[i].read_high, bnd_cal[i].read_low, bnd_cal[i].read_high);
+		bnd = bnd_cal;
+		}
+
 	/* create lookup table */
 
 	bitstream_read_lookup(bnd, bnd_size, lookup);
@@ -247,6 +378,45 @@ bitstream_read_map(
 
 
 
+/****************************************************************************
+ * bitstream_read_pll
+ ****************************************************************************/
+int
+bitstream_read_pll(
+	struct fifo			*ffo_l0,
+	struct fifo			*ffo_l1,
+	struct bounds			*bnd,
+	int				bnd_size,
+	int				phase_gain,
+	int				frequency_gain)
+
+	{
+	bitstream_read_pll2(ffo_l0, ffo_l1, bnd, bnd_size, phase_gain, frequency_gain, NULL, fifo_get_wr_ofs(ffo_l0));
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * bitstream_read_map_pll
+ ****************************************************************************/
+int
+bitstream_read_map_pll(
+	struct fifo			*ffo_l0,
+	struct fifo			*ffo_l1,
+	struct bounds			*bnd,
+	int				bnd_size,
+	int				phase_gain,
+	int				frequency_gain,
+	struct bitstream_map		*bst_map,
+	int				bst_map_size)
+
+	{
+	return (bitstream_read_pll2(ffo_l0, ffo_l1, bnd, bnd_size, phase_gain, frequency_gain, bst_map, bst_map_size));
+	}
+
+
+
 /****************************************************************************
  * bitstream_write
  ****************************************************************************/
@@ -260,7 +430,8 @@ bitstream_write(
 
 	{
 	struct bitstream_counter	bst_cnt = BITSTREAM_COUNTER_INIT(bnd, precomp, bnd_size);
-	int				i, j, lookup[GLOBAL_NR_PULSE_LENGTHS];
+	int				i, j, n, lookup[GLOBAL_NR_PULSE_LENGTHS];
+	int				counts[WRITE_BLOCK_SIZE];
 
 	/* create lookup table */
 
@@ -276,13 +447,17 @@ bitstream_write(
 
 	debug_message(GENERIC, 3, "bitstream_write ffo_l1->wr_bitofs = %d, ffo_l0->limit = %d", fifo_get_wr_bitofs(ffo_l1), fifo_get_limit(ffo_l0));
 	fifo_set_flags(ffo_l0, FIFO_FLAG_WRITABLE);
-	while (1)
+	do
 		{
-		i = fifo_read_count(ffo_l1);
-		if (i == -1) break;
-		if (i >= 128) i = 127;
-		if (bitstream_write_counter(ffo_l0, &bst_cnt, lookup[i]) == -1) return (-1);
+		n = fifo_read_counts(ffo_l1, counts, WRITE_BLOCK_SIZE);
+		for (j = 0; j < n; j++)
+			{
+			i = counts[j];
+			if (i >= 128) i = 127;
+			if (bitstream_write_counter(ffo_l0, &bst_cnt, lookup[i]) == -1) return (-1);
+			}
 		}
+	while (n == WRITE_BLOCK_SIZE);
 	if (bst_cnt.invalid > 0) error_warning("could not convert %d invalid bit patterns", bst_cnt.invalid);
 	debug_message(GENERIC, 3, "bitstream_write ffo_l1->rd_bitofs = %d, ffo_l0->wr_ofs = %d", fifo_get_rd_bitofs(ffo_l1), fifo_get_wr_ofs(ffo_l0));
 
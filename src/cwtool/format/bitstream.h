@@ -67,6 +67,8 @@ extern int				bitstream_read_counter(struct fifo *, int *);
 extern int				bitstream_write_counter(struct fifo *, struct bitstream_counter *, int);
 extern int				bitstream_read(struct fifo *, struct fifo *, struct bounds *, int);
 extern int				bitstream_read_map(struct fifo *, struct fifo *, struct bounds *, int, struct bitstream_map *, int);
+extern int				bitstream_read_pll(struct fifo *, struct fifo *, struct bounds *, int, int, int);
+extern int				bitstream_read_map_pll(struct fifo *, struct fifo *, struct bounds *, int, int, int, struct bitstream_map *, int);
 extern int				bitstream_write(struct fifo *, struct fifo *, struct bounds *, short *, int);
 
 
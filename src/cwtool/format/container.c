@@ -49,7 +49,15 @@ container_init(
 		if (con == NULL) error_oom();
 		flags |= CONTAINER_FLAG_MALLOC;
 		}
-	*con = (struct container) { .flags = flags };
+
+	/*
+	 * struct container has several megabytes, so do not clear it
+	 * completely (a compound literal would also need that much
+	 * stack). each entry is initialized when it gets stored
+	 */
+
+	con->entries = 0;
+	con->flags   = flags;
 	return (con);
 	}
 
@@ -72,6 +80,7 @@ container_deinit(
 		if (con->data[i]  != NULL) free(con->data[i]);
 		if (con->error[i] != NULL) free(con->error[i]);
 		if (con->lkp[i]   != NULL) free(con->lkp[i]);
+		if (con->votes[i] != NULL) free(con->votes[i]);
 		}
 	con->flags = CONTAINER_FLAG_NONE;
 	if (flags & CONTAINER_FLAG_MALLOC) free(con);
@@ -97,8 +106,10 @@ container_store_data_and_error(
 	con->data[i]  = malloc(size * sizeof (cw_raw8_t));
 	con->error[i] = malloc(size * sizeof (cw_raw8_t));
 	con->lkp[i]   = malloc(size * sizeof (struct container_lookup));
+	con->votes[i] = NULL;
 	con->size[i]  = size;
 	con->limit[i] = size;
+	con->range_entries[i] = 0;
 	con->entries++;
 	if ((con->data[i] == NULL) || (con->error[i] == NULL) || (con->lkp[i] == NULL)) error_oom();
 	if (data  != NULL) memcpy(con->data[i],  data,  size);
@@ -171,6 +182,34 @@ container_get_lookup(
 
 
 
+/****************************************************************************
+ * container_get_votes
+ ****************************************************************************/
+cw_raw8_t *
+container_get_votes(
+	struct container		*con,
+	cw_index_t			index)
+
+	{
+	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
+	error_condition((index < 0) || (index >= con->entries));
+
+	/*
+	 * vote counts are only needed for an entry holding a consensus
+	 * of several reads, so they are allocated on first use
+	 */
+
+	if (con->votes[index] == NULL)
+		{
+		con->votes[index] = malloc(con->size[index] * sizeof (cw_raw8_t));
+		if (con->votes[index] == NULL) error_oom();
+		memset(con->votes[index], 0, con->size[index] * sizeof (cw_raw8_t));
+		}
+	return (con->votes[index]);
+	}
+
+
+
 /****************************************************************************
  * container_get_size
  ****************************************************************************/
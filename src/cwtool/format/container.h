@@ -52,6 +52,7 @@ struct container
 	cw_raw8_t			*data[CONTAINER_NR_ENTRIES];
 	cw_raw8_t			*error[CONTAINER_NR_ENTRIES];
 	struct container_lookup		*lkp[CONTAINER_NR_ENTRIES];
+	cw_raw8_t			*votes[CONTAINER_NR_ENTRIES];
 	cw_size_t			size[CONTAINER_NR_ENTRIES];
 	cw_size_t			limit[CONTAINER_NR_ENTRIES];
 	cw_count_t			entries;
@@ -106,6 +107,11 @@ container_get_lookup(
 	struct container		*con,
 	cw_index_t			index);
 
+extern cw_raw8_t *
+container_get_votes(
+	struct container		*con,
+	cw_index_t			index);
+
 extern cw_size_t
 container_get_size(
 	struct container		*con,
@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "fm.h"
 #include "range.h"
@@ -128,6 +129,8 @@ static int
 fm_nec765_read_sector2(
 	struct fifo			*ffo_l1,
 	struct fm_nec765		*fm_nec,
+	struct container		*con,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
@@ -141,6 +144,18 @@ fm_nec765_read_sector2(
 	bitofs = fifo_get_rd_bitofs(ffo_l1);
 	if (fm_read_bytes(ffo_l1, dsk_err, header, HEADER_SIZE) == -1) return (-1);
 	range_set_end(range_sector_header(rng_sec), fifo_get_rd_bitofs(ffo_l1));
+
+	/*
+	 * returns 0 if the data field was skipped, see disk_sector_skip(),
+	 * 2 for a deleted data address mark and 1 otherwise
+	 */
+
+	if ((fm_read_u16_be(&header[4]) == fm_crc16(fm_nec->rw.crc16_init_value1, header, 4)) &&
+		(disk_sector_skip(dsk_sct, fm_nec->rw.sectors, header[2] - 1, con)))
+		{
+		fifo_set_rd_bitofs(ffo_l1, bitofs);
+		return (0);
+		}
 	data_size = fm_nec765_sector_size(fm_nec, header[2] - 1);
 	result = fm_read_sync(ffo_l1, range_sector_data(rng_sec), fm_nec->rw.sync_value2, fm_nec->rw.sync_value3);
 	if (result == -1) return (-1);
@@ -148,7 +163,7 @@ fm_nec765_read_sector2(
 	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
 	verbose_message(GENERIC, 2, "rewinding to bit offset %d", bitofs);
 	fifo_set_rd_bitofs(ffo_l1, bitofs);
-	return (result);
+	return (result + 1);
 	}
 
 
@@ -199,9 +214,10 @@ fm_nec765_read_sector(
 	int				result, track, side, sector, data_size;
 	int				init = fm_nec->rw.crc16_init_value2;
 
-	result = fm_nec765_read_sector2(ffo_l1, fm_nec, &dsk_err, &rng_sec, header, data);
+	result = fm_nec765_read_sector2(ffo_l1, fm_nec, con, dsk_sct, &dsk_err, &rng_sec, header, data);
 	if (result == -1) return (-1);
-	if (result == 1) init = fm_nec->rw.crc16_init_value3;
+	if (result == 0) return (1);
+	if (result == 2) init = fm_nec->rw.crc16_init_value3;
 
 	/* accept only valid sector numbers */
 
@@ -326,12 +342,19 @@ fm_nec765_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->fm_nec.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->fm_nec.rw.bnd, 2);
 	bitstream_read(ffo_l0, &ffo_l1, fmt->fm_nec.rw.bnd, 2);
-	while (fm_nec765_read_sector(&ffo_l1, &fmt->fm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+
+	/* stop early if possible, see disk_sectors_wanted() */
+
+	while (fm_nec765_read_sector(&ffo_l1, &fmt->fm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1)
+		{
+		if (! disk_sectors_wanted(dsk_sct, fmt->fm_nec.rw.sectors, con)) break;
+		}
+	scratch_free(data);
 	}
 
 
@@ -391,21 +414,24 @@ fm_nec765_write_track(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data_l1[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data_l1, sizeof (data_l1));
-	int				i;
-
-	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.prolog_value, fmt->fm_nec.wr.prolog_length) == -1) return (0);
-	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.fill_value1, fmt->fm_nec.wr.fill_length1)   == -1) return (0);
-	if (fm_write_sync(&ffo_l1, 0xf77a, 1) == -1) return (0);
-	for (i = 0; i < fmt->fm_nec.rw.sectors; i++) if (fm_nec765_write_sector(&ffo_l1, &fmt->fm_nec, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) return (0);
+	unsigned char			*data_l1 = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data_l1, GLOBAL_MAX_TRACK_SIZE);
+	int				i, result = 0;
+
+	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.prolog_value, fmt->fm_nec.wr.prolog_length) == -1) goto done;
+	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.fill_value1, fmt->fm_nec.wr.fill_length1)   == -1) goto done;
+	if (fm_write_sync(&ffo_l1, 0xf77a, 1) == -1) goto done;
+	for (i = 0; i < fmt->fm_nec.rw.sectors; i++) if (fm_nec765_write_sector(&ffo_l1, &fmt->fm_nec, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) goto done;
 	fifo_set_rd_ofs(ffo_l3, fifo_get_wr_ofs(ffo_l3));
-	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.fill_value6, fmt->fm_nec.wr.fill_length6)   == -1) return (0);
-	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.fill_value7, fmt->fm_nec.wr.fill_length7)   == -1) return (0);
-	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.epilog_value, fmt->fm_nec.wr.epilog_length) == -1) return (0);
+	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.fill_value6, fmt->fm_nec.wr.fill_length6)   == -1) goto done;
+	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.fill_value7, fmt->fm_nec.wr.fill_length7)   == -1) goto done;
+	if (fm_write_fill(&ffo_l1, fmt->fm_nec.wr.epilog_value, fmt->fm_nec.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1);
-	if (bitstream_write(&ffo_l1, ffo_l0, fmt->fm_nec.rw.bnd, fmt->fm_nec.wr.precomp, 2) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1, ffo_l0, fmt->fm_nec.rw.bnd, fmt->fm_nec.wr.precomp, 2) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1);
+	return (result);
 	}
 
 
@@ -29,6 +29,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "range.h"
 #include "bitstream.h"
@@ -50,6 +51,10 @@
 
 
 
+#define GCR_MAX_BYTES			704
+
+
+
 /****************************************************************************
  * gcr_read_sync
  ****************************************************************************/
@@ -227,25 +232,30 @@ gcr_read_data_bytes(
 		0x37, 0x38, 0xff, 0x39, 0x3a, 0x3b, 0x3c, 0x3d,
 		0x3e, 0x3f
 		};
-	int				b, i, j, r;
+	unsigned char			nybble[GCR_MAX_BYTES];
+	int				offset[GCR_MAX_BYTES];
+	int				i, j, k, r;
 	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
 
-	for (i = 0; i < size; i++)
+	/*
+	 * get all nybbles at once, fifo_read_msb_bytes() already skips
+	 * the zero bits before each nybble, they are only reported here
+	 */
+
+	debug_error_condition(size > GCR_MAX_BYTES);
+	if (fifo_read_msb_bytes(ffo_l1, nybble, offset, size) == -1) return (-1);
+	for (i = 0, k = bitofs; i < size; k = offset[i++] + 8)
 		{
-		r = fifo_read_bits(ffo_l1, 8);
-		if (r == -1) return (-1);
-		while (r < 0x80)
+		for ( ; k < offset[i]; k++)
 			{
-			verbose_message(GENERIC, 3, "need to read additional bit around bit offset %d (byte %d), because msb is 0", fifo_get_rd_bitofs(ffo_l1) - 8, i);
-			b = fifo_read_bits(ffo_l1, 1);
-			if (b == -1) return (-1);
-			r = ((r << 1) | b) & 0xff;
+			verbose_message(GENERIC, 3, "need to read additional bit around bit offset %d (byte %d), because msb is 0", k, i);
 			}
+		r = nybble[i];
 		if (r < 0x96) j = 0xff;
 		else j = decode[r - 0x96];
 		if (j == 0xff)
 			{
-			verbose_message(GENERIC, 3, "data decode error around bit offset %d (byte %d), got 0x%02x(0x%02x)", fifo_get_rd_bitofs(ffo_l1) - 8, i, r, j);
+			verbose_message(GENERIC, 3, "data decode error around bit offset %d (byte %d), got 0x%02x(0x%02x)", offset[i], i, r, j);
 			disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
 			}
 		data[i] = j;
@@ -362,11 +372,13 @@ gcr_apple_shuffle_3inch(
 	unsigned char			*data)
 
 	{
-	int				tmp[3][175];
+	int				tmp[3][175] = { };
 	int				c1, c2, c3, c4;
 	int				d1, d2, d3, d4;
 	int				i, j;
 
+	/* the last group has only 2 bytes, so tmp[2][174] stays 0 */
+
 	for (c1 = c2 = c3 = c4 = i = j = 0; i < 175; i++)
 		{
 		c1 = (c1 & 0xff) << 1;
@@ -566,6 +578,8 @@ static int
 gcr_apple_read_sector2(
 	struct fifo			*ffo_l1,
 	struct gcr_apple		*gcr_apl,
+	struct container		*con,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
@@ -584,6 +598,15 @@ gcr_apple_read_sector2(
 	epilog = fifo_read_bits(ffo_l1, 16);
 	disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, format_compare2("header epilogue: got 0x%04x, expected 0x%04x", epilog, 0xdeaa));
 	range_set_end(range_sector_header(rng_sec), fifo_get_rd_bitofs(ffo_l1));
+
+	/* returns 0 if the data field was skipped, see disk_sector_skip() */
+
+	if ((header[h - 1] == gcr_apple_header_checksum(gcr_apl, header)) &&
+		(disk_sector_skip(dsk_sct, gcr_apl->rw.sectors, (gcr_apl->rw.mode == 0) ? header[2] : header[1], con)))
+		{
+		fifo_set_rd_bitofs(ffo_l1, bitofs);
+		return (0);
+		}
 	if (gcr_read_sync(ffo_l1, range_sector_data(rng_sec), gcr_apl->rw.sync_value2) == -1) return (-1);
 	if (gcr_read_data_bytes(ffo_l1, dsk_err, data, d) == -1) return (-1);
 	epilog = fifo_read_bits(ffo_l1, 16);
@@ -647,7 +670,9 @@ gcr_apple_read_sector(
 	int				result, track, sector;
 	int				c, t, v;
 
-	if (gcr_apple_read_sector2(ffo_l1, gcr_apl, &dsk_err, &rng_sec, header, data) == -1) return (-1);
+	result = gcr_apple_read_sector2(ffo_l1, gcr_apl, con, dsk_sct, &dsk_err, &rng_sec, header, data);
+	if (result == -1) return (-1);
+	if (result == 0) return (1);
 
 	/* extract values depending on selected mode */
 
@@ -803,12 +828,19 @@ gcr_apple_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->gcr_apl.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->gcr_apl.rw.bnd, 3);
 	bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_apl.rw.bnd, 3);
-	while (gcr_apple_read_sector(&ffo_l1, &fmt->gcr_apl, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+
+	/* stop early if possible, see disk_sectors_wanted() */
+
+	while (gcr_apple_read_sector(&ffo_l1, &fmt->gcr_apl, con, dsk_sct, cwtool_track, format_track, format_side) != -1)
+		{
+		if (! disk_sectors_wanted(dsk_sct, fmt->gcr_apl.rw.sectors, con)) break;
+		}
+	scratch_free(data);
 	}
 
 
@@ -868,17 +900,20 @@ gcr_apple_write_track(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data_l1[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data_l1, sizeof (data_l1));
-	int				i;
+	unsigned char			*data_l1 = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data_l1, GLOBAL_MAX_TRACK_SIZE);
+	int				i, result = 0;
 
-	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl.wr.prolog_length) == -1) return (0);
-	for (i = 0; i < fmt->gcr_apl.rw.sectors; i++) if (gcr_apple_write_sector(&ffo_l1, &fmt->gcr_apl, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl.wr.prolog_length) == -1) goto done;
+	for (i = 0; i < fmt->gcr_apl.rw.sectors; i++) if (gcr_apple_write_sector(&ffo_l1, &fmt->gcr_apl, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) goto done;
 	fifo_set_rd_ofs(ffo_l3, fifo_get_wr_ofs(ffo_l3));
-	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl.wr.epilog_length) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1);
-	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_apl.rw.bnd, fmt->gcr_apl.wr.precomp, 3) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_apl.rw.bnd, fmt->gcr_apl.wr.precomp, 3) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1);
+	return (result);
 	}
 
 
@@ -29,6 +29,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "range.h"
 #include "bitstream.h"
@@ -59,6 +60,10 @@ struct extra_info
 
 
 
+#define GCR_MAX_BYTES			704
+
+
+
 /****************************************************************************
  * gcr_extra_info_lookup
  ****************************************************************************/
@@ -307,27 +312,32 @@ gcr_read_data_bytes2(
 		0x37, 0x38, 0xff, 0x39, 0x3a, 0x3b, 0x3c, 0x3d,
 		0x3e, 0x3f
 		};
-	int				b, i, j, r;
+	unsigned char			nybble[GCR_MAX_BYTES];
+	int				offset[GCR_MAX_BYTES];
+	int				i, j, k, r;
 	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
 
-	for (i = 0; i < size; i++)
+	/*
+	 * get all nybbles at once, fifo_read_msb_bytes() already skips
+	 * the zero bits before each nybble, they are only reported here
+	 */
+
+	debug_error_condition(size > GCR_MAX_BYTES);
+	if (fifo_read_msb_bytes(ffo_l1, nybble, offset, size) == -1) return (-1);
+	for (i = 0, k = bitofs; i < size; k = offset[i++] + 8)
 		{
-		r = fifo_read_bits(ffo_l1, 8);
-		if (r == -1) return (-1);
-		while (r < 0x80)
+		for ( ; k < offset[i]; k++)
 			{
-			verbose_message(GENERIC, 3, "need to read additional bit around bit offset %d (byte %d), because msb is 0", fifo_get_rd_bitofs(ffo_l1) - 8, i);
-			gcr_extra_info2(xtr_nfo, fifo_get_rd_bitofs(ffo_l1) - 8);
-			b = fifo_read_bits(ffo_l1, 1);
-			if (b == -1) return (-1);
-			r = ((r << 1) | b) & 0xff;
+			verbose_message(GENERIC, 3, "need to read additional bit around bit offset %d (byte %d), because msb is 0", k, i);
+			gcr_extra_info2(xtr_nfo, k);
 			}
+		r = nybble[i];
 		if (r < 0x96) j = 0xff;
 		else j = decode[r - 0x96];
 		if (j == 0xff)
 			{
-			verbose_message(GENERIC, 3, "data decode error around bit offset %d (byte %d), got 0x%02x(0x%02x)", fifo_get_rd_bitofs(ffo_l1) - 8, i, r, j);
-			gcr_extra_info2(xtr_nfo, fifo_get_rd_bitofs(ffo_l1) - 8);
+			verbose_message(GENERIC, 3, "data decode error around bit offset %d (byte %d), got 0x%02x(0x%02x)", offset[i], i, r, j);
+			gcr_extra_info2(xtr_nfo, offset[i]);
 			disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
 			}
 		data[i] = j;
@@ -460,11 +470,13 @@ gcr_apple_test_shuffle_3inch(
 	unsigned char			*data)
 
 	{
-	int				tmp[3][175];
+	int				tmp[3][175] = { };
 	int				c1, c2, c3, c4;
 	int				d1, d2, d3, d4;
 	int				i, j;
 
+	/* the last group has only 2 bytes, so tmp[2][174] stays 0 */
+
 	for (c1 = c2 = c3 = c4 = i = j = 0; i < 175; i++)
 		{
 		c1 = (c1 & 0xff) << 1;
@@ -912,9 +924,9 @@ gcr_apple_test_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
-	struct bitstream_map		bst_map[GLOBAL_MAX_TRACK_SIZE];
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
+	struct bitstream_map		*bst_map = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (struct bitstream_map));
 	struct extra_info		xtr_nfo;
 
 	if (fmt->gcr_apl_tst.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->gcr_apl_tst.rw.bnd, 3);
@@ -925,6 +937,8 @@ gcr_apple_test_read_track2(
 		.bst_map_size = bitstream_read_map(ffo_l0, &ffo_l1, fmt->gcr_apl_tst.rw.bnd, 3, bst_map, GLOBAL_MAX_TRACK_SIZE)
 		};
 	while (gcr_apple_test_read_sector(&ffo_l1, &fmt->gcr_apl_tst, con, dsk_sct, cwtool_track, format_track, format_side, &xtr_nfo) != -1) ;
+	scratch_free(bst_map);
+	scratch_free(data);
 	}
 
 
@@ -984,17 +998,20 @@ gcr_apple_test_write_track(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data_l1[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data_l1, sizeof (data_l1));
-	int				i;
+	unsigned char			*data_l1 = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data_l1, GLOBAL_MAX_TRACK_SIZE);
+	int				i, result = 0;
 
-	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl_tst.wr.prolog_length) == -1) return (0);
-	for (i = 0; i < fmt->gcr_apl_tst.rw.sectors; i++) if (gcr_apple_test_write_sector(&ffo_l1, &fmt->gcr_apl_tst, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl_tst.wr.prolog_length) == -1) goto done;
+	for (i = 0; i < fmt->gcr_apl_tst.rw.sectors; i++) if (gcr_apple_test_write_sector(&ffo_l1, &fmt->gcr_apl_tst, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) goto done;
 	fifo_set_rd_ofs(ffo_l3, fifo_get_wr_ofs(ffo_l3));
-	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl_tst.wr.epilog_length) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, 0x3fc, fmt->gcr_apl_tst.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1);
-	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_apl_tst.rw.bnd, fmt->gcr_apl_tst.wr.precomp, 3) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_apl_tst.rw.bnd, fmt->gcr_apl_tst.wr.precomp, 3) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1);
+	return (result);
 	}
 
 
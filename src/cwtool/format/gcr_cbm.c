@@ -21,6 +21,7 @@
 
 
 #include <stdio.h>
+#include <pthread.h>
 
 #include "gcr_cbm.h"
 #include "../error.h"
@@ -30,6 +31,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "range.h"
 #include "bitstream.h"
@@ -51,6 +53,15 @@
 
 
 
+#define GCR_DECODE_INVALID		(1 << 8)
+#define GCR_MAX_BYTES			260
+#define GCR_WRITE_BLOCK_SIZE		128
+
+static pthread_once_t			gcr_decode_once = PTHREAD_ONCE_INIT;
+static unsigned short			gcr_decode[1024];
+
+
+
 /****************************************************************************
  * gcr_read_sync
  ****************************************************************************/
@@ -132,14 +143,11 @@ gcr_write_fill(
 
 
 /****************************************************************************
- * gcr_read_bytes
+ * gcr_decode_init
  ****************************************************************************/
-static int
-gcr_read_bytes(
-	struct fifo			*ffo_l1,
-	struct disk_error		*dsk_err,
-	unsigned char			*data,
-	int				size)
+static void
+gcr_decode_init(
+	void)
 
 	{
 	const static unsigned char	decode[32] =
@@ -150,22 +158,112 @@ gcr_read_bytes(
 		0xff, 0x09, 0x0a, 0x0b, 0xff, 0x0d, 0x0e, 0xff
 		};
 	int				i, n1, n2;
+
+	/*
+	 * one entry for each 10 bit group, the lower 8 bits contain the
+	 * decoded byte, GCR_DECODE_INVALID is set if one of the nybbles
+	 * is no valid gcr code. the value of an invalid byte is the same
+	 * as if both nybbles were decoded separately
+	 */
+
+	for (i = 0; i < 1024; i++)
+		{
+		n1 = i >> 5;
+		n2 = i & 0x1f;
+		gcr_decode[i] = ((decode[n1] << 4) | decode[n2]) & 0xff;
+		if ((decode[n1] == 0xff) || (decode[n2] == 0xff)) gcr_decode[i] |= GCR_DECODE_INVALID;
+		}
+	}
+
+
+
+/****************************************************************************
+ * gcr_read_bytes_error
+ ****************************************************************************/
+static void
+gcr_read_bytes_error(
+	struct fifo			*ffo_l1,
+	int				bitofs,
+	int				byte)
+
+	{
+	int				rd_bitofs = fifo_get_rd_bitofs(ffo_l1);
+	int				n1, n2;
+
+	/* read the nybbles of the erroneous byte again for the message */
+
+	fifo_set_rd_bitofs(ffo_l1, bitofs);
+	n1 = fifo_read_bits(ffo_l1, 5);
+	n2 = fifo_read_bits(ffo_l1, 5);
+	fifo_set_rd_bitofs(ffo_l1, rd_bitofs);
+	verbose_message(GENERIC, 3, "gcr decode error around bit offset %d (byte %d), got nybbles 0x%02x 0x%02x", bitofs, byte, n1, n2);
+	}
+
+
+
+/****************************************************************************
+ * gcr_read_bytes
+ ****************************************************************************/
+static int
+gcr_read_bytes(
+	struct fifo			*ffo_l1,
+	struct disk_error		*dsk_err,
+	unsigned char			*data,
+	int				size)
+
+	{
+	unsigned char			invalid[(GCR_MAX_BYTES + 7) / 8] = { };
+	unsigned char			*bytes = fifo_get_data(ffo_l1);
+	unsigned long long		reg;
+	int				i, j, n, o, v;
 	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
 
-	for (i = 0; i < size; i++)
+	debug_error_condition(size > GCR_MAX_BYTES);
+	pthread_once(&gcr_decode_once, gcr_decode_init);
+
+	/*
+	 * 4 bytes are encoded in 40 bits, so the 5 or 6 bytes containing
+	 * them are taken directly from the fifo data and decoded with one
+	 * lookup per byte. fifo_read_bits() fails if the last bit read
+	 * reaches wr_bitofs, so the same is checked once for the whole
+	 * block. the remaining bytes are read with 10 bits each. invalid
+	 * codes are only marked here and reported afterwards
+	 */
+
+	if (bitofs + 10 * size >= fifo_get_wr_bitofs(ffo_l1)) return (-1);
+	for (i = 0; i + 4 <= size; i += 4)
+		{
+		o = bitofs + 10 * i;
+		n = ((o & 7) + 47) >> 3;
+		for (reg = 0, j = 0; j < n; j++) reg = (reg << 8) | bytes[(o >> 3) + j];
+		reg >>= 8 * n - 40 - (o & 7);
+		for (j = 0; j < 4; j++)
+			{
+			v = gcr_decode[(reg >> (30 - 10 * j)) & 0x3ff];
+			if (v & GCR_DECODE_INVALID) invalid[(i + j) >> 3] |= 1 << ((i + j) & 7);
+			data[i + j] = v;
+			}
+		}
+	fifo_set_rd_bitofs(ffo_l1, bitofs + 10 * i);
+	for ( ; i < size; i++)
 		{
-		n1 = fifo_read_bits(ffo_l1, 5);
-		if (n1 == -1) return (-1);
-		n2 = fifo_read_bits(ffo_l1, 5);
-		if (n2 == -1) return (-1);
-		if ((decode[n1] == 0xff) || (decode[n2] == 0xff))
+		v = fifo_read_bits(ffo_l1, 10);
+		if (v == -1) return (-1);
+		v = gcr_decode[v];
+		if (v & GCR_DECODE_INVALID) invalid[i >> 3] |= 1 << (i & 7);
+		data[i] = v;
+		}
+	for (i = 0; i < size; i += 8)
+		{
+		if (invalid[i >> 3] == 0) continue;
+		for (j = i; (j < i + 8) && (j < size); j++)
 			{
-			verbose_message(GENERIC, 3, "gcr decode error around bit offset %d (byte %d), got nybbles 0x%02x 0x%02x", fifo_get_rd_bitofs(ffo_l1) - 10, i, n1, n2);
+			if (! (invalid[j >> 3] & (1 << (j & 7)))) continue;
+			gcr_read_bytes_error(ffo_l1, bitofs + 10 * j, j);
 			disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
 			}
-		data[i] = (decode[n1] << 4) | decode[n2];
 		}
-	verbose_message(GENERIC, 2, "read %d bytes at bit offset %d", i, bitofs);
+	verbose_message(GENERIC, 2, "read %d bytes at bit offset %d", size, bitofs);
 	return (0);
 	}
 
@@ -186,16 +284,27 @@ gcr_write_bytes(
 		0x0a, 0x0b, 0x12, 0x13, 0x0e, 0x0f, 0x16, 0x17,
 		0x09, 0x19, 0x1a, 0x1b, 0x0d, 0x1d, 0x1e, 0x15
 		};
-	int				i, n1, n2;
+	cw_u32_t			bits[GCR_WRITE_BLOCK_SIZE];
+	int				i, j, n;
+
+	/*
+	 * two bytes give four nibbles and 20 encoded bits, so they are
+	 * written with one value. an odd last byte is written with 10 bits
+	 */
 
 	verbose_message(GENERIC, 2, "writing %d bytes at bit offset %d", size, fifo_get_wr_bitofs(ffo_l1));
-	for (i = 0; i < size; i++)
+	for (i = 0; i + 1 < size; i += 2 * n)
 		{
-		n1 = (data[i] >> 4) & 0x0f;
-		if (fifo_write_bits(ffo_l1, encode[n1], 5) == -1) return (-1);
-		n2 = data[i] & 0x0f;
-		if (fifo_write_bits(ffo_l1, encode[n2], 5) == -1) return (-1);
+		n = (size - i) / 2;
+		if (n > GCR_WRITE_BLOCK_SIZE) n = GCR_WRITE_BLOCK_SIZE;
+		for (j = 0; j < n; j++) bits[j] =
+			(encode[data[i + 2 * j] >> 4] << 15) |
+			(encode[data[i + 2 * j] & 0x0f] << 10) |
+			(encode[data[i + 2 * j + 1] >> 4] << 5) |
+			encode[data[i + 2 * j + 1] & 0x0f];
+		if (fifo_write_bits_block(ffo_l1, bits, 20, n) == -1) return (-1);
 		}
+	if (i < size) return (fifo_write_bits(ffo_l1, (encode[data[i] >> 4] << 5) | encode[data[i] & 0x0f], 10));
 	return (0);
 	}
 
@@ -230,6 +339,7 @@ gcr_write_bytes(
 #define FLAG_MATCH_SIMPLE		(1 << 3)
 #define FLAG_MATCH_SIMPLE_FIXUP		(1 << 4)
 #define FLAG_POSTCOMP_SIMPLE		(1 << 5)
+#define FLAG_PLL			(1 << 6)
 
 
 
@@ -274,6 +384,8 @@ static int
 gcr_cbm_read_sector2(
 	struct fifo			*ffo_l1,
 	struct gcr_cbm			*gcr_cbm,
+	struct container		*con,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
@@ -292,6 +404,11 @@ gcr_cbm_read_sector2(
 		fifo_set_rd_bitofs(ffo_l1, bitofs);
 		if (format_compare2("header_id: got 0x%02x, expected 0x%02x", header[0], gcr_cbm->rw.header_id) == 0) break;
 		}
+
+	/* returns 0 if the data field was skipped, see disk_sector_skip() */
+
+	if ((header[1] == gcr_cbm_checksum(&header[2], HEADER_READ_SIZE - 2)) &&
+		(disk_sector_skip(dsk_sct, gcr_cbm->rw.sectors, header[2], con))) return (0);
 	if (gcr_read_sync(ffo_l1, range_sector_data(rng_sec), gcr_cbm->rd.sync_length) == -1) return (-1);
 	if (gcr_read_bytes(ffo_l1, dsk_err, data, DATA_READ_SIZE) == -1) return (-1);
 	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
@@ -344,7 +461,9 @@ gcr_cbm_read_sector(
 	unsigned char			data[DATA_SIZE];
 	int				result, track, sector;
 
-	if (gcr_cbm_read_sector2(ffo_l1, gcr_cbm, &dsk_err, &rng_sec, header, data) == -1) return (-1);
+	result = gcr_cbm_read_sector2(ffo_l1, gcr_cbm, con, dsk_sct, &dsk_err, &rng_sec, header, data);
+	if (result == -1) return (-1);
+	if (result == 0) return (1);
 
 	/* accept only valid sector numbers */
 
@@ -470,12 +589,20 @@ gcr_cbm_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->gcr_cbm.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->gcr_cbm.rw.bnd, 3);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_cbm.rw.bnd, 3);
-	while (gcr_cbm_read_sector(&ffo_l1, &fmt->gcr_cbm, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	if (fmt->gcr_cbm.rd.flags & FLAG_PLL) bitstream_read_pll(ffo_l0, &ffo_l1, fmt->gcr_cbm.rw.bnd, 3, fmt->gcr_cbm.rd.pll_gain[0], fmt->gcr_cbm.rd.pll_gain[1]);
+	else bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_cbm.rw.bnd, 3);
+
+	/* stop early if possible, see disk_sectors_wanted() */
+
+	while (gcr_cbm_read_sector(&ffo_l1, &fmt->gcr_cbm, con, dsk_sct, cwtool_track, format_track, format_side) != -1)
+		{
+		if (! disk_sectors_wanted(dsk_sct, fmt->gcr_cbm.rw.sectors, con)) break;
+		}
+	scratch_free(data);
 	}
 
 
@@ -507,6 +634,8 @@ gcr_cbm_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->gcr_cbm.rw.bnd,
 		.bnd_size     = 3,
+		.pll          = fmt->gcr_cbm.rd.flags & FLAG_PLL,
+		.pll_gain     = { fmt->gcr_cbm.rd.pll_gain[0], fmt->gcr_cbm.rd.pll_gain[1] },
 		.callback     = gcr_cbm_read_track2,
 		.merge_two    = fmt->gcr_cbm.rd.flags & FLAG_MATCH_SIMPLE,
 		.merge_all    = fmt->gcr_cbm.rd.flags & FLAG_MATCH_SIMPLE,
@@ -536,18 +665,21 @@ gcr_cbm_write_track(
 
 	{
 	unsigned char			id[2] = { 0x30, 0x30 };
-	unsigned char			data_l1[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data_l1, sizeof (data_l1));
-	int				i;
+	unsigned char			*data_l1 = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data_l1, GLOBAL_MAX_TRACK_SIZE);
+	int				i, result = 0;
 
 	if (data != NULL) id[0] = data[0], id[1] = data[1];
-	if (gcr_write_fill(&ffo_l1, fmt->gcr_cbm.wr.prolog_value, fmt->gcr_cbm.wr.prolog_length) == -1) return (0);
-	for (i = 0; i < fmt->gcr_cbm.rw.sectors; i++) if (gcr_cbm_write_sector(&ffo_l1, &fmt->gcr_cbm, &dsk_sct[i], id, cwtool_track, format_track, format_side) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, fmt->gcr_cbm.wr.prolog_value, fmt->gcr_cbm.wr.prolog_length) == -1) goto done;
+	for (i = 0; i < fmt->gcr_cbm.rw.sectors; i++) if (gcr_cbm_write_sector(&ffo_l1, &fmt->gcr_cbm, &dsk_sct[i], id, cwtool_track, format_track, format_side) == -1) goto done;
 	fifo_set_rd_ofs(ffo_l3, fifo_get_wr_ofs(ffo_l3));
-	if (gcr_write_fill(&ffo_l1, fmt->gcr_cbm.wr.epilog_value, fmt->gcr_cbm.wr.epilog_length) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, fmt->gcr_cbm.wr.epilog_value, fmt->gcr_cbm.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1);
-	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_cbm.rw.bnd, fmt->gcr_cbm.wr.precomp, 3) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_cbm.rw.bnd, fmt->gcr_cbm.wr.precomp, 3) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1);
+	return (result);
 	}
 
 
@@ -569,17 +701,19 @@ gcr_cbm_write_track(
 #define MAGIC_MATCH_SIMPLE		5
 #define MAGIC_MATCH_SIMPLE_FIXUP	6
 #define MAGIC_POSTCOMP_SIMPLE		7
-#define MAGIC_PROLOG_LENGTH		8
-#define MAGIC_EPILOG_LENGTH		9
-#define MAGIC_FILL_LENGTH		10
-#define MAGIC_FILL_VALUE		11
-#define MAGIC_PRECOMP			12
-#define MAGIC_SECTORS			13
-#define MAGIC_HEADER_ID			14
-#define MAGIC_DATA_ID			15
-#define MAGIC_TRACK_STEP		16
-#define MAGIC_BOUNDS_OLD		17
-#define MAGIC_BOUNDS_NEW		18
+#define MAGIC_PLL			8
+#define MAGIC_PLL_GAIN			9
+#define MAGIC_PROLOG_LENGTH		10
+#define MAGIC_EPILOG_LENGTH		11
+#define MAGIC_FILL_LENGTH		12
+#define MAGIC_FILL_VALUE		13
+#define MAGIC_PRECOMP			14
+#define MAGIC_SECTORS			15
+#define MAGIC_HEADER_ID			16
+#define MAGIC_DATA_ID			17
+#define MAGIC_TRACK_STEP		18
+#define MAGIC_BOUNDS_OLD		19
+#define MAGIC_BOUNDS_NEW		20
 
 
 
@@ -596,7 +730,8 @@ gcr_cbm_set_defaults(
 		.rd =
 			{
 			.sync_length = 40,
-			.flags       = 0
+			.flags       = 0,
+			.pll_gain    = { 0x80, 0x10 }
 			},
 		.wr =
 			{
@@ -650,8 +785,10 @@ gcr_cbm_set_read_option(
 	if (magic == MAGIC_IGNORE_DATA_ID)        return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_IGNORE_DATA_ID));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_MATCH_SIMPLE_FIXUP));
-	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE);
-	return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_POSTCOMP_SIMPLE));
+	if (magic == MAGIC_POSTCOMP_SIMPLE)       return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_POSTCOMP_SIMPLE));
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_PLL));
+	debug_error_condition(magic != MAGIC_PLL_GAIN);
+	return (setvalue_uchar(&fmt->gcr_cbm.rd.pll_gain[ofs], val, 0, 0xff));
 	}
 
 
@@ -784,6 +921,8 @@ static struct format_option		gcr_cbm_read_options[] =
 	FORMAT_OPTION_BOOLEAN("match_simple_fixup",    MAGIC_MATCH_SIMPLE_FIXUP,    1),
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",              MAGIC_POSTCOMP_SIMPLE,       1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",       MAGIC_POSTCOMP_SIMPLE,       1),
+	FORMAT_OPTION_BOOLEAN("pll",                   MAGIC_PLL,                   1),
+	FORMAT_OPTION_INTEGER("pll_gain",              MAGIC_PLL_GAIN,              2),
 	FORMAT_OPTION_END
 	};
 
@@ -23,6 +23,7 @@ struct gcr_cbm
 		{
 		unsigned short		sync_length;
 		unsigned char		flags;
+		unsigned char		pll_gain[2];
 		unsigned char		reserved;
 		}			rd;
 	struct
@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "container.h"
 #include "bitstream.h"
@@ -286,11 +287,11 @@ gcr_g64_align_track(
 	struct gcr_g64			*gcr_g64)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_tmp = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data;
+	struct fifo			ffo_tmp;
 	int				size[MAX_SYNCS];
 	int				end[MAX_SYNCS];
-	int				i, j, l, s;
+	int				i, j, l, s, result = -1;
 
 	/* check if track is already aligned */
 
@@ -309,20 +310,24 @@ gcr_g64_align_track(
 	/* align syncs so that bytes after it start on byte boundaries */
 
 	verbose_message(GENERIC, 3, "starting track alignment");
+	data    = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	ffo_tmp = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 	fifo_copy_block(ffo, &ffo_tmp, fifo_get_wr_ofs(ffo));
 	fifo_reset(ffo);
 	for (i = 1, j = 0; i < s; i++)
 		{
 		l = gcr_g64_align_bits(ffo, j + end[i - 1]);
-		if (l == -1) return (-1);
+		if (l == -1) goto done;
 		j += l;
 		l = (end[i] - size[i]) - (end[i - 1] - size[i - 1]);
 		verbose_message(GENERIC, 3, "copying %d bits", l);
 		fifo_copy_bitblock(&ffo_tmp, ffo, l);
 		}
-	if (gcr_g64_align_bits(ffo, fifo_get_wr_bitofs(ffo)) == -1) return (-1);
-
-	return (0);
+	if (gcr_g64_align_bits(ffo, fifo_get_wr_bitofs(ffo)) == -1) goto done;
+	result = 0;
+done:
+	scratch_free(data);
+	return (result);
 	}
 
 
@@ -364,11 +369,12 @@ gcr_g64_read_track(
 
 	{
 	int				length[4]   = { 6250, 6667, 7143, 7692 };
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1_tmp  = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data       = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1_tmp  = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 	int				pad_length2 = fmt->gcr_g64.rd.pad_length2;
 	int				limit       = fifo_get_limit(ffo_l1) - fmt->gcr_g64.rd.pad_length1 - pad_length2;
 	int				speed       = fmt->gcr_g64.rd.speed;
+	int				result      = 0;
 
 	/*
 	 * to ensure that we have no more than two consecutive zeros,
@@ -378,9 +384,9 @@ gcr_g64_read_track(
 	debug_error_condition((speed < 0) || (speed > 3));
 	if (fmt->gcr_g64.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->gcr_g64.rw.bnd[speed], 3);
 	bitstream_read(ffo_l0, &ffo_l1_tmp, fmt->gcr_g64.rw.bnd[speed], 3);
-	if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value1, fmt->gcr_g64.rd.pad_length1) == -1) return (0);
-	if (fmt->gcr_g64.rd.flags & FLAG_STRIP_TRACK) if (gcr_g64_strip_track(&ffo_l1_tmp, &fmt->gcr_g64, ffo_l1, limit) == -1) return (0);
-	if (fmt->gcr_g64.rd.flags & FLAG_ALIGN_TRACK) if (gcr_g64_align_track(ffo_l1, &fmt->gcr_g64) == -1) return (0);
+	if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value1, fmt->gcr_g64.rd.pad_length1) == -1) goto done;
+	if (fmt->gcr_g64.rd.flags & FLAG_STRIP_TRACK) if (gcr_g64_strip_track(&ffo_l1_tmp, &fmt->gcr_g64, ffo_l1, limit) == -1) goto done;
+	if (fmt->gcr_g64.rd.flags & FLAG_ALIGN_TRACK) if (gcr_g64_align_track(ffo_l1, &fmt->gcr_g64) == -1) goto done;
 
 	/*
 	 * if pad_length2 is zero, we try to fill up the track to a standard
@@ -388,10 +394,13 @@ gcr_g64_read_track(
 	 */
 
 	if (pad_length2 == 0) pad_length2 = length[speed] - fifo_get_wr_ofs(ffo_l1);
-	if (pad_length2 > 0) if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value2, pad_length2) == -1) return (0);
+	if (pad_length2 > 0) if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value2, pad_length2) == -1) goto done;
 	fifo_write_flush(ffo_l1);
 	fifo_set_speed(ffo_l1, speed);
-	return (1);
+	result = 1;
+done:
+	scratch_free(data);
+	return (result);
 	}
 
 
@@ -411,10 +420,11 @@ gcr_g64_write_track(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data_l1_tmp[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1_tmp = FIFO_INIT(data_l1_tmp, sizeof (data_l1_tmp));
+	unsigned char			*data_l1_tmp = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1_tmp = FIFO_INIT(data_l1_tmp, GLOBAL_MAX_TRACK_SIZE);
 	int				limit      = fifo_get_limit(&ffo_l1_tmp) - fmt->gcr_g64.wr.prolog_length - fmt->gcr_g64.wr.epilog_length;
 	int				speed      = fifo_get_speed(ffo_l1);
+	int				result     = 0;
 
 	/*
 	 * to ensure that we have no more than two consecutive zeros,
@@ -422,12 +432,15 @@ gcr_g64_write_track(
 	 */
 
 	debug_error_condition((speed < 0) || (speed > 3));
-	if (gcr_write_fill(&ffo_l1_tmp, fmt->gcr_g64.wr.prolog_value, fmt->gcr_g64.wr.prolog_length) == -1) return (0);
-	if (fmt->gcr_g64.wr.flags & FLAG_STRIP_TRACK) if (gcr_g64_strip_track(ffo_l1, &fmt->gcr_g64, &ffo_l1_tmp, limit) == -1) return (0);
-	if (gcr_write_fill(&ffo_l1_tmp, fmt->gcr_g64.wr.epilog_value, fmt->gcr_g64.wr.epilog_length) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1_tmp, fmt->gcr_g64.wr.prolog_value, fmt->gcr_g64.wr.prolog_length) == -1) goto done;
+	if (fmt->gcr_g64.wr.flags & FLAG_STRIP_TRACK) if (gcr_g64_strip_track(ffo_l1, &fmt->gcr_g64, &ffo_l1_tmp, limit) == -1) goto done;
+	if (gcr_write_fill(&ffo_l1_tmp, fmt->gcr_g64.wr.epilog_value, fmt->gcr_g64.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1_tmp);
-	if (bitstream_write(&ffo_l1_tmp, ffo_l0, fmt->gcr_g64.rw.bnd[speed], fmt->gcr_g64.wr.precomp[speed], 3) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1_tmp, ffo_l0, fmt->gcr_g64.rw.bnd[speed], fmt->gcr_g64.wr.precomp[speed], 3) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1_tmp);
+	return (result);
 	}
 
 
@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "gcr.h"
 #include "range.h"
@@ -42,6 +43,10 @@
 
 
 
+#define GCR_WRITE_BLOCK_SIZE		128
+
+
+
 /****************************************************************************
  * gcr_read_sync
  ****************************************************************************/
@@ -177,16 +182,27 @@ gcr_write_bytes(
 		0x0a, 0x0b, 0x12, 0x13, 0x0e, 0x0f, 0x16, 0x17,
 		0x09, 0x19, 0x1a, 0x1b, 0x0d, 0x1d, 0x1e, 0x15
 		};
-	int				i, n1, n2;
+	cw_u32_t			bits[GCR_WRITE_BLOCK_SIZE];
+	int				i, j, n;
+
+	/*
+	 * two bytes give four nibbles and 20 encoded bits, so they are
+	 * written with one value. an odd last byte is written with 10 bits
+	 */
 
 	verbose_message(GENERIC, 2, "writing %d bytes at bit offset %d", size, fifo_get_wr_bitofs(ffo_l1));
-	for (i = 0; i < size; i++)
+	for (i = 0; i + 1 < size; i += 2 * n)
 		{
-		n1 = (data[i] >> 4) & 0x0f;
-		if (fifo_write_bits(ffo_l1, encode[n1], 5) == -1) return (-1);
-		n2 = data[i] & 0x0f;
-		if (fifo_write_bits(ffo_l1, encode[n2], 5) == -1) return (-1);
+		n = (size - i) / 2;
+		if (n > GCR_WRITE_BLOCK_SIZE) n = GCR_WRITE_BLOCK_SIZE;
+		for (j = 0; j < n; j++) bits[j] =
+			(encode[data[i + 2 * j] >> 4] << 15) |
+			(encode[data[i + 2 * j] & 0x0f] << 10) |
+			(encode[data[i + 2 * j + 1] >> 4] << 5) |
+			encode[data[i + 2 * j + 1] & 0x0f];
+		if (fifo_write_bits_block(ffo_l1, bits, 20, n) == -1) return (-1);
 		}
+	if (i < size) return (fifo_write_bits(ffo_l1, (encode[data[i] >> 4] << 5) | encode[data[i] & 0x0f], 10));
 	return (0);
 	}
 
@@ -210,6 +226,7 @@ gcr_write_bytes(
 #define FLAG_RD_MATCH_SIMPLE		(1 << 3)
 #define FLAG_RD_MATCH_SIMPLE_FIXUP	(1 << 4)
 #define FLAG_RD_POSTCOMP_SIMPLE		(1 << 5)
+#define FLAG_RD_PLL			(1 << 6)
 #define FLAG_RW_FLIP_TRACK_ID		(1 << 0)
 
 
@@ -496,12 +513,14 @@ gcr_v9000_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->gcr_v9.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple_adjust(ffo_l0, fmt->gcr_v9.rw.bnd, 3, fmt->gcr_v9.rd.postcomp_simple_adjust[0], fmt->gcr_v9.rd.postcomp_simple_adjust[1]);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_v9.rw.bnd, 3);
+	if (fmt->gcr_v9.rd.flags & FLAG_RD_PLL) bitstream_read_pll(ffo_l0, &ffo_l1, fmt->gcr_v9.rw.bnd, 3, fmt->gcr_v9.rd.pll_gain[0], fmt->gcr_v9.rd.pll_gain[1]);
+	else bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_v9.rw.bnd, 3);
 	while (gcr_v9000_read_sector(&ffo_l1, &fmt->gcr_v9, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	scratch_free(data);
 	}
 
 
@@ -533,6 +552,8 @@ gcr_v9000_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->gcr_v9.rw.bnd,
 		.bnd_size     = 3,
+		.pll          = fmt->gcr_v9.rd.flags & FLAG_RD_PLL,
+		.pll_gain     = { fmt->gcr_v9.rd.pll_gain[0], fmt->gcr_v9.rd.pll_gain[1] },
 		.callback     = gcr_v9000_read_track2,
 		.merge_two    = fmt->gcr_v9.rd.flags & FLAG_RD_MATCH_SIMPLE,
 		.merge_all    = fmt->gcr_v9.rd.flags & FLAG_RD_MATCH_SIMPLE,
@@ -561,17 +582,20 @@ gcr_v9000_write_track(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data_l1[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data_l1, sizeof (data_l1));
-	int				i;
+	unsigned char			*data_l1 = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data_l1, GLOBAL_MAX_TRACK_SIZE);
+	int				i, result = 0;
 
-	if (gcr_write_fill(&ffo_l1, fmt->gcr_v9.wr.prolog_value, fmt->gcr_v9.wr.prolog_length) == -1) return (0);
-	for (i = 0; i < fmt->gcr_v9.rw.sectors; i++) if (gcr_v9000_write_sector(&ffo_l1, &fmt->gcr_v9, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, fmt->gcr_v9.wr.prolog_value, fmt->gcr_v9.wr.prolog_length) == -1) goto done;
+	for (i = 0; i < fmt->gcr_v9.rw.sectors; i++) if (gcr_v9000_write_sector(&ffo_l1, &fmt->gcr_v9, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) goto done;
 	fifo_set_rd_ofs(ffo_l3, fifo_get_wr_ofs(ffo_l3));
-	if (gcr_write_fill(&ffo_l1, fmt->gcr_v9.wr.epilog_value, fmt->gcr_v9.wr.epilog_length) == -1) return (0);
+	if (gcr_write_fill(&ffo_l1, fmt->gcr_v9.wr.epilog_value, fmt->gcr_v9.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1);
-	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_v9.rw.bnd, fmt->gcr_v9.wr.precomp, 3) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1, ffo_l0, fmt->gcr_v9.rw.bnd, fmt->gcr_v9.wr.precomp, 3) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1);
+	return (result);
 	}
 
 
@@ -595,18 +619,20 @@ gcr_v9000_write_track(
 #define MAGIC_MATCH_SIMPLE_FIXUP	7
 #define MAGIC_POSTCOMP_SIMPLE		8
 #define MAGIC_POSTCOMP_SIMPLE_ADJUST	9
-#define MAGIC_PROLOG_LENGTH		10
-#define MAGIC_EPILOG_LENGTH		11
-#define MAGIC_FILL_LENGTH		12
-#define MAGIC_FILL_VALUE		13
-#define MAGIC_PRECOMP			14
-#define MAGIC_SECTORS			15
-#define MAGIC_HEADER_ID			16
-#define MAGIC_DATA_ID			17
-#define MAGIC_FLIP_TRACK_ID		18
-#define MAGIC_SIDE_OFFSET		19
-#define MAGIC_BOUNDS_OLD		20
-#define MAGIC_BOUNDS_NEW		21
+#define MAGIC_PLL			10
+#define MAGIC_PLL_GAIN			11
+#define MAGIC_PROLOG_LENGTH		12
+#define MAGIC_EPILOG_LENGTH		13
+#define MAGIC_FILL_LENGTH		14
+#define MAGIC_FILL_VALUE		15
+#define MAGIC_PRECOMP			16
+#define MAGIC_SECTORS			17
+#define MAGIC_HEADER_ID			18
+#define MAGIC_DATA_ID			19
+#define MAGIC_FLIP_TRACK_ID		20
+#define MAGIC_SIDE_OFFSET		21
+#define MAGIC_BOUNDS_OLD		22
+#define MAGIC_BOUNDS_NEW		23
 
 
 
@@ -625,7 +651,8 @@ gcr_v9000_set_defaults(
 			.sync_length1           = 60,
 			.sync_length2           = 50,
 			.postcomp_simple_adjust = { },
-			.flags                  = 0
+			.flags                  = 0,
+			.pll_gain               = { 0x80, 0x10 }
 			},
 		.wr =
 			{
@@ -681,8 +708,10 @@ gcr_v9000_set_read_option(
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_MATCH_SIMPLE_FIXUP));
 	if (magic == MAGIC_POSTCOMP_SIMPLE)       return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_POSTCOMP_SIMPLE));
-	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE_ADJUST);
-	return (setvalue_short(&fmt->gcr_v9.rd.postcomp_simple_adjust[ofs], val, -0x0400, 0x0400));
+	if (magic == MAGIC_POSTCOMP_SIMPLE_ADJUST) return (setvalue_short(&fmt->gcr_v9.rd.postcomp_simple_adjust[ofs], val, -0x0400, 0x0400));
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_PLL));
+	debug_error_condition(magic != MAGIC_PLL_GAIN);
+	return (setvalue_uchar(&fmt->gcr_v9.rd.pll_gain[ofs], val, 0, 0xff));
 	}
 
 
@@ -819,6 +848,8 @@ static struct format_option		gcr_v9000_read_options[] =
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",               MAGIC_POSTCOMP_SIMPLE,        1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",        MAGIC_POSTCOMP_SIMPLE,        1),
 	FORMAT_OPTION_INTEGER("postcomp_simple_adjust", MAGIC_POSTCOMP_SIMPLE_ADJUST, 2),
+	FORMAT_OPTION_BOOLEAN("pll",                    MAGIC_PLL,                    1),
+	FORMAT_OPTION_INTEGER("pll_gain",               MAGIC_PLL_GAIN,               2),
 	FORMAT_OPTION_END
 	};
 
@@ -25,7 +25,8 @@ struct gcr_v9000
 		unsigned short		sync_length2;
 		short			postcomp_simple_adjust[2];
 		unsigned char		flags;
-		unsigned char		reserved[3];
+		unsigned char		pll_gain[2];
+		unsigned char		reserved;
 		}			rd;
 	struct
 		{
@@ -127,7 +127,7 @@ histogram_long(
 
 	{
 	cw_char_t			line[4096];
-	cw_count_t			m, max;
+	cw_count_t			l, m, max;
 	cw_index_t			i, j;
 
 	max = m = histogram_get_max(histogram, 1);
@@ -135,13 +135,10 @@ histogram_long(
 	for (i = 20; i-- > 0; )
 		{
 		m = histogram_get_scale(i, m, max);
-		printf("%5d ", m);
-		for (j = 0; j < GLOBAL_NR_PULSE_LENGTHS; j++)
-			{
-			if (histogram[j] > m) printf("*");
-			else printf(" ");
-			}
-		printf("\n");
+		l = string_snprintf(line, sizeof (line), "%5d ", m);
+		for (j = 0; j < GLOBAL_NR_PULSE_LENGTHS; j++) line[l++] = (histogram[j] > m) ? '*' : ' ';
+		line[l] = '\0';
+		printf("%s\n", line);
 		}
 	printf("      00000000000000001111111111111111222222222222222233333333333333334444444444444444555555555555555566666666666666667777777777777777\n");
 	printf("      0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\n");
@@ -163,7 +160,7 @@ histogram_short(
 
 	{
 	cw_char_t			line[4096];
-	cw_count_t			m, max;
+	cw_count_t			l, m, max;
 	cw_index_t			i, j;
 
 	max = m = histogram_get_max(histogram, 2);
@@ -171,13 +168,10 @@ histogram_short(
 	for (i = 20; i-- > 0; )
 		{
 		m = histogram_get_scale(i, m, max);
-		printf("%5d ", m);
-		for (j = 0; j < GLOBAL_NR_PULSE_LENGTHS; j += 2)
-			{
-			if (histogram[j] + histogram[j + 1] > m) printf("*");
-			else printf(" ");
-			}
-		printf("\n");
+		l = string_snprintf(line, sizeof (line), "%5d ", m);
+		for (j = 0; j < GLOBAL_NR_PULSE_LENGTHS; j += 2) line[l++] = (histogram[j] + histogram[j + 1] > m) ? '*' : ' ';
+		line[l] = '\0';
+		printf("%s\n", line);
 		}
 	printf("      0000000011111111222222223333333344444444555555556666666677777777\n");
 	printf("      02468ace02468ace02468ace02468ace02468ace02468ace02468ace02468ace\n");
@@ -300,6 +294,91 @@ histogram_calculate(
 
 
 
+/****************************************************************************
+ * histogram_calibrate
+ ****************************************************************************/
+cw_bool_t
+histogram_calibrate(
+	struct fifo			*ffo,
+	struct bounds			*bnd,
+	struct bounds			*bnd_cal,
+	cw_size_t			bnd_size)
+
+	{
+	cw_raw8_t			*data = fifo_get_data(ffo);
+	cw_hist_t			histogram = { };
+	cw_count_t			peak[GLOBAL_NR_BOUNDS];
+	cw_count_t			low[GLOBAL_NR_BOUNDS];
+	cw_count_t			high[GLOBAL_NR_BOUNDS];
+	cw_count64_t			sum, count;
+	cw_count_t			minimum, b;
+	cw_index_t			i, j, k;
+
+	/*
+	 * adapt bounds to the pulses actually found on this track, so a
+	 * drive spinning a bit too fast or too slow does not push the
+	 * peaks out of the configured bounds. starting with the write
+	 * values the boundaries are placed midway between neighbouring
+	 * peaks and the peaks are searched again within these boundaries
+	 * as weighted mean. all positions are given in 1/256 counter
+	 * values like in struct bounds. only the histogram on the stack
+	 * is needed, so this is much cheaper than decoding the track.
+	 * CW_BOOL_FALSE is returned and bnd_cal is a copy of bnd, if the
+	 * peaks are not clearly visible
+	 */
+
+	error_condition(bnd_size > GLOBAL_NR_BOUNDS);
+	for (i = 0; i < bnd_size; i++) bnd_cal[i] = bnd[i];
+	if (bnd_size < 2) return (CW_BOOL_FALSE);
+	for (i = fifo_get_rd_ofs(ffo); i < fifo_get_wr_ofs(ffo); i++) histogram[data[i] & GLOBAL_PULSE_LENGTH_MASK]++;
+	minimum = (fifo_get_wr_ofs(ffo) - fifo_get_rd_ofs(ffo)) / 256;
+	if (minimum < 16) minimum = 16;
+	for (i = 0; i < bnd_size; i++) peak[i] = bnd[i].write;
+	for (k = 0; ; k++)
+		{
+		for (i = 0; i < bnd_size - 1; i++)
+			{
+			b = ((peak[i] + peak[i + 1]) / 2 + 0x80) >> 8;
+			high[i]    = b - 1;
+			low[i + 1] = b;
+			}
+		b = (2 * peak[0] - (low[1] << 8) + 0xff) >> 8;
+		low[0] = (b < 0) ? 0 : b;
+		b = (2 * peak[i] - (high[i - 1] << 8) + 0xff) >> 8;
+		high[i] = (b >= GLOBAL_NR_PULSE_LENGTHS) ? GLOBAL_NR_PULSE_LENGTHS - 1 : b;
+		if (k == 4) break;
+		for (i = 0; i < bnd_size; i++)
+			{
+			for (j = low[i], sum = count = 0; j <= high[i]; j++)
+				{
+				sum   += (cw_count64_t) (j << 8) * histogram[j];
+				count += histogram[j];
+				}
+			if (count < minimum) return (CW_BOOL_FALSE);
+			peak[i] = sum / count;
+			if ((i > 0) && (peak[i] <= peak[i - 1] + 0x200)) return (CW_BOOL_FALSE);
+			}
+		}
+	for (i = 0; i < bnd_size; i++) if (low[i] > high[i]) return (CW_BOOL_FALSE);
+	for (i = 0; i < bnd_size; i++)
+		{
+		bnd_cal[i].read_low  = low[i] << 8;
+		bnd_cal[i].read_high = high[i] << 8;
+		}
+
+	/*
+	 * the outer limits are never narrowed, so pulses accepted with
+	 * the configured bounds are still accepted
+	 */
+
+	i = bnd_size - 1;
+	if (bnd_cal[0].read_low > bnd[0].read_low) bnd_cal[0].read_low = bnd[0].read_low;
+	if (bnd_cal[i].read_high < bnd[i].read_high) bnd_cal[i].read_high = bnd[i].read_high;
+	return (CW_BOOL_TRUE);
+	}
+
+
+
 /****************************************************************************
  * histogram_blur
  ****************************************************************************/
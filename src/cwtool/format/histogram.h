@@ -53,6 +53,13 @@ histogram_calculate(
 	cw_hist_t			histogram,
 	cw_hist2_t			histogram2);
 
+extern cw_bool_t
+histogram_calibrate(
+	struct fifo			*ffo,
+	struct bounds			*bnd,
+	struct bounds			*bnd_cal,
+	cw_size_t			bnd_size);
+
 extern cw_void_t
 histogram_blur(
 	cw_hist_t			src,
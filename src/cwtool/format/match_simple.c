@@ -17,6 +17,11 @@
  * - use error information from format description (absolute difference of
  *   pulse length to expected pulse length, favor those pulse lengths with
  *   less error)
+ * - with more than two reads (1) is a consensus of all reads so far, each
+ *   of its pulses also counts how many reads agreed on it (votes). a new
+ *   read is aligned once against the consensus and folded into it, so
+ *   each read costs one merge. the consensus and the new read merged
+ *   with it are given to the callback as additional candidates
  * - some examples of possible errors (numbers in hex):
  *   a) long pulse 54 in (2) degenerated to three shorter pulses in (1)
  *      22, 13, 1c
@@ -74,6 +79,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "match_simple.h"
 #include "../error.h"
@@ -82,6 +88,7 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "bitstream.h"
 #include "container.h"
 
@@ -101,6 +108,7 @@
 #define WINDOW_SIZE			512
 #define PULSE_JITTER			4
 #define MIN_MATCHES			(WINDOW_SIZE - 3 * (WINDOW_SIZE / 64))
+#define MAX_VOTES			0xff
 
 struct match_state
 	{
@@ -112,6 +120,14 @@ struct match_state
 	cw_size_t			data2_limit;
 	};
 
+struct match_track
+	{
+	cw_raw8_t			*data;
+	cw_raw8_t			*error;
+	cw_raw8_t			*votes;
+	cw_size_t			limit;
+	};
+
 
 
 
@@ -370,77 +386,109 @@ match_simple_search_end(
 
 
 /****************************************************************************
- * match_simple_merge
+ * match_simple_fold
  ****************************************************************************/
-static cw_size_t
-match_simple_merge(
-	cw_raw8_t			*data_dst,
-	cw_raw8_t			*error_dst,
-	cw_size_t			data_dst_limit,
-	cw_raw8_t			*data1,
-	cw_raw8_t			*error1,
-	cw_size_t			data1_limit,
-	cw_raw8_t			*data2,
-	cw_raw8_t			*error2,
-	cw_size_t			data2_limit,
+static cw_void_t
+match_simple_fold(
+	struct match_track		*mat_trk_dst,
+	struct match_track		*mat_trk_two,
+	struct match_track		*mat_trk_cns,
+	struct match_track		*mat_trk_rd,
 	cw_index_t			start,
 	cw_index_t			end,
 	cw_count_t			pulse_jitter)
 
 	{
-	cw_index_t			d, i, j, k;
+	cw_index_t			c, t, i, j, k, l;
 	cw_count_t			s1, s2;
-	cw_raw8_t			d1, d2, e1, e2;
+	cw_raw8_t			d1, d2, e1, e2, v1, v;
 
-	verbose_message(GENERIC, 3, "match_simple_merge: start = %d, end = %d", start, end);
-	d = i = k = 0;
+	verbose_message(GENERIC, 3, "match_simple_fold: start = %d, end = %d", start, end);
+	c = t = i = k = l = v = 0;
 	j = start;
 	s1 = s2 = 0;
-	while ((i < data1_limit) && (j < data2_limit) && (j < end) && (k < data_dst_limit))
+	while ((i < mat_trk_cns->limit) && (j < mat_trk_rd->limit) && (j < end) && (k < mat_trk_dst->limit) && (l < mat_trk_two->limit))
 		{
-		d1 = data1[i] & GLOBAL_PULSE_LENGTH_MASK;
-		d2 = data2[j] & GLOBAL_PULSE_LENGTH_MASK;
-		e1 = error1[i];
-		e2 = error2[j];
+		d1 = mat_trk_cns->data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		d2 = mat_trk_rd->data[j] & GLOBAL_PULSE_LENGTH_MASK;
+		e1 = mat_trk_cns->error[i];
+		e2 = mat_trk_rd->error[j];
+		v1 = mat_trk_cns->votes[i];
 
-		/* check if pulse lengths match */
+		/*
+		 * between two points where both pulse sums match, take the
+		 * pulses of the side chosen at the first of them (c for the
+		 * consensus with v votes, t for the merge_two candidate)
+		 */
 
 		if (s1 < s2 - pulse_jitter)
 			{
 			s1 += d1, i++;
-			if (d == 1) error_dst[k] = e1, data_dst[k] = d1, k++;
-/*			verbose_message(GENERIC, 4, "match_simple_merge: %02x(%04x,%02x)                [%2d]", d1, s1, e1, s1 - s2);*/
+			if (c == 1) mat_trk_dst->error[k] = e1, mat_trk_dst->data[k] = d1, mat_trk_dst->votes[k] = v, k++;
+			if (t == 1) mat_trk_two->error[l] = e1, mat_trk_two->data[l] = d1, l++;
 			}
 		else if (s2 < s1 - pulse_jitter)
 			{
 			s2 += d2, j++;
-			if (d == 2) error_dst[k] = e2, data_dst[k] = d2, k++;
-/*			verbose_message(GENERIC, 4, "match_simple_merge:             %02x(%04x,%02x)    [%2d]", d2, s2, e2, s1 - s2);*/
+			if (c == 2) mat_trk_dst->error[k] = e2, mat_trk_dst->data[k] = d2, mat_trk_dst->votes[k] = v, k++;
+			if (t == 2) mat_trk_two->error[l] = e2, mat_trk_two->data[l] = d2, l++;
+			}
+		else if ((d1 >= d2 - pulse_jitter) && (d2 >= d1 - pulse_jitter))
+			{
+
+			/* both agree, count the vote and keep the better pulse */
+
+			s1 = d1, i++;
+			s2 = d2, j++;
+			c = t = 1;
+			v = (v1 < MAX_VOTES) ? v1 + 1 : v1;
+			if (e2 < e1) mat_trk_dst->error[k] = e2, mat_trk_dst->data[k] = d2;
+			else mat_trk_dst->error[k] = e1, mat_trk_dst->data[k] = d1;
+			mat_trk_dst->votes[k] = v;
+			mat_trk_two->error[l] = e1, mat_trk_two->data[l] = d1;
+			k++, l++;
 			}
 		else
 			{
+
+			/*
+			 * disagreement, like a majority vote the current track
+			 * takes one vote away from the consensus. if the
+			 * consensus has only one vote left, the errors decide
+			 * and the winner is marked as disputed (no votes), a
+			 * disputed consensus is replaced by the current track.
+			 * the merge_two candidate only looks at the errors and
+			 * prefers the current track if they are equal, so both
+			 * candidates differ on ties
+			 */
+
 			s1 = d1, i++;
 			s2 = d2, j++;
-			if (((d1 >= d2 - pulse_jitter) && (d2 >= d1 - pulse_jitter)) || (e1 <= e2))
-				{
-				d = 1, error_dst[k] = e1, data_dst[k] = d1;
-				}
-			else
-				{
-				d = 2, error_dst[k] = e2, data_dst[k] = d2;
-				}
-/*			verbose_message(GENERIC, 4, "match_simple_merge: %02x(%04x,%02x) %02x(%04x,%02x) %02x(%02x) [%2d]", d1, s1, e1, d2, s2, e2, data_dst[k], error_dst[k], s1 - s2);*/
-			k++;
+			if (v1 > 1) c = 1, v = v1 - 1;
+			else if (v1 == 1) c = (e1 <= e2) ? 1 : 2, v = 0;
+			else c = 2, v = 1;
+			t = (e2 <= e1) ? 2 : 1;
+			if (c == 1) mat_trk_dst->error[k] = e1, mat_trk_dst->data[k] = d1;
+			else mat_trk_dst->error[k] = e2, mat_trk_dst->data[k] = d2;
+			mat_trk_dst->votes[k] = v;
+			if (t == 1) mat_trk_two->error[l] = e1, mat_trk_two->data[l] = d1;
+			else mat_trk_two->error[l] = e2, mat_trk_two->data[l] = d2;
+			k++, l++;
 			}
 		}
-	while ((i < data1_limit) && (k < data_dst_limit))
+
+	/* the current track did not cover the rest, keep it unchanged */
+
+	while ((i < mat_trk_cns->limit) && (k < mat_trk_dst->limit) && (l < mat_trk_two->limit))
 		{
-		data_dst[k] = data1[i];
-		error_dst[k] = error1[i];
-		k++, i++;
+		mat_trk_dst->data[k]  = mat_trk_two->data[l]  = mat_trk_cns->data[i];
+		mat_trk_dst->error[k] = mat_trk_two->error[l] = mat_trk_cns->error[i];
+		mat_trk_dst->votes[k] = mat_trk_cns->votes[i];
+		k++, l++, i++;
 		}
-	verbose_message(GENERIC, 3, "match_simple_merge: new size = %d", k);
-	return (k);
+	mat_trk_dst->limit = k;
+	mat_trk_two->limit = l;
+	verbose_message(GENERIC, 3, "match_simple_fold: new size = %d", k);
 	}
 
 
@@ -485,14 +533,23 @@ match_simple_store(
 	struct match_simple_info	*mat_sim_nfo)
 
 	{
-	struct bitstream_map		bst_map[GLOBAL_MAX_TRACK_SIZE];
+	struct bitstream_map		*bst_map = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (struct bitstream_map));
 	cw_size_t			size;
 	cw_index_t			i;
 
 	/* get error information (deviation from write bounds) */
 
 	size = fifo_get_wr_ofs(mat_sim_nfo->ffo_l0);
-	bitstream_read_map(
+	if (mat_sim_nfo->pll) bitstream_read_map_pll(
+		mat_sim_nfo->ffo_l0,
+		NULL,
+		mat_sim_nfo->bnd,
+		mat_sim_nfo->bnd_size,
+		mat_sim_nfo->pll_gain[0],
+		mat_sim_nfo->pll_gain[1],
+		bst_map,
+		GLOBAL_MAX_TRACK_SIZE);
+	else bitstream_read_map(
 		mat_sim_nfo->ffo_l0,
 		NULL,
 		mat_sim_nfo->bnd,
@@ -503,7 +560,10 @@ match_simple_store(
 
 	/*
 	 * store raw data in container. store a copy of first track data.
-	 * this is later used to mix all tracks together
+	 * this is the consensus all other tracks are folded into, each
+	 * of its pulses has one vote so far. the copy covers the whole
+	 * buffer, because the consensus may grow, the data of ffo_l0 is
+	 * only valid up to size, so clear the rest
 	 */
 
 	if (container_get_entries(mat_sim_nfo->con) == 0)
@@ -513,6 +573,9 @@ match_simple_store(
 			fifo_get_data(mat_sim_nfo->ffo_l0),
 			NULL,
 			GLOBAL_MAX_TRACK_SIZE);
+		memset(&container_get_data(mat_sim_nfo->con, 0)[size], 0, GLOBAL_MAX_TRACK_SIZE - size);
+		memset(container_get_votes(mat_sim_nfo->con, 0), 1, size);
+		container_set_limit(mat_sim_nfo->con, 0, size);
 		match_simple_store2(mat_sim_nfo, bst_map, size, 0);
 		}
 	i = container_store_data_and_error(
@@ -521,6 +584,7 @@ match_simple_store(
 		NULL,
 		size);
 	match_simple_store2(mat_sim_nfo, bst_map, size, i);
+	scratch_free(bst_map);
 
 	/* return container number */
 
@@ -552,132 +616,106 @@ match_simple_do_callback(
 
 
 /****************************************************************************
- * match_simple_merge2
+ * match_simple_consensus
  ****************************************************************************/
 static cw_size_t
-match_simple_merge2(
+match_simple_consensus(
 	struct match_simple_info	*mat_sim_nfo,
-	cw_raw8_t			*data_dst,
-	cw_raw8_t			*error_dst,
-	cw_size_t			data_dst_limit,
-	cw_index_t			index1,
-	cw_index_t			index2)
+	cw_raw8_t			*data_two,
+	cw_raw8_t			*error_two,
+	cw_size_t			data_two_limit,
+	cw_index_t			index)
 
 	{
-	cw_raw8_t			data3[GLOBAL_MAX_TRACK_SIZE];
-	cw_raw8_t			error3[GLOBAL_MAX_TRACK_SIZE];
-	cw_raw8_t			*data1, *error1, *data2, *error2;
-	cw_size_t			data1_limit, data2_limit, data3_limit;
+	struct container		*con = mat_sim_nfo->con;
+	struct match_track		mat_trk_dst, mat_trk_two, mat_trk_cns, mat_trk_rd;
+	cw_size_t			size = container_get_size(con, 0);
 	cw_index_t			i, j;
 
-	data1       = container_get_data(mat_sim_nfo->con, index1);
-	error1      = container_get_error(mat_sim_nfo->con, index1);
-	data1_limit = container_get_limit(mat_sim_nfo->con, index1);
-	data2       = container_get_data(mat_sim_nfo->con, index2);
-	error2      = container_get_error(mat_sim_nfo->con, index2);
-	data2_limit = container_get_limit(mat_sim_nfo->con, index2);
-
-	i = match_simple_search_start(
-		data1,
-		data1_limit,
-		data2,
-		data2_limit,
-		SEARCH_START,
-		WINDOW_SIZE,
-		PULSE_JITTER,
-		MIN_MATCHES);
-
-	if (i == -1) return (-1);
-
-	j = match_simple_search_end(
-		data1,
-		data1_limit,
-		data2,
-		data2_limit,
-		SEARCH_START,
-		i,
-		WINDOW_SIZE,
-		PULSE_JITTER,
-		MIN_MATCHES);
+	mat_trk_cns = (struct match_track)
+		{
+		.data  = &container_get_data(con, 0)[SEARCH_START],
+		.error = &container_get_error(con, 0)[SEARCH_START],
+		.votes = &container_get_votes(con, 0)[SEARCH_START],
+		.limit = container_get_limit(con, 0) - SEARCH_START
+		};
+	mat_trk_rd = (struct match_track)
+		{
+		.data  = container_get_data(con, index),
+		.error = container_get_error(con, index),
+		.limit = container_get_limit(con, index)
+		};
 
-	data3_limit = match_simple_merge(
-		data3,
-		error3,
-		GLOBAL_MAX_TRACK_SIZE,
-		&data1[SEARCH_START],
-		&error1[SEARCH_START],
-		data1_limit - SEARCH_START,
-		data2,
-		error2,
-		data2_limit,
-		i,
-		j,
-		PULSE_JITTER);
+	/* align the consensus once within the current track */
 
 	i = match_simple_search_start(
-		data2,
-		data2_limit,
-		data3,
-		data3_limit,
-		SEARCH_START,
+		mat_trk_cns.data,
+		mat_trk_cns.limit,
+		mat_trk_rd.data,
+		mat_trk_rd.limit,
+		0,
 		WINDOW_SIZE,
 		PULSE_JITTER,
 		MIN_MATCHES);
 
-	/* if data contains a complete rotation this should not happen */
-
 	if (i == -1) return (-1);
 
 	j = match_simple_search_end(
-		data2,
-		data2_limit,
-		data3,
-		data3_limit,
-		SEARCH_START,
+		mat_trk_cns.data,
+		mat_trk_cns.limit,
+		mat_trk_rd.data,
+		mat_trk_rd.limit,
+		0,
 		i,
 		WINDOW_SIZE,
 		PULSE_JITTER,
 		MIN_MATCHES);
 
-	data_dst_limit = match_simple_merge(
-		data_dst,
-		error_dst,
-		data_dst_limit,
-		&data2[SEARCH_START],
-		&error2[SEARCH_START],
-		data2_limit - SEARCH_START,
-		data3,
-		error3,
-		data3_limit,
+	/* fold the current track into a new consensus */
+
+	mat_trk_dst = (struct match_track)
+		{
+		.data  = scratch_alloc(size * sizeof (cw_raw8_t)),
+		.error = scratch_alloc(size * sizeof (cw_raw8_t)),
+		.votes = scratch_alloc(size * sizeof (cw_raw8_t)),
+		.limit = size
+		};
+	mat_trk_two = (struct match_track)
+		{
+		.data  = data_two,
+		.error = error_two,
+		.limit = data_two_limit
+		};
+	match_simple_fold(
+		&mat_trk_dst,
+		&mat_trk_two,
+		&mat_trk_cns,
+		&mat_trk_rd,
 		i,
 		j,
 		PULSE_JITTER);
-
-	return (data_dst_limit);
+	memcpy(container_get_data(con, 0), mat_trk_dst.data, mat_trk_dst.limit);
+	memcpy(container_get_error(con, 0), mat_trk_dst.error, mat_trk_dst.limit);
+	memcpy(container_get_votes(con, 0), mat_trk_dst.votes, mat_trk_dst.limit);
+	container_set_limit(con, 0, mat_trk_dst.limit);
+	scratch_free(mat_trk_dst.votes);
+	scratch_free(mat_trk_dst.error);
+	scratch_free(mat_trk_dst.data);
+	return (mat_trk_two.limit);
 	}
 
 
 
-
 /****************************************************************************
- *
- * global functions
- *
+ * match_simple2
  ****************************************************************************/
-
-
-
-
-/****************************************************************************
- * match_simple
- ****************************************************************************/
-cw_void_t
-match_simple(
+static cw_void_t
+match_simple2(
 	struct match_simple_info	*mat_sim_nfo)
 
 	{
-	cw_raw8_t			error_dummy[GLOBAL_MAX_TRACK_SIZE];
-	cw_index_t			i, j;
+	cw_raw8_t			*error_dummy = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (cw_raw8_t));
+	cw_index_t			i;
 	cw_size_t			limit;
 
 	/* store raw data for later usage */
@@ -688,18 +726,29 @@ match_simple(
 
 	match_simple_do_callback(mat_sim_nfo, mat_sim_nfo->con);
 
-	/* merge the current track with another track read earlier */
+	/*
+	 * fold the current track into the consensus of all tracks read
+	 * so far. this needs one alignment and one linear pass for each
+	 * track, regardless of how many tracks were read before
+	 */
+
+	if ((! mat_sim_nfo->merge_two) && (! mat_sim_nfo->merge_all)) goto done;
+	if (i < 2) goto done;
+	limit = match_simple_consensus(
+		mat_sim_nfo,
+		fifo_get_data(mat_sim_nfo->ffo_l0),
+		error_dummy,
+		fifo_get_size(mat_sim_nfo->ffo_l0),
+		i);
+	if (limit == -1) goto done;
 
-	if (mat_sim_nfo->merge_two) for (j = 1; j < i; j++)
+	/*
+	 * the current track merged with the consensus, errors decide
+	 * where they disagree
+	 */
+
+	if (mat_sim_nfo->merge_two)
 		{
-		limit = match_simple_merge2(
-			mat_sim_nfo,
-			fifo_get_data(mat_sim_nfo->ffo_l0),
-			error_dummy,
-			fifo_get_size(mat_sim_nfo->ffo_l0),
-			j,
-			i);
-		if (limit == -1) continue;
 		fifo_reset(mat_sim_nfo->ffo_l0);
 		if (mat_sim_nfo->fixup) limit = match_simple_fixup_long_pulses(
 			fifo_get_data(mat_sim_nfo->ffo_l0),
@@ -709,31 +758,108 @@ match_simple(
 		match_simple_do_callback(mat_sim_nfo, NULL);
 		}
 
-	/* mix the current track to the mixed versions of all other tracks */
+	/* the consensus itself, votes and errors decide */
 
-	if (mat_sim_nfo->merge_all) while (i > 1)
+	if (mat_sim_nfo->merge_all)
 		{
-		limit = match_simple_merge2(
-			mat_sim_nfo,
-			container_get_data(mat_sim_nfo->con, 0),
-			container_get_error(mat_sim_nfo->con, 0),
-			container_get_size(mat_sim_nfo->con, 0),
-			0,
-			i);
-		if (limit == -1) break;
-		container_set_limit(mat_sim_nfo->con, 0, limit);
+		limit = container_get_limit(mat_sim_nfo->con, 0);
 		fifo_reset(mat_sim_nfo->ffo_l0);
 		fifo_write_block(
 			mat_sim_nfo->ffo_l0,
 			container_get_data(mat_sim_nfo->con, 0),
 			limit);
+		memcpy(error_dummy, container_get_error(mat_sim_nfo->con, 0), limit);
 		if (mat_sim_nfo->fixup) limit = match_simple_fixup_long_pulses(
 			fifo_get_data(mat_sim_nfo->ffo_l0),
 			error_dummy,
 			limit);
 		fifo_set_wr_ofs(mat_sim_nfo->ffo_l0, limit);
 		match_simple_do_callback(mat_sim_nfo, NULL);
-		break;
 		}
+done:
+	scratch_free(error_dummy);
+	}
+
+
+
+/****************************************************************************
+ * match_simple_revolutions
+ ****************************************************************************/
+static cw_count_t
+match_simple_revolutions(
+	struct match_simple_info	*mat_sim_nfo,
+	cw_raw8_t			*data,
+	cw_index_t			*offsets)
+
+	{
+	cw_count_t			revolutions, entries;
+	cw_size_t			size;
+
+	/*
+	 * a capture with stored index signal may contain several complete
+	 * revolutions. each of them is handled like an additional read of
+	 * the track, so match_simple and the callback get more candidates
+	 * without reading the track again. the capture has to be copied,
+	 * because match_simple2() overwrites it. a capture is limited to
+	 * GLOBAL_MAX_TRACK_SIZE pulses, so it contains about 2 revolutions
+	 * of a double density disk and not GLOBAL_NR_REVOLUTIONS
+	 */
+
+	if (! options_get_split_revolutions()) return (0);
+	revolutions = fifo_get_index_offsets(mat_sim_nfo->ffo_l0, offsets, GLOBAL_NR_REVOLUTIONS + 1) - 1;
+	if (revolutions < 2) return (0);
+	entries = container_get_entries(mat_sim_nfo->con);
+	if (entries + revolutions + 1 > CONTAINER_NR_ENTRIES)
+		{
+		verbose_message(GENERIC, 1, "container full, not splitting capture into %d revolutions", revolutions);
+		return (0);
+		}
+	verbose_message(GENERIC, 2, "splitting capture into %d revolutions", revolutions);
+	size = fifo_get_wr_ofs(mat_sim_nfo->ffo_l0);
+	fifo_set_rd_ofs(mat_sim_nfo->ffo_l0, 0);
+	fifo_read_block(mat_sim_nfo->ffo_l0, data, size);
+	fifo_set_rd_ofs(mat_sim_nfo->ffo_l0, 0);
+	return (revolutions);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * match_simple
+ ****************************************************************************/
+cw_void_t
+match_simple(
+	struct match_simple_info	*mat_sim_nfo)
+
+	{
+	cw_raw8_t			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (cw_raw8_t));
+	cw_index_t			offsets[GLOBAL_NR_REVOLUTIONS + 1];
+	cw_count_t			revolutions;
+	cw_int_t			flags;
+	cw_index_t			i;
+
+	/* the whole capture first, then every complete revolution alone */
+
+	flags       = fifo_get_flags(mat_sim_nfo->ffo_l0);
+	revolutions = match_simple_revolutions(mat_sim_nfo, data, offsets);
+	match_simple2(mat_sim_nfo);
+	for (i = 0; i < revolutions; i++)
+		{
+		fifo_reset(mat_sim_nfo->ffo_l0);
+		fifo_set_flags(mat_sim_nfo->ffo_l0, flags);
+		fifo_write_block(mat_sim_nfo->ffo_l0, &data[offsets[i]], offsets[i + 1] - offsets[i]);
+		match_simple2(mat_sim_nfo);
+		}
+	scratch_free(data);
 	}
 /******************************************************** Karsten Scheibler */
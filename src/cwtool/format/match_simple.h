@@ -45,6 +45,8 @@ struct match_simple_info
 	cw_count_t			format_side;
 	struct bounds			*bnd;
 	cw_count_t			bnd_size;
+	cw_bool_t			pll;
+	cw_count_t			pll_gain[2];
 	cw_void_t			(*callback)(union format *, struct container *, struct fifo *, struct fifo *, struct disk_sector *, cw_count_t, cw_count_t, cw_count_t);
 	cw_bool_t			merge_two;
 	cw_bool_t			merge_all;
@@ -23,6 +23,53 @@
 
 
 
+
+#define WRITE_BLOCK_SIZE		256
+
+/*
+ * mfm encoding of each byte value, the clock bit in front of the msb is
+ * set as if the previous data bit was 0. if it was 1, the clock bit has
+ * to be cleared
+ */
+
+static const unsigned short		mfm_encode_table16[0x100] =
+	{
+	0xaaaa, 0xaaa9, 0xaaa4, 0xaaa5, 0xaa92, 0xaa91, 0xaa94, 0xaa95,
+	0xaa4a, 0xaa49, 0xaa44, 0xaa45, 0xaa52, 0xaa51, 0xaa54, 0xaa55,
+	0xa92a, 0xa929, 0xa924, 0xa925, 0xa912, 0xa911, 0xa914, 0xa915,
+	0xa94a, 0xa949, 0xa944, 0xa945, 0xa952, 0xa951, 0xa954, 0xa955,
+	0xa4aa, 0xa4a9, 0xa4a4, 0xa4a5, 0xa492, 0xa491, 0xa494, 0xa495,
+	0xa44a, 0xa449, 0xa444, 0xa445, 0xa452, 0xa451, 0xa454, 0xa455,
+	0xa52a, 0xa529, 0xa524, 0xa525, 0xa512, 0xa511, 0xa514, 0xa515,
+	0xa54a, 0xa549, 0xa544, 0xa545, 0xa552, 0xa551, 0xa554, 0xa555,
+	0x92aa, 0x92a9, 0x92a4, 0x92a5, 0x9292, 0x9291, 0x9294, 0x9295,
+	0x924a, 0x9249, 0x9244, 0x9245, 0x9252, 0x9251, 0x9254, 0x9255,
+	0x912a, 0x9129, 0x9124, 0x9125, 0x9112, 0x9111, 0x9114, 0x9115,
+	0x914a, 0x9149, 0x9144, 0x9145, 0x9152, 0x9151, 0x9154, 0x9155,
+	0x94aa, 0x94a9, 0x94a4, 0x94a5, 0x9492, 0x9491, 0x9494, 0x9495,
+	0x944a, 0x9449, 0x9444, 0x9445, 0x9452, 0x9451, 0x9454, 0x9455,
+	0x952a, 0x9529, 0x9524, 0x9525, 0x9512, 0x9511, 0x9514, 0x9515,
+	0x954a, 0x9549, 0x9544, 0x9545, 0x9552, 0x9551, 0x9554, 0x9555,
+	0x4aaa, 0x4aa9, 0x4aa4, 0x4aa5, 0x4a92, 0x4a91, 0x4a94, 0x4a95,
+	0x4a4a, 0x4a49, 0x4a44, 0x4a45, 0x4a52, 0x4a51, 0x4a54, 0x4a55,
+	0x492a, 0x4929, 0x4924, 0x4925, 0x4912, 0x4911, 0x4914, 0x4915,
+	0x494a, 0x4949, 0x4944, 0x4945, 0x4952, 0x4951, 0x4954, 0x4955,
+	0x44aa, 0x44a9, 0x44a4, 0x44a5, 0x4492, 0x4491, 0x4494, 0x4495,
+	0x444a, 0x4449, 0x4444, 0x4445, 0x4452, 0x4451, 0x4454, 0x4455,
+	0x452a, 0x4529, 0x4524, 0x4525, 0x4512, 0x4511, 0x4514, 0x4515,
+	0x454a, 0x4549, 0x4544, 0x4545, 0x4552, 0x4551, 0x4554, 0x4555,
+	0x52aa, 0x52a9, 0x52a4, 0x52a5, 0x5292, 0x5291, 0x5294, 0x5295,
+	0x524a, 0x5249, 0x5244, 0x5245, 0x5252, 0x5251, 0x5254, 0x5255,
+	0x512a, 0x5129, 0x5124, 0x5125, 0x5112, 0x5111, 0x5114, 0x5115,
+	0x514a, 0x5149, 0x5144, 0x5145, 0x5152, 0x5151, 0x5154, 0x5155,
+	0x54aa, 0x54a9, 0x54a4, 0x54a5, 0x5492, 0x5491, 0x5494, 0x5495,
+	0x544a, 0x5449, 0x5444, 0x5445, 0x5452, 0x5451, 0x5454, 0x5455,
+	0x552a, 0x5529, 0x5524, 0x5525, 0x5512, 0x5511, 0x5514, 0x5515,
+	0x554a, 0x5549, 0x5544, 0x5545, 0x5552, 0x5551, 0x5554, 0x5555
+	};
+
+
+
 /****************************************************************************
  * mfm_read_8data_bits
  ****************************************************************************/
@@ -66,4 +113,74 @@ mfm_write_8data_bits(
 	if (fifo_write_bits(ffo_l1, data ^ clock ^ 0xaaaa, 16) == -1) return (-1);
 	return (0);
 	}
+
+
+
+/****************************************************************************
+ * mfm_write_block
+ ****************************************************************************/
+static int
+mfm_write_block(
+	struct fifo			*ffo_l1,
+	unsigned char			*data,
+	int				val,
+	int				size)
+
+	{
+	cw_u32_t			bits[WRITE_BLOCK_SIZE];
+	int				last = fifo_last_bit_written(ffo_l1);
+	int				i, j, n;
+
+	/*
+	 * encodes size bytes from data, or size times val if data is NULL,
+	 * the same as mfm_write_8data_bits() does for each byte. the last
+	 * data bit is carried over to the clock bit of the next byte
+	 */
+
+	for (i = 0; i < size; i += n)
+		{
+		n = size - i;
+		if (n > WRITE_BLOCK_SIZE) n = WRITE_BLOCK_SIZE;
+		for (j = 0; j < n; j++)
+			{
+			bits[j] = mfm_encode_table16[(data != NULL) ? data[i + j] : val];
+			if (last) bits[j] &= 0x7fff;
+			last = bits[j] & 1;
+			}
+		if (fifo_write_bits_block(ffo_l1, bits, 16, n) == -1) return (-1);
+		}
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * mfm_write_fill
+ ****************************************************************************/
+int
+mfm_write_fill(
+	struct fifo			*ffo_l1,
+	int				val,
+	int				size)
+
+	{
+	verbose_message(GENERIC, 2, "writing fill at bit offset %d with value 0x%02x", fifo_get_wr_bitofs(ffo_l1), val);
+	return (mfm_write_block(ffo_l1, NULL, val & 0xff, size));
+	}
+
+
+
+/****************************************************************************
+ * mfm_write_bytes
+ ****************************************************************************/
+int
+mfm_write_bytes(
+	struct fifo			*ffo_l1,
+	unsigned char			*data,
+	int				size)
+
+	{
+	verbose_message(GENERIC, 2, "writing %d bytes at bit offset %d", size, fifo_get_wr_bitofs(ffo_l1));
+	return (mfm_write_block(ffo_l1, data, 0, size));
+	}
 /******************************************************** Karsten Scheibler */
@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "mfm.h"
 #include "range.h"
@@ -49,6 +50,7 @@
 #define FLAG_MATCH_SIMPLE		(1 << 3)
 #define FLAG_MATCH_SIMPLE_FIXUP		(1 << 4)
 #define FLAG_POSTCOMP_SIMPLE		(1 << 5)
+#define FLAG_PLL			(1 << 6)
 
 
 
@@ -146,6 +148,8 @@ static int
 mfm_amiga_read_sector2(
 	struct fifo			*ffo_l1,
 	struct mfm_amiga		*mfm_amg,
+	struct container		*con,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*data)
@@ -156,12 +160,22 @@ mfm_amiga_read_sector2(
 	*dsk_err = (struct disk_error) { };
 	if (mfm_read_sync(ffo_l1, range_sector_data(rng_sec), mfm_amg->rw.sync_value, mfm_amg->rw.sync_length) == -1) return (-1);
 	bitofs = fifo_get_rd_bitofs(ffo_l1);
-	if (mfm_read_bytes(ffo_l1, dsk_err, data, DATA_SIZE) == -1) return (-1);
-	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
+	if (mfm_read_bytes(ffo_l1, dsk_err, data, 28) == -1) return (-1);
 	mfm_amiga_unshuffle(data, 4);
 	mfm_amiga_unshuffle(&data[4], 16);
 	mfm_amiga_unshuffle(&data[20], 4);
 	mfm_amiga_unshuffle(&data[24], 4);
+
+	/* returns 0 if the data field was skipped, see disk_sector_skip() */
+
+	if ((mfm_read_u32_le(&data[20]) == mfm_amiga_checksum(data, 20)) &&
+		(disk_sector_skip(dsk_sct, mfm_amg->rw.sectors, data[2], con)))
+		{
+		fifo_set_rd_bitofs(ffo_l1, bitofs);
+		return (0);
+		}
+	if (mfm_read_bytes(ffo_l1, dsk_err, &data[28], DATA_SIZE - 28) == -1) return (-1);
+	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
 	mfm_amiga_unshuffle(&data[28], 512);
 	verbose_message(GENERIC, 2, "rewinding to bit offset %d", bitofs);
 	fifo_set_rd_bitofs(ffo_l1, bitofs);
@@ -212,7 +226,9 @@ mfm_amiga_read_sector(
 	unsigned char			data[DATA_SIZE];
 	int				result, track, sector;
 
-	if (mfm_amiga_read_sector2(ffo_l1, mfm_amg, &dsk_err, &rng_sec, data) == -1) return (-1);
+	result = mfm_amiga_read_sector2(ffo_l1, mfm_amg, con, dsk_sct, &dsk_err, &rng_sec, data);
+	if (result == -1) return (-1);
+	if (result == 0) return (1);
 
 	/* accept only valid sector numbers */
 
@@ -331,12 +347,20 @@ mfm_amiga_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->mfm_amg.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->mfm_amg.rw.bnd, 3);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_amg.rw.bnd, 3);
-	while (mfm_amiga_read_sector(&ffo_l1, &fmt->mfm_amg, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	if (fmt->mfm_amg.rd.flags & FLAG_PLL) bitstream_read_pll(ffo_l0, &ffo_l1, fmt->mfm_amg.rw.bnd, 3, fmt->mfm_amg.rd.pll_gain[0], fmt->mfm_amg.rd.pll_gain[1]);
+	else bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_amg.rw.bnd, 3);
+
+	/* stop early if possible, see disk_sectors_wanted() */
+
+	while (mfm_amiga_read_sector(&ffo_l1, &fmt->mfm_amg, con, dsk_sct, cwtool_track, format_track, format_side) != -1)
+		{
+		if (! disk_sectors_wanted(dsk_sct, fmt->mfm_amg.rw.sectors, con)) break;
+		}
+	scratch_free(data);
 	}
 
 
@@ -368,6 +392,8 @@ mfm_amiga_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->mfm_amg.rw.bnd,
 		.bnd_size     = 3,
+		.pll          = fmt->mfm_amg.rd.flags & FLAG_PLL,
+		.pll_gain     = { fmt->mfm_amg.rd.pll_gain[0], fmt->mfm_amg.rd.pll_gain[1] },
 		.callback     = mfm_amiga_read_track2,
 		.merge_two    = fmt->mfm_amg.rd.flags & FLAG_MATCH_SIMPLE,
 		.merge_all    = fmt->mfm_amg.rd.flags & FLAG_MATCH_SIMPLE,
@@ -396,17 +422,20 @@ mfm_amiga_write_track(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data_l1[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data_l1, sizeof (data_l1));
-	int				i;
+	unsigned char			*data_l1 = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data_l1, GLOBAL_MAX_TRACK_SIZE);
+	int				i, result = 0;
 
-	if (mfm_write_fill(&ffo_l1, fmt->mfm_amg.wr.prolog_value, fmt->mfm_amg.wr.prolog_length) == -1) return (0);
-	for (i = 0; i < fmt->mfm_amg.rw.sectors; i++) if (mfm_amiga_write_sector(&ffo_l1, &fmt->mfm_amg, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) return (0);
+	if (mfm_write_fill(&ffo_l1, fmt->mfm_amg.wr.prolog_value, fmt->mfm_amg.wr.prolog_length) == -1) goto done;
+	for (i = 0; i < fmt->mfm_amg.rw.sectors; i++) if (mfm_amiga_write_sector(&ffo_l1, &fmt->mfm_amg, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) goto done;
 	fifo_set_rd_ofs(ffo_l3, fifo_get_wr_ofs(ffo_l3));
-	if (mfm_write_fill(&ffo_l1, fmt->mfm_amg.wr.epilog_value, fmt->mfm_amg.wr.epilog_length) == -1) return (0);
+	if (mfm_write_fill(&ffo_l1, fmt->mfm_amg.wr.epilog_value, fmt->mfm_amg.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1);
-	if (bitstream_write(&ffo_l1, ffo_l0, fmt->mfm_amg.rw.bnd, fmt->mfm_amg.wr.precomp, 3) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1, ffo_l0, fmt->mfm_amg.rw.bnd, fmt->mfm_amg.wr.precomp, 3) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1);
+	return (result);
 	}
 
 
@@ -427,19 +456,21 @@ mfm_amiga_write_track(
 #define MAGIC_MATCH_SIMPLE		4
 #define MAGIC_MATCH_SIMPLE_FIXUP	5
 #define MAGIC_POSTCOMP_SIMPLE		6
-#define MAGIC_PROLOG_LENGTH		7
-#define MAGIC_PROLOG_VALUE		8
-#define MAGIC_EPILOG_LENGTH		9
-#define MAGIC_EPILOG_VALUE		10
-#define MAGIC_FILL_LENGTH		11
-#define MAGIC_FILL_VALUE		12
-#define MAGIC_PRECOMP			13
-#define MAGIC_SECTORS			14
-#define MAGIC_SYNC_LENGTH		15
-#define MAGIC_SYNC_VALUE		16
-#define MAGIC_FORMAT_BYTE		17
-#define MAGIC_BOUNDS_OLD		18
-#define MAGIC_BOUNDS_NEW		19
+#define MAGIC_PLL			7
+#define MAGIC_PLL_GAIN			8
+#define MAGIC_PROLOG_LENGTH		9
+#define MAGIC_PROLOG_VALUE		10
+#define MAGIC_EPILOG_LENGTH		11
+#define MAGIC_EPILOG_VALUE		12
+#define MAGIC_FILL_LENGTH		13
+#define MAGIC_FILL_VALUE		14
+#define MAGIC_PRECOMP			15
+#define MAGIC_SECTORS			16
+#define MAGIC_SYNC_LENGTH		17
+#define MAGIC_SYNC_VALUE		18
+#define MAGIC_FORMAT_BYTE		19
+#define MAGIC_BOUNDS_OLD		20
+#define MAGIC_BOUNDS_NEW		21
 
 
 
@@ -455,7 +486,8 @@ mfm_amiga_set_defaults(
 		{
 		.rd =
 			{
-			.flags = 0
+			.flags    = 0,
+			.pll_gain = { 0x80, 0x10 }
 			},
 		.wr =
 			{
@@ -505,8 +537,10 @@ mfm_amiga_set_read_option(
 	if (magic == MAGIC_IGNORE_FORMAT_BYTE)    return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_IGNORE_FORMAT_BYTE));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_MATCH_SIMPLE_FIXUP));
-	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE);
-	return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_POSTCOMP_SIMPLE));
+	if (magic == MAGIC_POSTCOMP_SIMPLE)       return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_POSTCOMP_SIMPLE));
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_PLL));
+	debug_error_condition(magic != MAGIC_PLL_GAIN);
+	return (setvalue_uchar(&fmt->mfm_amg.rd.pll_gain[ofs], val, 0, 0xff));
 	}
 
 
@@ -639,6 +673,8 @@ static struct format_option		mfm_amiga_read_options[] =
 	FORMAT_OPTION_BOOLEAN("match_simple_fixup",    MAGIC_MATCH_SIMPLE_FIXUP,    1),
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",              MAGIC_POSTCOMP_SIMPLE,       1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",       MAGIC_POSTCOMP_SIMPLE,       1),
+	FORMAT_OPTION_BOOLEAN("pll",                   MAGIC_PLL,                   1),
+	FORMAT_OPTION_INTEGER("pll_gain",              MAGIC_PLL_GAIN,              2),
 	FORMAT_OPTION_END
 	};
 
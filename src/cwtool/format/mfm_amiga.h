@@ -22,7 +22,8 @@ struct mfm_amiga
 	struct
 		{
 		unsigned char		flags;
-		unsigned char		reserved[3];
+		unsigned char		pll_gain[2];
+		unsigned char		reserved;
 		}			rd;
 	struct
 		{
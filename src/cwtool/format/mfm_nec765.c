@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "mfm.h"
 #include "range.h"
@@ -51,6 +52,7 @@
 #define FLAG_RD_MATCH_SIMPLE		(1 << 4)
 #define FLAG_RD_MATCH_SIMPLE_FIXUP	(1 << 5)
 #define FLAG_RD_POSTCOMP_SIMPLE		(1 << 6)
+#define FLAG_RD_PLL			(1 << 7)
 #define FLAG_RW_CRC16_INIT_VALUE_SET	(1 << 0)
 
 
@@ -127,6 +129,8 @@ static int
 mfm_nec765_read_sector2(
 	struct fifo			*ffo_l1,
 	struct mfm_nec765		*mfm_nec,
+	struct container		*con,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
@@ -145,6 +149,11 @@ mfm_nec765_read_sector2(
 		fifo_set_rd_bitofs(ffo_l1, bitofs);
 		if (format_compare2("id_address_mark: got 0x%02x, expected 0x%02x", header[0], mfm_nec->rw.id_address_mark) == 0) break;
 		}
+
+	/* returns 0 if the data field was skipped, see disk_sector_skip() */
+
+	if ((mfm_read_u16_be(&header[5]) == mfm_crc16(mfm_nec->rw.crc16_init_value, header, 5)) &&
+		(disk_sector_skip(dsk_sct, mfm_nec->rw.sectors, header[3] - 1, con))) return (0);
 	data_size = mfm_nec765_sector_size(mfm_nec, header[3] - 1);
 	if (mfm_read_sync(ffo_l1, range_sector_data(rng_sec), mfm_nec->rw.sync_value, mfm_nec->rw.sync_length) == -1) return (-1);
 	if (mfm_read_bytes(ffo_l1, dsk_err, data, data_size + 3) == -1) return (-1);
@@ -201,7 +210,9 @@ mfm_nec765_read_sector(
 	unsigned char			data[DATA_SIZE];
 	int				result, track, side, sector, data_size;
 
-	if (mfm_nec765_read_sector2(ffo_l1, mfm_nec, &dsk_err, &rng_sec, header, data) == -1) return (-1);
+	result = mfm_nec765_read_sector2(ffo_l1, mfm_nec, con, dsk_sct, &dsk_err, &rng_sec, header, data);
+	if (result == -1) return (-1);
+	if (result == 0) return (1);
 
 	/* accept only valid sector numbers */
 
@@ -332,12 +343,20 @@ mfm_nec765_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->mfm_nec.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->mfm_nec.rw.bnd, 3);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_nec.rw.bnd, 3);
-	while (mfm_nec765_read_sector(&ffo_l1, &fmt->mfm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	if (fmt->mfm_nec.rd.flags & FLAG_RD_PLL) bitstream_read_pll(ffo_l0, &ffo_l1, fmt->mfm_nec.rw.bnd, 3, fmt->mfm_nec.rd.pll_gain[0], fmt->mfm_nec.rd.pll_gain[1]);
+	else bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_nec.rw.bnd, 3);
+
+	/* stop early if possible, see disk_sectors_wanted() */
+
+	while (mfm_nec765_read_sector(&ffo_l1, &fmt->mfm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1)
+		{
+		if (! disk_sectors_wanted(dsk_sct, fmt->mfm_nec.rw.sectors, con)) break;
+		}
+	scratch_free(data);
 	}
 
 
@@ -369,6 +388,8 @@ mfm_nec765_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->mfm_nec.rw.bnd,
 		.bnd_size     = 3,
+		.pll          = fmt->mfm_nec.rd.flags & FLAG_RD_PLL,
+		.pll_gain     = { fmt->mfm_nec.rd.pll_gain[0], fmt->mfm_nec.rd.pll_gain[1] },
 		.callback     = mfm_nec765_read_track2,
 		.merge_two    = fmt->mfm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE,
 		.merge_all    = fmt->mfm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE,
@@ -397,23 +418,26 @@ mfm_nec765_write_track(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data_l1[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data_l1, sizeof (data_l1));
-	int				i;
-
-	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.prolog_value, fmt->mfm_nec.wr.prolog_length) == -1) return (0);
-	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.fill_value1, fmt->mfm_nec.wr.fill_length1)   == -1) return (0);
-	if (mfm_write_sync(&ffo_l1, 0x5224, 3) == -1) return (0);
-	if (mfm_write_fill(&ffo_l1, 0xfc, 1)   == -1) return (0);
-	for (i = 0; i < fmt->mfm_nec.rw.sectors; i++) if (mfm_nec765_write_sector(&ffo_l1, &fmt->mfm_nec, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) return (0);
+	unsigned char			*data_l1 = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	struct fifo			ffo_l1 = FIFO_INIT(data_l1, GLOBAL_MAX_TRACK_SIZE);
+	int				i, result = 0;
+
+	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.prolog_value, fmt->mfm_nec.wr.prolog_length) == -1) goto done;
+	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.fill_value1, fmt->mfm_nec.wr.fill_length1)   == -1) goto done;
+	if (mfm_write_sync(&ffo_l1, 0x5224, 3) == -1) goto done;
+	if (mfm_write_fill(&ffo_l1, 0xfc, 1)   == -1) goto done;
+	for (i = 0; i < fmt->mfm_nec.rw.sectors; i++) if (mfm_nec765_write_sector(&ffo_l1, &fmt->mfm_nec, &dsk_sct[i], cwtool_track, format_track, format_side) == -1) goto done;
 	fifo_set_rd_ofs(ffo_l3, fifo_get_wr_ofs(ffo_l3));
-	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.fill_value6, fmt->mfm_nec.wr.fill_length6)   == -1) return (0);
-	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.fill_value7, fmt->mfm_nec.wr.fill_length7)   == -1) return (0);
-	if (mfm_write_sync(&ffo_l1, 0x4489, 3) == -1) return (0);
-	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.epilog_value, fmt->mfm_nec.wr.epilog_length) == -1) return (0);
+	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.fill_value6, fmt->mfm_nec.wr.fill_length6)   == -1) goto done;
+	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.fill_value7, fmt->mfm_nec.wr.fill_length7)   == -1) goto done;
+	if (mfm_write_sync(&ffo_l1, 0x4489, 3) == -1) goto done;
+	if (mfm_write_fill(&ffo_l1, fmt->mfm_nec.wr.epilog_value, fmt->mfm_nec.wr.epilog_length) == -1) goto done;
 	fifo_write_flush(&ffo_l1);
-	if (bitstream_write(&ffo_l1, ffo_l0, fmt->mfm_nec.rw.bnd, fmt->mfm_nec.wr.precomp, 3) == -1) return (0);
-	return (1);
+	if (bitstream_write(&ffo_l1, ffo_l0, fmt->mfm_nec.rw.bnd, fmt->mfm_nec.wr.precomp, 3) == -1) goto done;
+	result = 1;
+done:
+	scratch_free(data_l1);
+	return (result);
 	}
 
 
@@ -435,36 +459,38 @@ mfm_nec765_write_track(
 #define MAGIC_MATCH_SIMPLE		5
 #define MAGIC_MATCH_SIMPLE_FIXUP	6
 #define MAGIC_POSTCOMP_SIMPLE		7
-#define MAGIC_PROLOG_LENGTH		8
-#define MAGIC_PROLOG_VALUE		9
-#define MAGIC_EPILOG_LENGTH		10
-#define MAGIC_EPILOG_VALUE		11
-#define MAGIC_FILL_LENGTH1		12
-#define MAGIC_FILL_VALUE1		13
-#define MAGIC_FILL_LENGTH2		14
-#define MAGIC_FILL_VALUE2		15
-#define MAGIC_FILL_LENGTH3		16
-#define MAGIC_FILL_VALUE3		17
-#define MAGIC_FILL_LENGTH4		18
-#define MAGIC_FILL_VALUE4		19
-#define MAGIC_FILL_LENGTH5		20
-#define MAGIC_FILL_VALUE5		21
-#define MAGIC_FILL_LENGTH6		22
-#define MAGIC_FILL_VALUE6		23
-#define MAGIC_FILL_LENGTH7		24
-#define MAGIC_FILL_VALUE7		25
-#define MAGIC_PRECOMP			26
-#define MAGIC_SECTORS			27
-#define MAGIC_SYNC_LENGTH		28
-#define MAGIC_SYNC_VALUE		29
-#define MAGIC_CRC16_INIT_VALUE		30
-#define MAGIC_ID_ADDRESS_MARK		31
-#define MAGIC_DATA_ADDRESS_MARK1	32
-#define MAGIC_DATA_ADDRESS_MARK2	33
-#define MAGIC_TRACK_STEP		34
-#define MAGIC_SECTOR_SIZES		35
-#define MAGIC_BOUNDS_OLD		36
-#define MAGIC_BOUNDS_NEW		37
+#define MAGIC_PLL			8
+#define MAGIC_PLL_GAIN			9
+#define MAGIC_PROLOG_LENGTH		10
+#define MAGIC_PROLOG_VALUE		11
+#define MAGIC_EPILOG_LENGTH		12
+#define MAGIC_EPILOG_VALUE		13
+#define MAGIC_FILL_LENGTH1		14
+#define MAGIC_FILL_VALUE1		15
+#define MAGIC_FILL_LENGTH2		16
+#define MAGIC_FILL_VALUE2		17
+#define MAGIC_FILL_LENGTH3		18
+#define MAGIC_FILL_VALUE3		19
+#define MAGIC_FILL_LENGTH4		20
+#define MAGIC_FILL_VALUE4		21
+#define MAGIC_FILL_LENGTH5		22
+#define MAGIC_FILL_VALUE5		23
+#define MAGIC_FILL_LENGTH6		24
+#define MAGIC_FILL_VALUE6		25
+#define MAGIC_FILL_LENGTH7		26
+#define MAGIC_FILL_VALUE7		27
+#define MAGIC_PRECOMP			28
+#define MAGIC_SECTORS			29
+#define MAGIC_SYNC_LENGTH		30
+#define MAGIC_SYNC_VALUE		31
+#define MAGIC_CRC16_INIT_VALUE		32
+#define MAGIC_ID_ADDRESS_MARK		33
+#define MAGIC_DATA_ADDRESS_MARK1	34
+#define MAGIC_DATA_ADDRESS_MARK2	35
+#define MAGIC_TRACK_STEP		36
+#define MAGIC_SECTOR_SIZES		37
+#define MAGIC_BOUNDS_OLD		38
+#define MAGIC_BOUNDS_NEW		39
 
 
 
@@ -501,7 +527,8 @@ mfm_nec765_set_defaults(
 		{
 		.rd =
 			{
-			.flags = 0
+			.flags    = 0,
+			.pll_gain = { 0x80, 0x10 }
 			},
 		.wr =
 			{
@@ -571,8 +598,10 @@ mfm_nec765_set_read_option(
 	if (magic == MAGIC_IGNORE_FORMAT_BYTE)    return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_IGNORE_FORMAT_BYTE));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_MATCH_SIMPLE_FIXUP));
-	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE);
-	return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_POSTCOMP_SIMPLE));
+	if (magic == MAGIC_POSTCOMP_SIMPLE)       return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_POSTCOMP_SIMPLE));
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_PLL));
+	debug_error_condition(magic != MAGIC_PLL_GAIN);
+	return (setvalue_uchar(&fmt->mfm_nec.rd.pll_gain[ofs], val, 0, 0xff));
 	}
 
 
@@ -743,6 +772,8 @@ static struct format_option		mfm_nec765_read_options[] =
 	FORMAT_OPTION_BOOLEAN("match_simple_fixup",    MAGIC_MATCH_SIMPLE_FIXUP,    1),
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",              MAGIC_POSTCOMP_SIMPLE,       1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",       MAGIC_POSTCOMP_SIMPLE,       1),
+	FORMAT_OPTION_BOOLEAN("pll",                   MAGIC_PLL,                   1),
+	FORMAT_OPTION_INTEGER("pll_gain",              MAGIC_PLL_GAIN,              2),
 	FORMAT_OPTION_END
 	};
 
@@ -23,7 +23,8 @@ struct mfm_nec765
 	struct
 		{
 		unsigned char		flags;
-		unsigned char		reserved[3];
+		unsigned char		pll_gain[2];
+		unsigned char		reserved;
 		}			rd;
 	struct
 		{
@@ -11,6 +11,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "postcomp_simple.h"
 #include "../error.h"
@@ -19,6 +20,7 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "bounds.h"
 
 
@@ -231,9 +233,8 @@ postcomp_simple_adjust(
 	{
 	unsigned char			*data = fifo_get_data(ffo);
 	int				len   = fifo_get_wr_ofs(ffo);
-	char				error[GLOBAL_MAX_TRACK_SIZE] = { };
-	char				done[GLOBAL_MAX_TRACK_SIZE] = { };
-	int				stage, area;
+	char				*error, *done;
+	int				stage, area, result;
 
 	/*
 	 * increasing number of stages produces sometimes very nice
@@ -246,10 +247,20 @@ postcomp_simple_adjust(
 		postcomp_simple_value(adjust0),
 		postcomp_simple_sign(adjust1),
 		postcomp_simple_value(adjust1));
+
+	/* only the first len bytes of error[] and done[] are used */
+
+	error = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (char));
+	done  = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (char));
+	memset(error, 0, len * sizeof (char));
+	memset(done, 0, len * sizeof (char));
 	for (stage = 1; stage < 2; stage++) for (area = 2; area < 16; area++)
 		{
 		postcomp_simple_calculate(bnd, bnd_size, data, error, done, len, stage, area, adjust0, adjust1);
 		}
-	return (postcomp_simple_apply(data, error, len));
+	result = postcomp_simple_apply(data, error, len);
+	scratch_free(done);
+	scratch_free(error);
+	return (result);
 	}
 /******************************************************** Karsten Scheibler */
@@ -69,6 +69,10 @@
 
 
 
+#define BLOCK_SIZE			512
+
+
+
 /****************************************************************************
  * tbe_read_sync
  ****************************************************************************/
@@ -132,34 +136,6 @@ tbe_write_fill(
 
 
 
-/****************************************************************************
- * tbe_read_2bits
- ****************************************************************************/
-static int
-tbe_read_2bits(
-	struct fifo			*ffo_l0,
-	struct disk_error		*dsk_err,
-	int				*lookup,
-	int				ofs,
-	int				val)
-
-	{
-	int				token;
-
-	if (val == -1) return (-1);
-	token = bitstream_read_counter(ffo_l0, lookup);
-	if (token == -1) return (-1);
-	if ((token < 0) || (token > 3))
-		{
-		verbose_message(GENERIC, 3, "wrong counter value at offset %d (byte %d)", fifo_get_rd_ofs(ffo_l0) - 1, ofs);
-		disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
-		token = 0;
-		}
-	return ((val << 2) | token);
-	}
-
-
-
 /****************************************************************************
  * tbe_read_bytes
  ****************************************************************************/
@@ -168,27 +144,52 @@ tbe_read_bytes(
 	struct fifo			*ffo_l0,
 	struct disk_error		*dsk_err,
 	int				*lookup,
+	unsigned char			*swap,
 	unsigned char			*data,
-	int				size)
+	int				size,
+	int				*crc)
 
 	{
-	int				i, val;
+	unsigned char			counter[4 * BLOCK_SIZE];
+	int				i, j, k, n, token, val;
 	int				ofs = fifo_get_rd_ofs(ffo_l0);
 
-	for (i = 0; i < size; i++)
+	/*
+	 * work on blocks of BLOCK_SIZE bytes: the counter values are
+	 * converted to bit pairs, the crc is updated and the bit pairs
+	 * are swapped back with the swap table, while the block is still
+	 * in the cache. crc and swap are optional
+	 */
+
+	for (i = 0; i < size; i += n)
 		{
-		val = tbe_read_2bits(ffo_l0, dsk_err, lookup, i, 0);
-		val = tbe_read_2bits(ffo_l0, dsk_err, lookup, i, val);
-		val = tbe_read_2bits(ffo_l0, dsk_err, lookup, i, val);
-		val = tbe_read_2bits(ffo_l0, dsk_err, lookup, i, val);
-		if (val == -1) return (-1);
-		data[i] = val;
+		n = size - i;
+		if (n > BLOCK_SIZE) n = BLOCK_SIZE;
+		k = fifo_get_wr_ofs(ffo_l0) - fifo_get_rd_ofs(ffo_l0);
+		if (k > 4 * n) k = 4 * n;
+		fifo_read_block(ffo_l0, counter, k);
+		for (j = val = 0; j < k; j++)
+			{
+			token = lookup[counter[j] & GLOBAL_PULSE_LENGTH_MASK];
+			if (token > 3)
+				{
+				verbose_message(GENERIC, 3, "wrong counter value at offset %d (byte %d)", fifo_get_rd_ofs(ffo_l0) - k + j, i + j / 4);
+				disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
+				token = 0;
+				}
+			val = (val << 2) | token;
+			if ((j & 3) == 3) data[i + j / 4] = val;
+			}
+		if (k < 4 * n) return (-1);
+		if (crc != NULL) *crc = tbe_crc16(*crc, &data[i], n);
+		if (swap != NULL) for (j = i; j < i + n; j++) data[j] = swap[data[j]];
 		}
 	verbose_message(GENERIC, 2, "read %d bytes at offset %d", i, ofs);
 	return (0);
 	}
 
 
+
 /****************************************************************************
  * tbe_write_bytes
  ****************************************************************************/
@@ -255,15 +256,14 @@ tbe_cw_sector_size(
  ****************************************************************************/
 static int
 tbe_cw_bitswap(
-	unsigned char			*data,
-	int				size,
+	unsigned char			*table,
 	int				s0,
 	int				s1,
 	int				s2,
 	int				s3)
 
 	{
-	int				i, val, val2;
+	int				i;
 	int				swap[] = { s0, s1, s2, s3 };
 
 	/* check validity of bit pair swap vector */
@@ -271,22 +271,39 @@ tbe_cw_bitswap(
 	if ((s0 == s1) || (s0 == s2) || (s0 == s3) ||
 		(s1 == s2) || (s1 == s3) || (s2 == s3)) return (-1);
 
-	/* check if we really have to do something */
+	/* table with swapped bit pairs for every byte value */
 
-	if ((s0 == 0) && (s1 == 1) && (s2 == 2) && (s3 == 3)) return (0);
+	for (i = 0; i < 256; i++) table[i] =
+		(swap[i >> 6] << 6) | (swap[(i >> 4) & 3] << 4) |
+		(swap[(i >> 2) & 3] << 2) | swap[i & 3];
+	return (0);
+	}
 
-	/* swap bit pairs */
 
-	for (i = 0; i < size; i++)
+
+/****************************************************************************
+ * tbe_cw_bitswap_crc16
+ ****************************************************************************/
+static int
+tbe_cw_bitswap_crc16(
+	unsigned char			*table,
+	unsigned char			*data,
+	int				size,
+	int				crc)
+
+	{
+	int				i, j, n;
+
+	/* swap bit pairs and update crc block by block */
+
+	for (i = 0; i < size; i += n)
 		{
-		val = data[i];
-		val2 = swap[val >> 6];
-		val2 = (val2 << 2) | swap[(val >> 4) & 3];
-		val2 = (val2 << 2) | swap[(val >> 2) & 3];
-		val2 = (val2 << 2) | swap[val & 3];
-		data[i] = val2;
+		n = size - i;
+		if (n > BLOCK_SIZE) n = BLOCK_SIZE;
+		for (j = i; j < i + n; j++) data[j] = table[data[j]];
+		crc = tbe_crc16(crc, &data[i], n);
 		}
-	return (0);
+	return (crc);
 	}
 
 
@@ -317,22 +334,26 @@ tbe_cw_swap(
  ****************************************************************************/
 static int
 tbe_cw_calculate_bitswap(
+	unsigned char			*table,
 	unsigned char			*data,
 	int				size)
 
 	{
-	int				i, val, count[4] = { };
+	int				i, count[4] = { }, bytes[256] = { };
 	int				swap1[4] = { 0, 1, 2, 3 }, swap2[4];
 
-	/* count occurancies of bit pairs */
+	/*
+	 * count occurancies of bit pairs, count the byte values first, so
+	 * only one increment per byte is needed
+	 */
 
-	for (i = 0; i < size; i++)
+	for (i = 0; i < size; i++) bytes[data[i]]++;
+	for (i = 0; i < 256; i++)
 		{
-		val = data[i];
-		count[val >> 6]++;
-		count[(val >> 4) & 3]++;
-		count[(val >> 2) & 3]++;
-		count[val & 3]++;
+		count[i >> 6]       += bytes[i];
+		count[(i >> 4) & 3] += bytes[i];
+		count[(i >> 2) & 3] += bytes[i];
+		count[i & 3]        += bytes[i];
 		}
 	debug_message(GENERIC, 3, "count[4] = {%6d,%6d,%6d,%6d }", count[0], count[1], count[2], count[3]);
 
@@ -343,7 +364,7 @@ tbe_cw_calculate_bitswap(
 	if (count[0] < count[2]) tbe_cw_swap(count, swap1, 0, 2);
 	if (count[1] < count[3]) tbe_cw_swap(count, swap1, 1, 3);
 	if (count[1] < count[2]) tbe_cw_swap(count, swap1, 1, 2);
-	i = tbe_cw_bitswap(data, size, swap1[0], swap1[1], swap1[2], swap1[3]);
+	i = tbe_cw_bitswap(table, swap1[0], swap1[1], swap1[2], swap1[3]);
 	debug_message(GENERIC, 3, "swap1[4] = { %d, %d, %d, %d }", swap1[0], swap1[1], swap1[2], swap1[3]);
 	debug_error_condition(i == -1);
 
@@ -364,17 +385,29 @@ tbe_cw_read_sector2(
 	struct tbe_cw			*tbe_cw,
 	struct disk_error		*dsk_err,
 	int				*lookup,
-	unsigned char			*data)
+	unsigned char			*data,
+	int				*crc,
+	int				*swap_valid)
 
 	{
+	unsigned char			table[256];
 	int				ofs, size;
 
 	*dsk_err = (struct disk_error) { };
 	if (tbe_read_sync(ffo_l0, lookup, tbe_cw->rd.sync_length) == -1) return (-1);
 	ofs = fifo_get_rd_ofs(ffo_l0);
-	if (tbe_read_bytes(ffo_l0, dsk_err, lookup, data, HEADER_SIZE) == -1) return (-1);
-	size = tbe_cw_sector_size(tbe_cw, data[5]);
-	if (tbe_read_bytes(ffo_l0, dsk_err, lookup, &data[HEADER_SIZE], size) == -1) return (-1);
+	if (tbe_read_bytes(ffo_l0, dsk_err, lookup, NULL, data, HEADER_SIZE, NULL) == -1) return (-1);
+
+	/*
+	 * the crc is calculated over the data with swapped bit pairs, so
+	 * it is updated before the bit pairs are swapped back. if the
+	 * swap vector is invalid, the data is left unchanged
+	 */
+
+	size        = tbe_cw_sector_size(tbe_cw, data[5]);
+	*crc        = tbe_crc16(tbe_cw->rw.crc16_init_value, &data[2], HEADER_SIZE - 2);
+	*swap_valid = (tbe_cw_bitswap(table, data[3] >> 6, (data[3] >> 4) & 3, (data[3] >> 2) & 3, data[3] & 3) == -1) ? 0 : 1;
+	if (tbe_read_bytes(ffo_l0, dsk_err, lookup, (*swap_valid) ? table : NULL, &data[HEADER_SIZE], size, crc) == -1) return (-1);
 	verbose_message(GENERIC, 2, "rewinding to offset %d", ofs);
 	fifo_set_rd_ofs(ffo_l0, ofs);
 	return (1);
@@ -416,9 +449,9 @@ tbe_cw_read_sector(
 	{
 	struct disk_error		dsk_err;
 	unsigned char			data[HEADER_SIZE + DATA_SIZE];
-	int				result, sector, size;
+	int				result, sector, size, crc, swap_valid;
 
-	if (tbe_cw_read_sector2(ffo_l0, tbe_cw, &dsk_err, lookup, data) == -1) return (-1);
+	if (tbe_cw_read_sector2(ffo_l0, tbe_cw, &dsk_err, lookup, data, &crc, &swap_valid) == -1) return (-1);
 
 	/* accept only valid sector numbers */
 
@@ -438,7 +471,7 @@ tbe_cw_read_sector(
 	if (tbe_cw->rd.flags & FLAG_IGNORE_SECTOR_SIZE) disk_warning_add(&dsk_err, result);
 	else disk_error_add(&dsk_err, DISK_ERROR_FLAG_SIZE, result);
 
-	result = format_compare2("crc16 checksum: got 0x%04x, expected 0x%04x", tbe_read_u16_be(data), tbe_crc16(tbe_cw->rw.crc16_init_value, &data[2], HEADER_SIZE - 2 + size));
+	result = format_compare2("crc16 checksum: got 0x%04x, expected 0x%04x", tbe_read_u16_be(data), crc);
 	if (result > 0) verbose_message(GENERIC, 2, "checksum error on sector %d", sector);
 	if (tbe_cw->rd.flags & FLAG_IGNORE_CHECKSUMS) disk_warning_add(&dsk_err, result);
 	else disk_error_add(&dsk_err, DISK_ERROR_FLAG_CHECKSUM, result);
@@ -453,10 +486,9 @@ tbe_cw_read_sector(
 	if (tbe_cw->rd.flags & FLAG_IGNORE_FORMAT_ID) disk_warning_add(&dsk_err, result);
 	else disk_error_add(&dsk_err, DISK_ERROR_FLAG_ID, result);
 
-	/* reverse swap of bit pairs */
+	/* bit pairs were already swapped back by tbe_cw_read_sector2() */
 
-	if (tbe_cw_bitswap(&data[HEADER_SIZE], size, data[3] >> 6,
-		(data[3] >> 4) & 3, (data[3] >> 2) & 3, data[3] & 3) == -1)
+	if (! swap_valid)
 		{
 		verbose_message(GENERIC, 2, "invalid bit pair swap vector on sector %d", sector);
 		disk_error_add(&dsk_err, DISK_ERROR_FLAG_NUMBERING, 1);
@@ -487,17 +519,21 @@ tbe_cw_write_sector(
 
 	{
 	unsigned char			data[HEADER_SIZE + DATA_SIZE];
+	unsigned char			table[256];
 	int				sector = disk_get_sector_number(dsk_sct);
 	int				size = tbe_cw_sector_size(tbe_cw, sector);
+	int				crc;
 
 	verbose_message(GENERIC, 1, "writing sector %d", sector);
 	disk_sector_write(&data[HEADER_SIZE], dsk_sct);
 	data[2] = tbe_cw->rw.format_id;
-	data[3] = tbe_cw_calculate_bitswap(&data[HEADER_SIZE], size);
+	data[3] = tbe_cw_calculate_bitswap(table, &data[HEADER_SIZE], size);
 	data[4] = track;
 	data[5] = sector;
 	tbe_write_u16_be(&data[6], size);
-	tbe_write_u16_be(data, tbe_crc16(tbe_cw->rw.crc16_init_value, &data[2], HEADER_SIZE - 2 + size));
+	crc = tbe_crc16(tbe_cw->rw.crc16_init_value, &data[2], HEADER_SIZE - 2);
+	crc = tbe_cw_bitswap_crc16(table, &data[HEADER_SIZE], size, crc);
+	tbe_write_u16_be(data, crc);
 	return (tbe_cw_write_sector2(ffo_l0, tbe_cw, bst_cnt, data, HEADER_SIZE + size));
 	}
 
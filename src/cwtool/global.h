@@ -45,6 +45,9 @@
 #define GLOBAL_NR_DRIVES		CW_NR_FLOPPIES
 #define GLOBAL_NR_IMAGES		64
 #define GLOBAL_NR_RETRIES		10
+#define GLOBAL_NR_REVOLUTIONS		16
+#define GLOBAL_NR_JOBS			GLOBAL_NR_IMAGES
+#define GLOBAL_NR_THREADS		64
 #define GLOBAL_MAX_CONFIG_SIZE		0x10000
 
 #define GLOBAL_NR_BOUNDS		8
@@ -54,6 +57,10 @@
 #define GLOBAL_PULSE_LENGTH_MASK	GLOBAL_MAX_PULSE_LENGTH
 #define GLOBAL_PULSE_INDEX_MASK		0x80
 
+/* the catweasel counts with 14.161 MHz, 28.322 MHz or 56.644 MHz */
+
+#define GLOBAL_CLOCK_HZ			14161000LL
+
 #if ((GLOBAL_PULSE_LENGTH_MASK & (GLOBAL_PULSE_LENGTH_MASK + 1)) != 0)
 #error "GLOBAL_PULSE_LENGTH_MASK is not a valid bit mask"
 #endif
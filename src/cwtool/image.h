@@ -45,13 +45,15 @@ union image
 #define IMAGE_TRACK_FLAG_INDEXED_WRITE	(1 << 1)
 #define IMAGE_TRACK_FLAG_FLIP_SIDE	(1 << 2)
 #define IMAGE_TRACK_FLAG_OPTIONAL	(1 << 3)
+#define IMAGE_TRACK_FLAG_SEEK_ABOVE	(1 << 4)
+#define IMAGE_TRACK_FLAG_SEEK_BELOW	(1 << 5)
 
 struct image_track
 	{
 	unsigned char			flags;
 	unsigned char			clock;
 	unsigned char			side_offset;
-	unsigned char			reserved;
+	unsigned char			revolutions;
 	unsigned short			timeout_read;
 	unsigned short			timeout_write;
 	};
@@ -28,6 +28,7 @@
 #define FLAG_NOERROR			(1 << 0)
 #define FLAG_IGNORE_SIZE		(1 << 1)
 #define FLAG_END_SEEN			(1 << 2)
+#define FLAG_POSITIONED			(1 << 3)
 
 
 
@@ -113,8 +114,13 @@ image_d64_close(
 		for (s = 0; s < size; s++) e += img->d64.errors[t][s];
 		}
 
-	/* append error information, if errors were found */
+	/*
+	 * append error information, if errors were found. tracks written
+	 * with image_d64_write_at() did not move the file position, the
+	 * error information starts after the reserved size
+	 */
 
+	if ((e > 0) && (img->d64.flags & FLAG_POSITIONED)) file_seek(&img->d64.fil, img->d64.offset, FILE_FLAG_NONE);
 	if (e > 0) for (t = 0; t < GLOBAL_NR_TRACKS; t++)
 		{
 		size = img->d64.sectors[t];
@@ -172,6 +178,31 @@ done:
 
 
 
+/****************************************************************************
+ * image_d64_errors
+ ****************************************************************************/
+static void
+image_d64_errors(
+	union image			*img,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				track)
+
+	{
+	int				s;
+
+	img->d64.sectors[track] = sectors;
+
+	/*
+	 * UGLY: directly accessing struct disk_sector is bad, better use
+	 *       functions from disk.c ?
+	 */
+
+	for (s = 0; s < sectors; s++) img->d64.errors[track][s] = (dsk_sct[s].err.errors > 0) ? 5 : 0;
+	}
+
+
+
 /****************************************************************************
  * image_d64_write
  ****************************************************************************/
@@ -186,7 +217,6 @@ image_d64_write(
 
 	{
 	int				size = fifo_get_wr_ofs(ffo);
-	int				s;
 
 	debug_error_condition(! file_is_writable(&img->d64.fil));
 	debug_error_condition((track < 0) || (track >= GLOBAL_NR_TRACKS));
@@ -195,14 +225,64 @@ image_d64_write(
 	file_write(&img->d64.fil, fifo_get_data(ffo), size);
 	fifo_set_rd_ofs(ffo, size);
 	img->d64.offset += size;
-	img->d64.sectors[track] = sectors;
+	image_d64_errors(img, dsk_sct, sectors, track);
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * image_d64_reserve
+ ****************************************************************************/
+static int
+image_d64_reserve(
+	union image			*img,
+	int				size)
+
+	{
 
 	/*
-	 * UGLY: directly accessing struct disk_sector is bad, better use
-	 *       functions from disk.c ?
+	 * give the image its final size without error information, tracks
+	 * not yet written read as zeros. only possible with regular files,
+	 * otherwise the tracks have to be written in order with
+	 * image_d64_write()
 	 */
 
-	for (s = 0; s < sectors; s++) img->d64.errors[track][s] = (dsk_sct[s].err.errors > 0) ? 5 : 0;
+	debug_error_condition(! file_is_writable(&img->d64.fil));
+	if (! file_is_regular(&img->d64.fil)) return (0);
+	verbose_message(GENERIC, 1, "reserving %d bytes for '%s'", size, file_get_path(&img->d64.fil));
+	file_truncate(&img->d64.fil, size);
+	img->d64.offset = size;
+	img->d64.flags |= FLAG_POSITIONED;
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * image_d64_write_at
+ ****************************************************************************/
+static int
+image_d64_write_at(
+	union image			*img,
+	struct image_track		*img_trk,
+	struct fifo			*ffo,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				track,
+	int				offset)
+
+	{
+	int				size = fifo_get_wr_ofs(ffo);
+
+	debug_error_condition(! (img->d64.flags & FLAG_POSITIONED));
+	debug_error_condition((track < 0) || (track >= GLOBAL_NR_TRACKS));
+	debug_error_condition((sectors <= 0) || (sectors > GLOBAL_NR_SECTORS));
+	debug_error_condition(offset + size > img->d64.offset);
+	verbose_message(GENERIC, 1, "writing D64 track %d with %d bytes at offset %d to '%s'", track, size, offset, file_get_path(&img->d64.fil));
+	file_pwrite(&img->d64.fil, fifo_get_data(ffo), size, offset);
+	fifo_set_rd_ofs(ffo, size);
+	image_d64_errors(img, dsk_sct, sectors, track);
 	return (1);
 	}
 
@@ -239,15 +319,17 @@ image_d64_done(
  ****************************************************************************/
 struct image_desc			image_d64_desc =
 	{
-	.name        = "d64",
-	.level       = 3,
-	.flags       = IMAGE_FLAG_CONTINUOUS_TRACK,
-	.open        = image_d64_open,
-	.close       = image_d64_close,
-	.offset      = image_d64_offset,
-	.track_read  = image_d64_read,
-	.track_write = image_d64_write,
-	.track_done  = image_d64_done
+	.name           = "d64",
+	.level          = 3,
+	.flags          = IMAGE_FLAG_CONTINUOUS_TRACK,
+	.open           = image_d64_open,
+	.close          = image_d64_close,
+	.offset         = image_d64_offset,
+	.track_read     = image_d64_read,
+	.track_write    = image_d64_write,
+	.track_done     = image_d64_done,
+	.reserve        = image_d64_reserve,
+	.track_write_at = image_d64_write_at
 	};
 
 
@@ -257,14 +339,16 @@ struct image_desc			image_d64_desc =
  ****************************************************************************/
 struct image_desc			image_d64_noerror_desc =
 	{
-	.name        = "d64_noerror",
-	.level       = 3,
-	.flags       = IMAGE_FLAG_CONTINUOUS_TRACK,
-	.open        = image_d64_noerror_open,
-	.close       = image_d64_close,
-	.offset      = image_d64_offset,
-	.track_read  = image_d64_read,
-	.track_write = image_d64_write,
-	.track_done  = image_d64_done
+	.name           = "d64_noerror",
+	.level          = 3,
+	.flags          = IMAGE_FLAG_CONTINUOUS_TRACK,
+	.open           = image_d64_noerror_open,
+	.close          = image_d64_close,
+	.offset         = image_d64_offset,
+	.track_read     = image_d64_read,
+	.track_write    = image_d64_write,
+	.track_done     = image_d64_done,
+	.reserve        = image_d64_reserve,
+	.track_write_at = image_d64_write_at
 	};
 /******************************************************** Karsten Scheibler */
@@ -33,6 +33,11 @@ struct image_desc
 	int				(*track_read)(union image *, struct image_track *, struct fifo *, struct disk_sector *, int, int);
 	int				(*track_write)(union image *, struct image_track *, struct fifo *, struct disk_sector *, int, int);
 	int				(*track_done)(union image *, struct image_track *, int);
+	int				(*track_position)(union image *, struct image_track *, int);
+	int				(*head_steps)(union image *);
+	int				(*reserve)(union image *, int);
+	int				(*track_write_at)(union image *, struct image_track *, struct fifo *, struct disk_sector *, int, int, int);
+	int				(*release)(union image *);
 	};
 
 
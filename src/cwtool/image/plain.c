@@ -26,6 +26,7 @@
 
 #define FLAG_IGNORE_SIZE		(1 << 0)
 #define FLAG_END_SEEN			(1 << 1)
+#define FLAG_POSITIONED			(1 << 2)
 
 
 
@@ -135,6 +136,57 @@ image_plain_write(
 
 
 
+/****************************************************************************
+ * image_plain_reserve
+ ****************************************************************************/
+static int
+image_plain_reserve(
+	union image			*img,
+	int				size)
+
+	{
+
+	/*
+	 * give the image its final size, tracks not yet written read as
+	 * zeros. only possible with regular files, otherwise the tracks
+	 * have to be written in order with image_plain_write()
+	 */
+
+	debug_error_condition(! file_is_writable(&img->pln.fil));
+	if (! file_is_regular(&img->pln.fil)) return (0);
+	verbose_message(GENERIC, 1, "reserving %d bytes for '%s'", size, file_get_path(&img->pln.fil));
+	file_truncate(&img->pln.fil, size);
+	img->pln.flags |= FLAG_POSITIONED;
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * image_plain_write_at
+ ****************************************************************************/
+static int
+image_plain_write_at(
+	union image			*img,
+	struct image_track		*img_trk,
+	struct fifo			*ffo,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				track,
+	int				offset)
+
+	{
+	int				size = fifo_get_wr_ofs(ffo);
+
+	debug_error_condition(! (img->pln.flags & FLAG_POSITIONED));
+	verbose_message(GENERIC, 1, "writing plain track %d with %d bytes at offset %d to '%s'", track, size, offset, file_get_path(&img->pln.fil));
+	file_pwrite(&img->pln.fil, fifo_get_data(ffo), size, offset);
+	fifo_set_rd_ofs(ffo, size);
+	return (1);
+	}
+
+
+
 /****************************************************************************
  * image_plain_done
  ****************************************************************************/
@@ -166,14 +218,16 @@ image_plain_done(
  ****************************************************************************/
 struct image_desc			image_plain_desc =
 	{
-	.name        = "plain",
-	.level       = 3,
-	.flags       = IMAGE_FLAG_CONTINUOUS_TRACK,
-	.open        = image_plain_open,
-	.close       = image_plain_close,
-	.offset      = image_plain_offset,
-	.track_read  = image_plain_read,
-	.track_write = image_plain_write,
-	.track_done  = image_plain_done
+	.name           = "plain",
+	.level          = 3,
+	.flags          = IMAGE_FLAG_CONTINUOUS_TRACK,
+	.open           = image_plain_open,
+	.close          = image_plain_close,
+	.offset         = image_plain_offset,
+	.track_read     = image_plain_read,
+	.track_write    = image_plain_write,
+	.track_done     = image_plain_done,
+	.reserve        = image_plain_reserve,
+	.track_write_at = image_plain_write_at
 	};
 /******************************************************** Karsten Scheibler */
@@ -25,6 +25,7 @@
 #include "../image.h"
 #include "../import.h"
 #include "../export.h"
+#include "../dump.h"
 #include "../parse.h"
 #include "../string.h"
 
@@ -41,8 +42,15 @@
 #define SUBTYPE_NONE			0
 #define SUBTYPE_DATA			1
 #define SUBTYPE_TEXT			2
+#define SUBTYPE_DUMP			3
 
 #define FLAG_SEARCH_HINTS		(1 << 0)
+#define FLAG_TMP_OPENED			(1 << 1)
+
+#define HINT_FILE_INVALID		0
+#define HINT_FILE_ORIGINAL		1
+#define HINT_FILE_TMP			2
+#define HINT_FILE_MEMORY		3
 
 #define TRACK_MAGIC			0xca
 #define TRACK_FLAG_DONE			(1 << 0)
@@ -153,9 +161,18 @@ image_raw_ioctl(
 		debug_message(GENERIC, 2, "drive only supports double steps, so track is halved");
 		}
 
-	/* for now do no special handling for a "preposition track" */
+	/*
+	 * the "preposition track" lets the driver step onto the track from
+	 * the given direction, this may influence the final head position.
+	 * head and steps only estimate what the driver does, a recalibration
+	 * after a disk change is not known here
+	 */
 
 	tri.track_seek = tri.track;
+	if ((img_trk->flags & IMAGE_TRACK_FLAG_SEEK_ABOVE) && (tri.track + 1 < img_raw->fli.nr_tracks)) tri.track_seek = tri.track + 1;
+	if ((img_trk->flags & IMAGE_TRACK_FLAG_SEEK_BELOW) && (tri.track > 0)) tri.track_seek = tri.track - 1;
+	img_raw->steps += abs(tri.track_seek - img_raw->head) + abs(tri.track - tri.track_seek);
+	img_raw->head   = tri.track;
 	verbose_message(GENERIC, 1, "accessing hardware track %d side %d with timeout %d ms on '%s'", tri.track, tri.side, tri.timeout, file_get_path(&img_raw->fil[0]));
 	if (tri.clock >= img_raw->fli.nr_clocks) error_message("error while accessing track %d, clock is not supported by device '%s'", track, file_get_path(&img_raw->fil[0]));
 	if (tri.track >= img_raw->fli.nr_tracks) error_message("error while accessing track %d, track is not supported by device '%s'", track, file_get_path(&img_raw->fil[0]));
@@ -168,6 +185,58 @@ done:
 
 
 
+/****************************************************************************
+ * image_raw_timeout
+ ****************************************************************************/
+static int
+image_raw_timeout(
+	struct image_raw		*img_raw,
+	struct image_track		*img_trk)
+
+	{
+	int				timeout;
+
+	/*
+	 * to get the given number of complete revolutions between two
+	 * index pulses, one more revolution has to be read, because
+	 * reading does not start at the index. as long as no revolution
+	 * was measured, the configured timeout is used
+	 */
+
+	if ((img_trk->revolutions == 0) || (img_raw->revolution_time == 0)) return (img_trk->timeout_read);
+	timeout = (img_trk->revolutions + 1) * img_raw->revolution_time;
+	if (timeout <= CW_MIN_TIMEOUT) timeout = CW_MIN_TIMEOUT + 1;
+	if (timeout >= CW_MAX_TIMEOUT) timeout = CW_MAX_TIMEOUT - 1;
+	return (timeout);
+	}
+
+
+
+/****************************************************************************
+ * image_raw_measure_revolution
+ ****************************************************************************/
+static void
+image_raw_measure_revolution(
+	struct image_raw		*img_raw,
+	struct image_track		*img_trk,
+	struct fifo			*ffo)
+
+	{
+	unsigned char			*data = fifo_get_data(ffo);
+	cw_count64_t			ticks;
+	int				offsets[2];
+	int				i;
+
+	/* time between the first two index pulses in ms */
+
+	if (fifo_get_index_offsets(ffo, offsets, 2) < 2) return;
+	for (i = offsets[0], ticks = 0; i < offsets[1]; i++) ticks += data[i] & GLOBAL_PULSE_LENGTH_MASK;
+	img_raw->revolution_time = (ticks * 1000) / (GLOBAL_CLOCK_HZ << img_trk->clock);
+	verbose_message(GENERIC, 2, "measured revolution time of %d ms", img_raw->revolution_time);
+	}
+
+
+
 /****************************************************************************
  * image_raw_seekable
  ****************************************************************************/
@@ -178,7 +247,6 @@ image_raw_seekable(
 	{
 	if ((file_seek(&img_raw->fil[0], 1, FILE_FLAG_RETURN) == 1) &&
 		(file_seek(&img_raw->fil[0], 0, FILE_FLAG_RETURN) == 0)) return (CW_BOOL_TRUE);
-	file_open(&img_raw->fil[1], NULL, FILE_MODE_TMP, FILE_FLAG_NONE);
 	return (CW_BOOL_FALSE);
 	}
 
@@ -290,6 +358,40 @@ image_raw_read_track_data(
 
 
 
+/****************************************************************************
+ * image_raw_read_track_dump
+ ****************************************************************************/
+static cw_size_t
+image_raw_read_track_dump(
+	struct image_raw		*img_raw,
+	struct file			*fil,
+	struct track_header		*trk_hdr,
+	struct fifo			*ffo)
+
+	{
+	cw_size_t			size = sizeof (struct track_header);
+
+	/*
+	 * a binary bad sector dump is like raw data, but each track is
+	 * followed by an index, error bytes and lookup lengths, which are
+	 * skipped here. as with raw text empty tracks are skipped too
+	 */
+
+	do
+		{
+		if (file_read(fil, trk_hdr, sizeof (struct track_header)) == 0) return (0);
+		if (trk_hdr->magic != TRACK_MAGIC) error_message("wrong header magic in file '%s'", file_get_path(fil));
+		size = import_u32_le(trk_hdr->size);
+		if ((size < 0) || (size > fifo_get_limit(ffo))) error_message("track %d too large in file '%s'", trk_hdr->track, file_get_path(fil));
+		file_read_strict(fil, fifo_get_data(ffo), size);
+		dump_skip_index(fil, size);
+		}
+	while (size == 0);
+	return (size);
+	}
+
+
+
 /****************************************************************************
  * image_raw_read_track_text
  ****************************************************************************/
@@ -331,15 +433,9 @@ image_raw_read_track_text(
 			};
 		parse_token(&img_raw->prs, token, GLOBAL_MAX_NAME_SIZE);
 		if (! string_equal(token, "{")) parse_error(&img_raw->prs, "{ expected");
-		size = 0;
 		parse_hex_only(&img_raw->prs, hex_only);
-		while (1)
-			{
-			if (parse_token(&img_raw->prs, token, GLOBAL_MAX_NAME_SIZE) == 0) parse_error(&img_raw->prs, "} expected");
-			if (string_equal(token, "}")) break;
-			if (size > limit) parse_error(&img_raw->prs, "track %d too large");
-			data[size++] = parse_number(&img_raw->prs, token, GLOBAL_MAX_NAME_SIZE);
-			}
+		size = parse_numbers(&img_raw->prs, data, limit);
+		if (size == -1) parse_error(&img_raw->prs, "track %d too large", trk_hdr->track);
 		parse_hex_only(&img_raw->prs, CW_BOOL_FALSE);
 		}
 	while (size == 0);
@@ -363,28 +459,20 @@ image_raw_read_track_text(
 
 
 /****************************************************************************
- * image_raw_read_track2
+ * image_raw_read_track3
  ****************************************************************************/
 static cw_size_t
-image_raw_read_track2(
+image_raw_read_track3(
 	struct image_raw		*img_raw,
 	struct file			*fil,
 	struct image_track		*img_trk,
 	struct track_header		*trk_hdr,
 	struct fifo			*ffo,
-	cw_type_t			subtype)
+	cw_size_t			size)
 
 	{
-	cw_size_t			size;
 	cw_bool_t			do_correction = CW_BOOL_TRUE;
 
-	/* get data */
-
-	fifo_reset(ffo);
-	if (subtype == SUBTYPE_DATA) size = image_raw_read_track_data(img_raw, fil, trk_hdr, ffo);
-	else size = image_raw_read_track_text(img_raw, fil, trk_hdr, ffo);
-	if (size == 0) return (0);
-
 	if (trk_hdr->track >= GLOBAL_NR_TRACKS) error_message("invalid track in file '%s'", file_get_path(fil));
 	if (trk_hdr->clock >= CW_NR_CLOCKS) error_message("invalid clock in file '%s'", file_get_path(fil));
 	if (trk_hdr->flags & HEADER_FLAG_WRITABLE)      fifo_set_flags(ffo, FIFO_FLAG_WRITABLE);
@@ -434,6 +522,86 @@ image_raw_read_track2(
 
 
 
+/****************************************************************************
+ * image_raw_read_track2
+ ****************************************************************************/
+static cw_size_t
+image_raw_read_track2(
+	struct image_raw		*img_raw,
+	struct file			*fil,
+	struct image_track		*img_trk,
+	struct track_header		*trk_hdr,
+	struct fifo			*ffo,
+	cw_type_t			subtype)
+
+	{
+	cw_size_t			size;
+
+	/* get data */
+
+	fifo_reset(ffo);
+	if (subtype == SUBTYPE_DATA) size = image_raw_read_track_data(img_raw, fil, trk_hdr, ffo);
+	else if (subtype == SUBTYPE_DUMP) size = image_raw_read_track_dump(img_raw, fil, trk_hdr, ffo);
+	else size = image_raw_read_track_text(img_raw, fil, trk_hdr, ffo);
+	if (size == 0) return (0);
+	return (image_raw_read_track3(img_raw, fil, img_trk, trk_hdr, ffo, size));
+	}
+
+
+
+/****************************************************************************
+ * image_raw_hint_release
+ ****************************************************************************/
+static cw_void_t
+image_raw_hint_release(
+	struct image_raw		*img_raw,
+	struct image_raw_hint		*hnt)
+
+	{
+	if (hnt->data == NULL) return;
+	free(hnt->data);
+	img_raw->buffer_used -= hnt->size;
+	hnt->data = NULL;
+	}
+
+
+
+/****************************************************************************
+ * image_raw_read_track_memory
+ ****************************************************************************/
+static cw_size_t
+image_raw_read_track_memory(
+	struct image_raw		*img_raw,
+	struct image_raw_hint		*hnt,
+	struct image_track		*img_trk,
+	struct track_header		*trk_hdr,
+	struct fifo			*ffo)
+
+	{
+	cw_size_t			size = hnt->size;
+
+	/*
+	 * the buffered track is released immediately, it will not be
+	 * needed again after this read
+	 */
+
+	fifo_reset(ffo);
+	*trk_hdr = (struct track_header)
+		{
+		.magic = TRACK_MAGIC,
+		.track = hnt->track,
+		.clock = hnt->clock,
+		.flags = hnt->flags
+		};
+	export_u32_le(trk_hdr->size, size);
+	if (size > fifo_get_limit(ffo)) error_message("track %d too large in file '%s'", trk_hdr->track, file_get_path(&img_raw->fil[0]));
+	memcpy(fifo_get_data(ffo), hnt->data, size);
+	image_raw_hint_release(img_raw, hnt);
+	return (image_raw_read_track3(img_raw, &img_raw->fil[0], img_trk, trk_hdr, ffo, size));
+	}
+
+
+
 /****************************************************************************
  * image_raw_found
  ****************************************************************************/
@@ -489,14 +657,34 @@ image_raw_hint_store(
 	int				offset)
 
 	{
-	int				file = 1;
+	cw_size_t			limit = 1024 * 1024 * (cw_size_t) options_get_raw_buffer_size();
+	cw_raw8_t			*data = NULL;
+	int				file = HINT_FILE_ORIGINAL;
 
 	if (img_raw->track_flags[trk_hdr->track] & TRACK_FLAG_DONE) return;
 	if (img_raw->hints >= IMAGE_RAW_NR_HINTS) error_message("file '%s' has too many tracks", file_get_path(&img_raw->fil[0]));
-	if (img_raw->type == TYPE_PIPE)
+
+	/*
+	 * a pipe can not be read again, so the track is kept in memory as
+	 * long as raw_buffer_size is not exceeded. only after that the
+	 * temporary file is created and used
+	 */
+
+	if ((img_raw->type == TYPE_PIPE) && (img_raw->buffer_used + size <= limit))
+		{
+		verbose_message(GENERIC, 1, "keeping track %d in memory", trk_hdr->track);
+		file = HINT_FILE_MEMORY;
+		data = malloc(size);
+		if (data == NULL) error_oom();
+		memcpy(data, fifo_get_data(ffo), size);
+		img_raw->buffer_used += size;
+		}
+	else if (img_raw->type == TYPE_PIPE)
 		{
+		if (! (img_raw->flags & FLAG_TMP_OPENED)) file_open(&img_raw->fil[1], NULL, FILE_MODE_TMP, FILE_FLAG_NONE);
+		img_raw->flags |= FLAG_TMP_OPENED;
 		verbose_message(GENERIC, 1, "appending track to '%s'", file_get_path(&img_raw->fil[1]));
-		file   = 2;
+		file   = HINT_FILE_TMP;
 		offset = file_seek(&img_raw->fil[1], -1, FILE_FLAG_NONE);
 		file_write(&img_raw->fil[1], trk_hdr, sizeof (struct track_header));
 		file_write(&img_raw->fil[1], fifo_get_data(ffo), size);
@@ -508,7 +696,9 @@ image_raw_hint_store(
 		.track  = trk_hdr->track,
 		.clock  = trk_hdr->clock,
 		.flags  = trk_hdr->flags,
-		.offset = offset
+		.offset = offset,
+		.data   = data,
+		.size   = size
 		};
 	}
 
@@ -548,17 +738,24 @@ image_raw_hint_search(
 		/* continue if track not found or hint already invalidated */
 
 		if ((! image_raw_found(img_raw, img_trk, &trk_hdr, track)) ||
-			(img_raw->hnt[h].file == 0)) continue;
+			(img_raw->hnt[h].file == HINT_FILE_INVALID)) continue;
 
 		/*
-		 * file == 0 original file, may be in data or text format
+		 * file == 0 original file, may be in data, dump or text format
 		 * file == 1 temporary file, data format only
+		 * file == 2 memory, data format only
 		 */
 
 		file = img_raw->hnt[h].file - 1;
 		if (file == 0) subtype = img_raw->subtype;
 		else subtype = SUBTYPE_DATA;
-		img_raw->hnt[h].file = 0;
+		img_raw->hnt[h].file = HINT_FILE_INVALID;
+		if (file == 2)
+			{
+			debug_message(GENERIC, 2, "found hint, h = %d file = %d, track = %d", h, file, track);
+			verbose_message(GENERIC, 1, "reading raw track %d from memory", track);
+			return (image_raw_read_track_memory(img_raw, &img_raw->hnt[h], img_trk, &trk_hdr, ffo));
+			}
 		debug_message(GENERIC, 2, "found hint, h = %d file = %d, track = %d, offset = %d", h, file, track, img_raw->hnt[h].offset);
 		file_seek(&img_raw->fil[file], img_raw->hnt[h].offset, FILE_FLAG_NONE);
 		verbose_message(GENERIC, 1, "reading raw track %d from '%s'", track, file_get_path(&img_raw->fil[file]));
@@ -591,9 +788,10 @@ image_raw_hint_invalidate(
 	img_raw->track_flags[track] |= TRACK_FLAG_DONE;
 	for (h = 0; h < img_raw->hints; h++)
 		{
-		if ((img_raw->hnt[h].file == 0) || (img_raw->hnt[h].track != track)) continue;
+		if ((img_raw->hnt[h].file == HINT_FILE_INVALID) || (img_raw->hnt[h].track != track)) continue;
 		debug_message(GENERIC, 2, "invalidating hint, h = %d", h);
-		img_raw->hnt[h].file = 0;
+		img_raw->hnt[h].file = HINT_FILE_INVALID;
+		image_raw_hint_release(img_raw, &img_raw->hnt[h]);
 		}
 	}
 
@@ -743,6 +941,7 @@ image_raw_open(
 	static const char		magic_data2[MAGIC_SIZE] = "cwtool raw data 2";
 	static const char		magic_data3[MAGIC_SIZE] = "cwtool raw data 3";
 	static const char		magic_text3[MAGIC_SIZE] = "# cwtool raw text 3\n";
+	static const char		magic_dump3[MAGIC_SIZE] = DUMP_MAGIC;
 	char				buffer[MAGIC_SIZE], *type_name, *subtype_name;
 	int				i;
 
@@ -752,6 +951,9 @@ image_raw_open(
 
 	type_name        = "device";
 	subtype_name     = "";
+	img->raw.head    = 0;
+	img->raw.steps   = 0;
+	img->raw.revolution_time = 0;
 	img->raw.type    = TYPE_DEVICE;
 	img->raw.subtype = SUBTYPE_NONE;
 	img->raw.fli     = CW_FLOPPYINFO_INIT;
@@ -777,6 +979,7 @@ image_raw_open(
 			if (buffer[i] == magic_data[i]) continue;
 			if (buffer[i] == magic_data2[i]) continue;
 			if (buffer[i] == magic_data3[i]) continue;
+			if (buffer[i] == magic_dump3[i]) continue;
 			if (buffer[i] == magic_text3[i]) continue;
 			if (magic_text3[i] == '\0')
 				{
@@ -785,6 +988,11 @@ image_raw_open(
 				}
 			error_message("file '%s' has wrong magic", file_get_path(&img->raw.fil[0]));
 			}
+		if (memcmp(buffer, magic_dump3, MAGIC_SIZE) == 0)
+			{
+			subtype_name     = " (bad sector dump)";
+			img->raw.subtype = SUBTYPE_DUMP;
+			}
 		if (img->raw.subtype == SUBTYPE_TEXT)
 			{
 			subtype_name = " (text)";
@@ -812,6 +1020,27 @@ done:
 
 
 
+/****************************************************************************
+ * image_raw_release
+ ****************************************************************************/
+static int
+image_raw_release(
+	union image			*img)
+
+	{
+	int				h;
+
+	/*
+	 * frees the tracks kept in memory without touching the files, also
+	 * called if an error terminated the job (cwtool -B)
+	 */
+
+	for (h = 0; h < img->raw.hints; h++) image_raw_hint_release(&img->raw, &img->raw.hnt[h]);
+	return (1);
+	}
+
+
+
 /****************************************************************************
  * image_raw_close
  ****************************************************************************/
@@ -829,8 +1058,9 @@ image_raw_close(
 	if ((file_is_readable(&img->raw.fil[0])) && (img->raw.type == TYPE_PIPE))
 		{
 		while (image_raw_read_track2(&img->raw, &img->raw.fil[0], NULL, &trk_hdr, &ffo, img->raw.subtype) > 0) ;
-		file_close(&img->raw.fil[1]);
+		if (img->raw.flags & FLAG_TMP_OPENED) file_close(&img->raw.fil[1]);
 		}
+	image_raw_release(img);
 	return (image_close(img, &img->raw.fil[0]));
 	}
 
@@ -884,6 +1114,7 @@ image_raw_read(
 	int				size = fifo_get_limit(ffo);
 	int				mode = CW_TRACKINFO_MODE_INDEX_STORE;
 	int				flag = FIFO_FLAG_INDEX_STORED;
+	int				timeout = img_trk->timeout_read;
 
 	track = image_raw_track_translate(img_trk, track);
 	debug_error_condition(! file_is_readable(&img->raw.fil[0]));
@@ -891,8 +1122,9 @@ image_raw_read(
 	if (img->raw.type == TYPE_DEVICE)
 		{
 		if (img_trk->flags & IMAGE_TRACK_FLAG_INDEXED_READ) mode = CW_TRACKINFO_MODE_INDEX_WAIT, flag = FIFO_FLAG_INDEX_ALIGNED;
+		else timeout = image_raw_timeout(&img->raw, img_trk);
 		fifo_set_flags(ffo, flag);
-		size = image_raw_ioctl(&img->raw, img_trk, img_trk->timeout_read, track,
+		size = image_raw_ioctl(&img->raw, img_trk, timeout, track,
 			CW_IOC_READ, mode, fifo_get_data(ffo), size);
 		}
 	else size = image_raw_read_track(&img->raw, img_trk, ffo, track);
@@ -904,6 +1136,7 @@ image_raw_read(
 		verbose_message(GENERIC, 1, "truncating track according to track_size_limit to %d bytes", size);
 		}
 	fifo_set_wr_ofs(ffo, size);
+	if ((img->raw.type == TYPE_DEVICE) && (flag == FIFO_FLAG_INDEX_STORED)) image_raw_measure_revolution(&img->raw, img_trk, ffo);
 	return (1);
 	}
 
@@ -981,6 +1214,47 @@ image_raw_done(
 
 
 
+/****************************************************************************
+ * image_raw_position
+ ****************************************************************************/
+static int
+image_raw_position(
+	union image			*img,
+	struct image_track		*img_trk,
+	int				track)
+
+	{
+	int				cylinder;
+
+	/*
+	 * return the position of the given track on the device as
+	 * 2 * cylinder + side, so tracks may be ordered to keep head
+	 * movement low. pipes and files have no head, -1 is returned
+	 */
+
+	if (img->raw.type != TYPE_DEVICE) return (-1);
+	track    = image_raw_track_translate(img_trk, track);
+	cylinder = track / 2;
+	if (img->raw.fli.flags & CW_FLOPPYINFO_FLAG_DOUBLE_STEP) cylinder /= 2;
+	return (2 * cylinder + (track & 1));
+	}
+
+
+
+/****************************************************************************
+ * image_raw_steps
+ ****************************************************************************/
+static int
+image_raw_steps(
+	union image			*img)
+
+	{
+	if (img->raw.type != TYPE_DEVICE) return (-1);
+	return (img->raw.steps);
+	}
+
+
+
 
 /****************************************************************************
  *
@@ -996,14 +1270,17 @@ image_raw_done(
  ****************************************************************************/
 struct image_desc			image_raw_desc =
 	{
-	.name        = "raw",
-	.level       = 0,
-	.flags       = IMAGE_FLAG_SAME_TRACK,
-	.open        = image_raw_open,
-	.close       = image_raw_close,
-	.offset      = image_raw_offset,
-	.track_read  = image_raw_read,
-	.track_write = image_raw_write,
-	.track_done  = image_raw_done
+	.name           = "raw",
+	.level          = 0,
+	.flags          = IMAGE_FLAG_SAME_TRACK,
+	.open           = image_raw_open,
+	.close          = image_raw_close,
+	.offset         = image_raw_offset,
+	.track_read     = image_raw_read,
+	.track_write    = image_raw_write,
+	.track_done     = image_raw_done,
+	.track_position = image_raw_position,
+	.head_steps     = image_raw_steps,
+	.release        = image_raw_release
 	};
 /******************************************************** Karsten Scheibler */
@@ -30,6 +30,8 @@ struct image_raw_hint
 	unsigned char			clock;
 	unsigned char			flags;
 	int				offset;
+	cw_raw8_t			*data;	/* track data, if kept in memory */
+	cw_size_t			size;
 	};
 
 struct image_raw_text
@@ -52,6 +54,10 @@ struct image_raw
 	int				subtype;
 	int				flags;
 	int				track_flags[GLOBAL_NR_TRACKS];
+	int				head;
+	int				steps;
+	int				revolution_time;
+	cw_size_t			buffer_used;
 	struct image_raw_text		txt;
 	struct parse			prs;
 	};
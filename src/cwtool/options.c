@@ -17,6 +17,7 @@
 #include "debug.h"
 #include "verbose.h"
 #include "global.h"
+#include "string.h"
 
 
 
@@ -36,7 +37,10 @@ static struct options			opt =
 	.disk_track_end     = GLOBAL_NR_TRACKS - 1,
 	.output_track_start = 0,
 	.output_track_end   = GLOBAL_NR_TRACKS - 1,
-	.track_size_limit   = GLOBAL_MAX_TRACK_SIZE
+	.track_size_limit   = GLOBAL_MAX_TRACK_SIZE,
+	.cache_size         = 256,
+	.raw_buffer_size    = 64,
+	.write_verify_retry = 3
 	};
 
 
@@ -186,6 +190,33 @@ options_get_output(
 
 
 
+/****************************************************************************
+ * options_set_output_binary
+ ****************************************************************************/
+cw_bool_t
+options_set_output_binary(
+	cw_bool_t			value)
+
+	{
+	opt.output_binary = (value != 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_output_binary
+ ****************************************************************************/
+cw_bool_t
+options_get_output_binary(
+	cw_void_t)
+
+	{
+	return (opt.output_binary);
+	}
+
+
+
 /****************************************************************************
  * options_set_output_track_start
  ****************************************************************************/
@@ -323,4 +354,396 @@ options_get_track_size_limit(
 	{
 	return (opt.track_size_limit);
 	}
+
+
+
+/****************************************************************************
+ * options_set_decode_threads
+ ****************************************************************************/
+cw_bool_t
+options_set_decode_threads(
+	cw_count_t			value)
+
+	{
+	if ((value < 0) || (value > GLOBAL_NR_THREADS)) return (CW_BOOL_FAIL);
+	opt.decode_threads = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_decode_threads
+ ****************************************************************************/
+cw_count_t
+options_get_decode_threads(
+	cw_void_t)
+
+	{
+	return (opt.decode_threads);
+	}
+
+
+
+/****************************************************************************
+ * options_set_exhaustive_read
+ ****************************************************************************/
+cw_bool_t
+options_set_exhaustive_read(
+	cw_bool_t			value)
+
+	{
+	opt.exhaustive_read = (value != 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_exhaustive_read
+ ****************************************************************************/
+cw_bool_t
+options_get_exhaustive_read(
+	cw_void_t)
+
+	{
+	return (opt.exhaustive_read);
+	}
+
+
+
+/****************************************************************************
+ * options_set_seek_optimize
+ ****************************************************************************/
+cw_bool_t
+options_set_seek_optimize(
+	cw_count_t			value)
+
+	{
+	if ((value < 0) || (value > 2)) return (CW_BOOL_FAIL);
+	opt.seek_optimize = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_seek_optimize
+ ****************************************************************************/
+cw_count_t
+options_get_seek_optimize(
+	cw_void_t)
+
+	{
+	return (opt.seek_optimize);
+	}
+
+
+
+/****************************************************************************
+ * options_set_cache_size
+ ****************************************************************************/
+cw_bool_t
+options_set_cache_size(
+	cw_count_t			value)
+
+	{
+	if (value < 0) return (CW_BOOL_FAIL);
+	opt.cache_size = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_cache_size
+ ****************************************************************************/
+cw_count_t
+options_get_cache_size(
+	cw_void_t)
+
+	{
+	return (opt.cache_size);
+	}
+
+
+
+/****************************************************************************
+ * options_set_cache_verify
+ ****************************************************************************/
+cw_bool_t
+options_set_cache_verify(
+	cw_bool_t			value)
+
+	{
+	opt.cache_verify = (value != 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_cache_verify
+ ****************************************************************************/
+cw_bool_t
+options_get_cache_verify(
+	cw_void_t)
+
+	{
+	return (opt.cache_verify);
+	}
+
+
+
+/****************************************************************************
+ * options_set_cache_path
+ ****************************************************************************/
+cw_bool_t
+options_set_cache_path(
+	const cw_char_t			*path)
+
+	{
+	string_copy(opt.cache_path, GLOBAL_MAX_PATH_SIZE, path);
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_cache_path
+ ****************************************************************************/
+const cw_char_t *
+options_get_cache_path(
+	cw_void_t)
+
+	{
+
+	/* an empty path means no cache is used */
+
+	if (opt.cache_path[0] == '\0') return (NULL);
+	return (opt.cache_path);
+	}
+
+
+
+/****************************************************************************
+ * options_set_batch_jobs
+ ****************************************************************************/
+cw_bool_t
+options_set_batch_jobs(
+	cw_count_t			value)
+
+	{
+	if ((value < 0) || (value > GLOBAL_NR_THREADS)) return (CW_BOOL_FAIL);
+	opt.batch_jobs = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_batch_jobs
+ ****************************************************************************/
+cw_count_t
+options_get_batch_jobs(
+	cw_void_t)
+
+	{
+	return (opt.batch_jobs);
+	}
+
+
+
+/****************************************************************************
+ * options_set_statistics_format
+ ****************************************************************************/
+cw_bool_t
+options_set_statistics_format(
+	cw_mode_t			value)
+
+	{
+	if ((value != OPTIONS_STATISTICS_FORMAT_TEXT) &&
+		(value != OPTIONS_STATISTICS_FORMAT_CSV) &&
+		(value != OPTIONS_STATISTICS_FORMAT_JSON)) return (CW_BOOL_FAIL);
+	opt.statistics_format = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_statistics_format
+ ****************************************************************************/
+cw_mode_t
+options_get_statistics_format(
+	cw_void_t)
+
+	{
+	return (opt.statistics_format);
+	}
+
+
+
+/****************************************************************************
+ * options_set_raw_buffer_size
+ ****************************************************************************/
+cw_bool_t
+options_set_raw_buffer_size(
+	cw_count_t			value)
+
+	{
+	if ((value < 0) || (value > 0x100000)) return (CW_BOOL_FAIL);
+	opt.raw_buffer_size = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_raw_buffer_size
+ ****************************************************************************/
+cw_count_t
+options_get_raw_buffer_size(
+	cw_void_t)
+
+	{
+	return (opt.raw_buffer_size);
+	}
+
+
+
+/****************************************************************************
+ * options_set_encode_threads
+ ****************************************************************************/
+cw_bool_t
+options_set_encode_threads(
+	cw_count_t			value)
+
+	{
+	if ((value < 0) || (value > GLOBAL_NR_THREADS)) return (CW_BOOL_FAIL);
+	opt.encode_threads = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_encode_threads
+ ****************************************************************************/
+cw_count_t
+options_get_encode_threads(
+	cw_void_t)
+
+	{
+	return (opt.encode_threads);
+	}
+
+
+
+/****************************************************************************
+ * options_set_write_verify
+ ****************************************************************************/
+cw_bool_t
+options_set_write_verify(
+	cw_bool_t			value)
+
+	{
+	opt.write_verify = (value != 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_write_verify
+ ****************************************************************************/
+cw_bool_t
+options_get_write_verify(
+	cw_void_t)
+
+	{
+	return (opt.write_verify);
+	}
+
+
+
+/****************************************************************************
+ * options_set_write_verify_retry
+ ****************************************************************************/
+cw_bool_t
+options_set_write_verify_retry(
+	cw_count_t			value)
+
+	{
+	if ((value < 0) || (value > GLOBAL_NR_RETRIES)) return (CW_BOOL_FAIL);
+	opt.write_verify_retry = value;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_write_verify_retry
+ ****************************************************************************/
+cw_count_t
+options_get_write_verify_retry(
+	cw_void_t)
+
+	{
+	return (opt.write_verify_retry);
+	}
+
+
+
+/****************************************************************************
+ * options_set_bounds_calibrate
+ ****************************************************************************/
+cw_bool_t
+options_set_bounds_calibrate(
+	cw_bool_t			value)
+
+	{
+	opt.bounds_calibrate = (value != 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_bounds_calibrate
+ ****************************************************************************/
+cw_bool_t
+options_get_bounds_calibrate(
+	cw_void_t)
+
+	{
+	return (opt.bounds_calibrate);
+	}
+
+
+
+/****************************************************************************
+ * options_set_split_revolutions
+ ****************************************************************************/
+cw_bool_t
+options_set_split_revolutions(
+	cw_bool_t			value)
+
+	{
+	opt.split_revolutions = (value != 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_split_revolutions
+ ****************************************************************************/
+cw_bool_t
+options_get_split_revolutions(
+	cw_void_t)
+
+	{
+	return (opt.split_revolutions);
+	}
 /******************************************************** Karsten Scheibler */
@@ -14,6 +14,7 @@
 #define CWTOOL_OPTIONS_H
 
 #include "types.h"
+#include "global.h"
 
 
 
@@ -27,6 +28,10 @@
 
 
 
+#define OPTIONS_STATISTICS_FORMAT_TEXT	0
+#define OPTIONS_STATISTICS_FORMAT_CSV	1
+#define OPTIONS_STATISTICS_FORMAT_JSON	2
+
 struct options
 	{
 	cw_bool_t			histogram_exponential;
@@ -34,11 +39,26 @@ struct options
 	cw_bool_t			always_initialize;
 	cw_bool_t			clock_adjust;
 	cw_bool_t			output;
+	cw_bool_t			output_binary;
 	cw_count_t			disk_track_start;
 	cw_count_t			disk_track_end;
 	cw_count_t			output_track_start;
 	cw_count_t			output_track_end;
 	cw_count_t			track_size_limit;
+	cw_count_t			decode_threads;
+	cw_bool_t			exhaustive_read;
+	cw_count_t			seek_optimize;
+	cw_count_t			cache_size;
+	cw_bool_t			cache_verify;
+	cw_char_t			cache_path[GLOBAL_MAX_PATH_SIZE];
+	cw_count_t			batch_jobs;
+	cw_mode_t			statistics_format;
+	cw_count_t			raw_buffer_size;
+	cw_count_t			encode_threads;
+	cw_bool_t			write_verify;
+	cw_count_t			write_verify_retry;
+	cw_bool_t			bounds_calibrate;
+	cw_bool_t			split_revolutions;
 	};
 
 
@@ -93,6 +113,14 @@ extern cw_bool_t
 options_get_output(
 	cw_void_t);
 
+extern cw_bool_t
+options_set_output_binary(
+	cw_bool_t			value);
+
+extern cw_bool_t
+options_get_output_binary(
+	cw_void_t);
+
 extern cw_bool_t
 options_set_disk_track_start(
 	cw_count_t			track);
@@ -133,6 +161,118 @@ extern cw_count_t
 options_get_track_size_limit(
 	cw_void_t);
 
+extern cw_bool_t
+options_set_decode_threads(
+	cw_count_t			value);
+
+extern cw_count_t
+options_get_decode_threads(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_exhaustive_read(
+	cw_bool_t			value);
+
+extern cw_bool_t
+options_get_exhaustive_read(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_seek_optimize(
+	cw_count_t			value);
+
+extern cw_count_t
+options_get_seek_optimize(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_cache_size(
+	cw_count_t			value);
+
+extern cw_count_t
+options_get_cache_size(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_cache_verify(
+	cw_bool_t			value);
+
+extern cw_bool_t
+options_get_cache_verify(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_cache_path(
+	const cw_char_t			*path);
+
+extern const cw_char_t *
+options_get_cache_path(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_batch_jobs(
+	cw_count_t			value);
+
+extern cw_count_t
+options_get_batch_jobs(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_statistics_format(
+	cw_mode_t			value);
+
+extern cw_mode_t
+options_get_statistics_format(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_raw_buffer_size(
+	cw_count_t			value);
+
+extern cw_count_t
+options_get_raw_buffer_size(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_encode_threads(
+	cw_count_t			value);
+
+extern cw_count_t
+options_get_encode_threads(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_write_verify(
+	cw_bool_t			value);
+
+extern cw_bool_t
+options_get_write_verify(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_write_verify_retry(
+	cw_count_t			value);
+
+extern cw_count_t
+options_get_write_verify_retry(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_bounds_calibrate(
+	cw_bool_t			value);
+
+extern cw_bool_t
+options_get_bounds_calibrate(
+	cw_void_t);
+
+extern cw_bool_t
+options_set_split_revolutions(
+	cw_bool_t			value);
+
+extern cw_bool_t
+options_get_split_revolutions(
+	cw_void_t);
+
 
 
 #endif /* !CWTOOL_OPTIONS_H */
@@ -192,6 +192,53 @@ parse_number_bin(
 
 
 
+/****************************************************************************
+ * parse_number_short
+ ****************************************************************************/
+static cw_s32_t
+parse_number_short(
+	struct parse			*prs,
+	cw_char_t			*token,
+	cw_count_t			len)
+
+	{
+	cw_char_t			c;
+	cw_s32_t			num = 0;
+	cw_index_t			i;
+
+	/*
+	 * convert tokens with at most 2 hexadecimal or 3 decimal digits
+	 * directly, with max_number 0 or >= 99 none of them can exceed
+	 * max_number before the last digit. everything else is given to
+	 * parse_number(), which also generates the error messages
+	 */
+
+	if ((prs->max_number > 0) && (prs->max_number < 99)) return (parse_number(prs, token, len));
+	if (prs->flags & PARSE_FLAG_HEX_ONLY)
+		{
+		if (len > 2) return (parse_number(prs, token, len));
+		for (i = 0; i < len; i++)
+			{
+			c = token[i];
+			if ((c >= '0') && (c <= '9')) c -= '0';
+			else if ((c >= 'a') && (c <= 'f')) c -= 'a' - 10;
+			else return (parse_number(prs, token, len));
+			num = 16 * num + c;
+			}
+		return (num);
+		}
+	if (len > 3) return (parse_number(prs, token, len));
+	for (i = 0; i < len; i++)
+		{
+		c = token[i];
+		if ((c < '0') || (c > '9')) return (parse_number(prs, token, len));
+		num = 10 * num + c - '0';
+		}
+	return (num);
+	}
+
+
+
 /****************************************************************************
  * parse_init_file2
  ****************************************************************************/
@@ -623,6 +670,60 @@ parse_number_range(
 
 
 
+/****************************************************************************
+ * parse_numbers
+ ****************************************************************************/
+cw_count_t
+parse_numbers(
+	struct parse			*prs,
+	cw_raw8_t			*data,
+	cw_count_t			limit)
+
+	{
+	cw_char_t			token[GLOBAL_MAX_NAME_SIZE];
+	cw_bool_t			comment = CW_BOOL_FALSE;
+	cw_bool_t			space_valid;
+	cw_char_t			c;
+	cw_index_t			i;
+	cw_count_t			size = 0;
+
+	/*
+	 * read numbers until the token "}", this does the same as calling
+	 * parse_token() and parse_number() for every number, but letters,
+	 * digits and spaces are taken directly from the text buffer. all
+	 * other characters and refilling the text buffer are left to
+	 * parse_get_char(), so line and char of error messages are the
+	 * same. returns the number of values or -1 if there are more than
+	 * limit
+	 */
+
+	error_condition(! (prs->flags & PARSE_FLAG_INITIALIZED));
+	space_valid = (strchr(prs->valid_chars, ' ') != NULL) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	for (i = 0; ; )
+		{
+		if (i >= GLOBAL_MAX_NAME_SIZE - 1) parse_error(prs, "token too long");
+		c = (prs->ofs < prs->limit) ? prs->text[prs->ofs] : '\0';
+		if (((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) ||
+			((c >= 'A') && (c <= 'Z')) || ((c == ' ') && (space_valid))) prs->ofs++, prs->line_ofs++;
+		else c = parse_get_char(prs, comment);
+		if (parse_comment(c, &comment)) continue;
+		if ((c != '\0') && (! parse_is_space(c)))
+			{
+			token[i++] = c;
+			continue;
+			}
+		if ((c != '\0') && (i == 0)) continue;
+		if (i == 0) parse_error(prs, "} expected");
+		token[i] = '\0';
+		if ((i == 1) && (token[0] == '}')) return (size);
+		if (size >= limit) return (-1);
+		data[size++] = parse_number_short(prs, token, i);
+		i = 0;
+		}
+	}
+
+
+
 /****************************************************************************
  * parse_boolean
  ****************************************************************************/
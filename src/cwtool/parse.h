@@ -167,6 +167,12 @@ parse_number_range(
 	cw_s32_t			min,
 	cw_s32_t			max);
 
+extern cw_count_t
+parse_numbers(
+	struct parse			*prs,
+	cw_raw8_t			*data,
+	cw_count_t			limit);
+
 extern cw_bool_t
 parse_boolean(
 	struct parse			*prs,
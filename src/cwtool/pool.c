@@ -0,0 +1,119 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * pool.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * pool_init
+ ****************************************************************************/
+cw_bool_t
+pool_init(
+	struct pool			*pol,
+	cw_count_t			slots)
+
+	{
+
+	/* slots == 0 means one slot for each online cpu */
+
+	if (slots == 0) slots = sysconf(_SC_NPROCESSORS_ONLN);
+	if (slots < 1) slots = 1;
+	*pol = (struct pool) { .slots = slots };
+	if (pthread_mutex_init(&pol->mutex, NULL) != 0) error_message("error while initializing pool mutex");
+	if (pthread_cond_init(&pol->cond, NULL) != 0) error_message("error while initializing pool condition");
+	verbose_message(GENERIC, 1, "using pool with %d slots", slots);
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * pool_deinit
+ ****************************************************************************/
+cw_void_t
+pool_deinit(
+	struct pool			*pol)
+
+	{
+	debug_error_condition(pol->used != 0);
+	pthread_cond_destroy(&pol->cond);
+	pthread_mutex_destroy(&pol->mutex);
+	}
+
+
+
+/****************************************************************************
+ * pool_get_slots
+ ****************************************************************************/
+cw_count_t
+pool_get_slots(
+	struct pool			*pol)
+
+	{
+	return (pol->slots);
+	}
+
+
+
+/****************************************************************************
+ * pool_enter
+ ****************************************************************************/
+cw_void_t
+pool_enter(
+	struct pool			*pol)
+
+	{
+
+	/* without a pool there is no limit */
+
+	if (pol == NULL) return;
+	pthread_mutex_lock(&pol->mutex);
+	while (pol->used >= pol->slots) pthread_cond_wait(&pol->cond, &pol->mutex);
+	pol->used++;
+	pthread_mutex_unlock(&pol->mutex);
+	}
+
+
+
+/****************************************************************************
+ * pool_leave
+ ****************************************************************************/
+cw_void_t
+pool_leave(
+	struct pool			*pol)
+
+	{
+	if (pol == NULL) return;
+	pthread_mutex_lock(&pol->mutex);
+	debug_error_condition(pol->used <= 0);
+	pol->used--;
+	pthread_cond_signal(&pol->cond);
+	pthread_mutex_unlock(&pol->mutex);
+	}
+/******************************************************** Karsten Scheibler */
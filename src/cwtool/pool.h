@@ -0,0 +1,82 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * pool.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_POOL_H
+#define CWTOOL_POOL_H
+
+#include <pthread.h>
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * a pool limits the number of threads doing cpu intensive work (like
+ * decoding of tracks) at the same time. a thread has to enter the pool
+ * before doing such work and leave it afterwards
+ */
+
+struct pool
+	{
+	pthread_mutex_t			mutex;
+	pthread_cond_t			cond;
+	cw_count_t			slots;
+	cw_count_t			used;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_bool_t
+pool_init(
+	struct pool			*pol,
+	cw_count_t			slots);
+
+extern cw_void_t
+pool_deinit(
+	struct pool			*pol);
+
+extern cw_count_t
+pool_get_slots(
+	struct pool			*pol);
+
+extern cw_void_t
+pool_enter(
+	struct pool			*pol);
+
+extern cw_void_t
+pool_leave(
+	struct pool			*pol);
+
+
+
+#endif /* !CWTOOL_POOL_H */
+/******************************************************** Karsten Scheibler */
@@ -0,0 +1,274 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * resume.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resume.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "file.h"
+#include "disk.h"
+#include "import.h"
+#include "export.h"
+#include "scratch.h"
+#include "string.h"
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * resume_header
+ ****************************************************************************/
+static cw_void_t
+resume_header(
+	cw_u8_t				*header,
+	const cw_char_t			*name,
+	cw_count_t			entries)
+
+	{
+	memset(header, 0, RESUME_HEADER_SIZE);
+	memcpy(header, RESUME_MAGIC, sizeof (RESUME_MAGIC));
+	string_copy((cw_char_t *) &header[RESUME_MAGIC_SIZE], GLOBAL_MAX_NAME_SIZE, name);
+	export_u32_le(&header[RESUME_MAGIC_SIZE + GLOBAL_MAX_NAME_SIZE], entries);
+	}
+
+
+
+/****************************************************************************
+ * resume_load
+ ****************************************************************************/
+static cw_size_t
+resume_load(
+	struct resume			*rsm,
+	const cw_char_t			*name)
+
+	{
+	struct resume_track		*rsm_trk;
+	struct file			fil;
+	cw_u8_t				header[RESUME_HEADER_SIZE];
+	cw_u8_t				header2[RESUME_HEADER_SIZE];
+	cw_u8_t				record[RESUME_RECORD_SIZE];
+	cw_u8_t				sector[GLOBAL_NR_SECTORS * RESUME_SECTOR_SIZE];
+	cw_raw8_t			*data;
+	cw_count_t			records = 0, sectors;
+	cw_size_t			size, valid = RESUME_HEADER_SIZE;
+	cw_index_t			index, i;
+
+	if (! file_open(&fil, rsm->path, FILE_MODE_READ, FILE_FLAG_RETURN))
+		{
+		verbose_message(GENERIC, 1, "no resume journal '%s', reading all tracks", rsm->path);
+		return (-1);
+		}
+	resume_header(header, name, rsm->entries);
+	if (file_read(&fil, header2, RESUME_HEADER_SIZE) != RESUME_HEADER_SIZE) error_message("file '%s' is not a resume journal", rsm->path);
+	if (memcmp(header, header2, RESUME_MAGIC_SIZE) != 0) error_message("file '%s' is not a resume journal", rsm->path);
+	if (memcmp(header, header2, RESUME_HEADER_SIZE) != 0) error_message("resume journal '%s' belongs to another disk", rsm->path);
+	rsm->rsm_trk = calloc(rsm->entries, sizeof (struct resume_track));
+	if (rsm->rsm_trk == NULL) error_oom();
+
+	/*
+	 * a record is only taken if it is complete, a later record of the
+	 * same track replaces an earlier one
+	 */
+
+	data = scratch_alloc(GLOBAL_MAX_TRACK_SIZE * sizeof (cw_raw8_t));
+	while (1)
+		{
+		if (file_read(&fil, record, RESUME_RECORD_SIZE) != RESUME_RECORD_SIZE) break;
+		index   = import_u32_le(&record[4]);
+		sectors = import_u32_le(&record[8]);
+		size    = import_u32_le(&record[12]);
+		if ((record[0] != RESUME_RECORD_MAGIC) ||
+			((record[1] != RESUME_TRACK_GOOD) && (record[1] != RESUME_TRACK_BAD)) ||
+			(index < 0) || (index >= rsm->entries) ||
+			(sectors < 0) || (sectors > GLOBAL_NR_SECTORS) ||
+			(size < 0) || (size > GLOBAL_MAX_TRACK_SIZE)) error_message("invalid record in resume journal '%s'", rsm->path);
+		if (file_read(&fil, sector, sectors * RESUME_SECTOR_SIZE) != sectors * RESUME_SECTOR_SIZE) break;
+		if (file_read(&fil, data, size) != size) break;
+		rsm_trk = &rsm->rsm_trk[index];
+		rsm_trk->status  = record[1];
+		rsm_trk->sectors = sectors;
+		rsm_trk->size    = size;
+		for (i = 0; i < sectors; i++) rsm_trk->err[i] = (struct disk_error)
+			{
+			.flags    = import_u32_le(&sector[i * RESUME_SECTOR_SIZE]),
+			.errors   = import_u32_le(&sector[i * RESUME_SECTOR_SIZE + 4]),
+			.warnings = import_u32_le(&sector[i * RESUME_SECTOR_SIZE + 8])
+			};
+		if (rsm_trk->data != NULL) free(rsm_trk->data);
+
+		/* one more byte, so malloc() does not return NULL for size 0 */
+
+		rsm_trk->data = malloc(size + 1);
+		if (rsm_trk->data == NULL) error_oom();
+		memcpy(rsm_trk->data, data, size);
+		valid += RESUME_RECORD_SIZE + sectors * RESUME_SECTOR_SIZE + size;
+		records++;
+		}
+	scratch_free(data);
+	file_close(&fil);
+	verbose_message(GENERIC, 1, "got %d records from resume journal '%s'", records, rsm->path);
+	return (valid);
+	}
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * resume_open
+ ****************************************************************************/
+cw_void_t
+resume_open(
+	struct resume			*rsm,
+	const cw_char_t			*path,
+	const cw_char_t			*name,
+	cw_count_t			entries,
+	cw_bool_t			load)
+
+	{
+	cw_u8_t				header[RESUME_HEADER_SIZE];
+	cw_size_t			valid = -1;
+
+	debug_error_condition((entries < 0) || (entries > GLOBAL_NR_TRACKS));
+	*rsm = (struct resume) { .entries = entries };
+	string_snprintf(rsm->path, GLOBAL_MAX_PATH_SIZE, "%s%s", path, RESUME_SUFFIX);
+	if (load) valid = resume_load(rsm, name);
+
+	/*
+	 * an old journal is kept and new records are appended to it, so
+	 * the tracks taken from it are not lost if cwtool terminates early
+	 * again. a truncated last record is cut off first
+	 */
+
+	if (valid >= 0)
+		{
+		file_open(&rsm->fil, rsm->path, FILE_MODE_WRITE, FILE_FLAG_NONE);
+		file_truncate(&rsm->fil, valid);
+		file_seek(&rsm->fil, valid, FILE_FLAG_NONE);
+		return;
+		}
+	resume_header(header, name, entries);
+	file_open(&rsm->fil, rsm->path, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	file_write(&rsm->fil, header, RESUME_HEADER_SIZE);
+	}
+
+
+
+/****************************************************************************
+ * resume_close
+ ****************************************************************************/
+cw_void_t
+resume_close(
+	struct resume			*rsm,
+	cw_bool_t			complete)
+
+	{
+	file_close(&rsm->fil);
+	if (complete) file_unlink(rsm->path);
+	}
+
+
+
+/****************************************************************************
+ * resume_free
+ ****************************************************************************/
+cw_void_t
+resume_free(
+	struct resume			*rsm)
+
+	{
+	cw_index_t			i;
+
+	/* may be called more than once, also if resume_open() failed */
+
+	if (rsm->rsm_trk == NULL) return;
+	for (i = 0; i < rsm->entries; i++) if (rsm->rsm_trk[i].data != NULL) free(rsm->rsm_trk[i].data);
+	free(rsm->rsm_trk);
+	rsm->rsm_trk = NULL;
+	}
+
+
+
+/****************************************************************************
+ * resume_track_get
+ ****************************************************************************/
+struct resume_track *
+resume_track_get(
+	struct resume			*rsm,
+	cw_index_t			index)
+
+	{
+	debug_error_condition((index < 0) || (index >= rsm->entries));
+	if (rsm->rsm_trk == NULL) return (NULL);
+	if (rsm->rsm_trk[index].status == RESUME_TRACK_NONE) return (NULL);
+	return (&rsm->rsm_trk[index]);
+	}
+
+
+
+/****************************************************************************
+ * resume_track_write
+ ****************************************************************************/
+cw_void_t
+resume_track_write(
+	struct resume			*rsm,
+	cw_index_t			index,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			sectors,
+	const cw_raw8_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_u8_t				record[RESUME_RECORD_SIZE + GLOBAL_NR_SECTORS * RESUME_SECTOR_SIZE] = { };
+	cw_u8_t				*sector = &record[RESUME_RECORD_SIZE];
+	cw_mode_t			status = RESUME_TRACK_GOOD;
+	cw_index_t			i;
+
+	debug_error_condition((index < 0) || (index >= rsm->entries));
+	debug_error_condition((sectors < 0) || (sectors > GLOBAL_NR_SECTORS));
+	for (i = 0; i < sectors; i++, sector += RESUME_SECTOR_SIZE)
+		{
+		if (dsk_sct[i].err.errors > 0) status = RESUME_TRACK_BAD;
+		export_u32_le(&sector[0], dsk_sct[i].err.flags);
+		export_u32_le(&sector[4], dsk_sct[i].err.errors);
+		export_u32_le(&sector[8], dsk_sct[i].err.warnings);
+		}
+	record[0] = RESUME_RECORD_MAGIC;
+	record[1] = status;
+	export_u32_le(&record[4], index);
+	export_u32_le(&record[8], sectors);
+	export_u32_le(&record[12], size);
+	file_write(&rsm->fil, record, RESUME_RECORD_SIZE + sectors * RESUME_SECTOR_SIZE);
+	file_write(&rsm->fil, data, size);
+	}
+/******************************************************** Karsten Scheibler */
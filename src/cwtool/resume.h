@@ -0,0 +1,131 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * resume.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_RESUME_H
+#define CWTOOL_RESUME_H
+
+#include "types.h"
+#include "global.h"
+#include "file.h"
+#include "disk.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * while reading into an image file, a resume journal is kept next to it
+ * (RESUME_SUFFIX appended to the image path). it starts with a header
+ * of RESUME_HEADER_SIZE bytes:
+ *
+ *   RESUME_MAGIC padded to RESUME_MAGIC_SIZE bytes
+ *   disk name padded to GLOBAL_MAX_NAME_SIZE bytes
+ *   u32 trackmap entries (le)
+ *
+ * followed by one record for each track written to the image, in the
+ * order the tracks were written:
+ *
+ *   u8  0xcc, status, 0, 0, trackmap index (u32 le), sectors (u32 le),
+ *       size (u32 le)
+ *   sectors * { flags (u32 le), errors (u32 le), warnings (u32 le) }
+ *   u8  data[size]
+ *
+ * a record is appended after the track data was written to the image,
+ * so if cwtool terminates early, the journal tells which parts of the
+ * image are valid. a truncated last record is ignored. if a track
+ * appears more than once, the last record counts. the journal is
+ * removed after all tracks were written
+ */
+
+#define RESUME_MAGIC			"cwtool resume journal 2"
+#define RESUME_MAGIC_SIZE		32
+#define RESUME_HEADER_SIZE		(RESUME_MAGIC_SIZE + GLOBAL_MAX_NAME_SIZE + 4)
+#define RESUME_RECORD_MAGIC		0xcc
+#define RESUME_RECORD_SIZE		16
+#define RESUME_SECTOR_SIZE		12
+#define RESUME_SUFFIX			".resume"
+
+#define RESUME_TRACK_NONE		0
+#define RESUME_TRACK_GOOD		1
+#define RESUME_TRACK_BAD		2
+
+struct resume_track
+	{
+	cw_mode_t			status;
+	cw_count_t			sectors;
+	cw_size_t			size;
+	struct disk_error		err[GLOBAL_NR_SECTORS];
+	cw_raw8_t			*data;
+	};
+
+struct resume
+	{
+	struct file			fil;
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_count_t			entries;
+	struct resume_track		*rsm_trk;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+resume_open(
+	struct resume			*rsm,
+	const cw_char_t			*path,
+	const cw_char_t			*name,
+	cw_count_t			entries,
+	cw_bool_t			load);
+
+extern cw_void_t
+resume_close(
+	struct resume			*rsm,
+	cw_bool_t			complete);
+
+extern cw_void_t
+resume_free(
+	struct resume			*rsm);
+
+extern struct resume_track *
+resume_track_get(
+	struct resume			*rsm,
+	cw_index_t			index);
+
+extern cw_void_t
+resume_track_write(
+	struct resume			*rsm,
+	cw_index_t			index,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			sectors,
+	const cw_raw8_t			*data,
+	cw_size_t			size);
+
+
+#endif /* !CWTOOL_RESUME_H */
+/******************************************************** Karsten Scheibler */
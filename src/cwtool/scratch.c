@@ -0,0 +1,156 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * scratch.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "scratch.h"
+#include "error.h"
+#include "debug.h"
+
+
+
+struct scratch
+	{
+	cw_void_t			*data[SCRATCH_NR_BUFFERS];
+	cw_size_t			size[SCRATCH_NR_BUFFERS];
+	cw_count_t			used;
+	};
+
+static pthread_once_t			scratch_once = PTHREAD_ONCE_INIT;
+static pthread_key_t			scratch_key;
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * scratch_destroy
+ ****************************************************************************/
+static cw_void_t
+scratch_destroy(
+	cw_void_t			*arg)
+
+	{
+	struct scratch			*scr = (struct scratch *) arg;
+	cw_index_t			i;
+
+	/*
+	 * called on thread exit, also if an error terminated the thread
+	 * while buffers were still in use
+	 */
+
+	for (i = 0; i < SCRATCH_NR_BUFFERS; i++) if (scr->data[i] != NULL) free(scr->data[i]);
+	free(scr);
+	}
+
+
+
+/****************************************************************************
+ * scratch_key_init
+ ****************************************************************************/
+static cw_void_t
+scratch_key_init(
+	cw_void_t)
+
+	{
+	if (pthread_key_create(&scratch_key, scratch_destroy) != 0) error_message("error while creating scratch key");
+	}
+
+
+
+/****************************************************************************
+ * scratch_get
+ ****************************************************************************/
+static struct scratch *
+scratch_get(
+	cw_void_t)
+
+	{
+	struct scratch			*scr;
+
+	pthread_once(&scratch_once, scratch_key_init);
+	scr = (struct scratch *) pthread_getspecific(scratch_key);
+	if (scr != NULL) return (scr);
+	scr = calloc(1, sizeof (struct scratch));
+	if (scr == NULL) error_oom();
+	if (pthread_setspecific(scratch_key, scr) != 0) error_message("error while setting scratch key");
+	return (scr);
+	}
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * scratch_alloc
+ ****************************************************************************/
+cw_void_t *
+scratch_alloc(
+	cw_size_t			size)
+
+	{
+	struct scratch			*scr = scratch_get();
+	cw_index_t			i = scr->used;
+
+	/*
+	 * the contents of the returned buffer are undefined, a buffer
+	 * only grows, so after the first tracks no further allocation
+	 * is needed
+	 */
+
+	error_condition(i >= SCRATCH_NR_BUFFERS);
+	if (scr->size[i] < size)
+		{
+		if (scr->data[i] != NULL) free(scr->data[i]);
+		scr->data[i] = malloc(size);
+		if (scr->data[i] == NULL) error_oom();
+		scr->size[i] = size;
+		debug_message(GENERIC, 2, "scratch buffer %d has now %d bytes", i, size);
+		}
+	scr->used++;
+	return (scr->data[i]);
+	}
+
+
+
+/****************************************************************************
+ * scratch_free
+ ****************************************************************************/
+cw_void_t
+scratch_free(
+	cw_void_t			*data)
+
+	{
+	struct scratch			*scr = scratch_get();
+
+	error_condition(scr->used <= 0);
+	error_condition(scr->data[scr->used - 1] != data);
+	scr->used--;
+	}
+/******************************************************** Karsten Scheibler */
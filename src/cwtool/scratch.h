@@ -0,0 +1,63 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * scratch.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_SCRATCH_H
+#define CWTOOL_SCRATCH_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * each thread has its own scratch arena for the track sized buffers
+ * and containers needed while reading, decoding and encoding a track.
+ * buffers are kept for the lifetime of the thread, so they are
+ * allocated only once and not zeroed on each use. they have to be
+ * released with scratch_free() in reverse order of scratch_alloc()
+ */
+
+#define SCRATCH_NR_BUFFERS		16
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t *
+scratch_alloc(
+	cw_size_t			size);
+
+extern cw_void_t
+scratch_free(
+	cw_void_t			*data);
+
+
+
+#endif /* !CWTOOL_SCRATCH_H */
+/******************************************************** Karsten Scheibler */
@@ -0,0 +1,543 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * statistics.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "statistics.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "options.h"
+#include "fifo.h"
+#include "string.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define LINE_SIZE			8192
+#define VALUE_SIZE			32
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * statistics_nsecs
+ ****************************************************************************/
+static cw_count64_t
+statistics_nsecs(
+	cw_count64_t			ticks,
+	cw_count_t			clock)
+
+	{
+	return ((ticks * 1000000000LL) / (GLOBAL_CLOCK_HZ << clock));
+	}
+
+
+
+/****************************************************************************
+ * statistics_peaks
+ ****************************************************************************/
+static cw_void_t
+statistics_peaks(
+	struct statistics_track		*stt_trk)
+
+	{
+	cw_count_t			*histogram = stt_trk->histogram;
+	cw_count_t			max, threshold, top, width;
+	cw_count64_t			sum, count;
+	cw_index_t			i, j, k;
+
+	/*
+	 * a peak is a range of consecutive counter values, each of them
+	 * occuring at least 1/32 as often as the most frequent one
+	 */
+
+	for (i = max = 0; i < GLOBAL_NR_PULSE_LENGTHS; i++) if (histogram[i] > max) max = histogram[i];
+	threshold = (max >= 32) ? max / 32 : 1;
+	for (i = stt_trk->peaks = 0; (i < GLOBAL_NR_PULSE_LENGTHS) && (stt_trk->peaks < STATISTICS_NR_PEAKS); i = j)
+		{
+		for (j = i, sum = count = top = 0; (j < GLOBAL_NR_PULSE_LENGTHS) && (histogram[j] >= threshold); j++)
+			{
+			sum   += (cw_count64_t) j * histogram[j];
+			count += histogram[j];
+			if (histogram[j] > top) top = histogram[j];
+			}
+		if (count == 0)
+			{
+			j++;
+			continue;
+			}
+		for (k = i, width = 0; k < j; k++) if (2 * histogram[k] >= top) width++;
+		stt_trk->pek[stt_trk->peaks++] = (struct statistics_peak)
+			{
+			.position = (100 * sum) / count,
+			.width    = width,
+			.count    = count
+			};
+		}
+	}
+
+
+
+/****************************************************************************
+ * statistics_revolutions
+ ****************************************************************************/
+static cw_void_t
+statistics_revolutions(
+	struct statistics_track		*stt_trk)
+
+	{
+	cw_raw8_t			*data = stt_trk->data;
+	cw_count64_t			ticks, last = -1, nsecs;
+	cw_index_t			i, index, previous;
+
+	/*
+	 * with the index stored, bit 7 of each counter value contains the
+	 * state of the index signal. a revolution lasts from one rising
+	 * edge of this signal to the next
+	 */
+
+	if ((! (stt_trk->flags & FIFO_FLAG_INDEX_STORED)) || (stt_trk->size == 0)) return;
+	previous = data[0] & GLOBAL_PULSE_INDEX_MASK;
+	for (i = 0, ticks = 0; i < stt_trk->size; i++)
+		{
+		index  = data[i] & GLOBAL_PULSE_INDEX_MASK;
+		ticks += data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		if ((index) && (! previous))
+			{
+			if (last != -1)
+				{
+				nsecs = statistics_nsecs(ticks - last, stt_trk->clock);
+				if ((stt_trk->revolutions == 0) || (nsecs < stt_trk->revolution_min)) stt_trk->revolution_min = nsecs;
+				if ((stt_trk->revolutions == 0) || (nsecs > stt_trk->revolution_max)) stt_trk->revolution_max = nsecs;
+				stt_trk->revolution_nsecs += nsecs;
+				stt_trk->revolutions++;
+				}
+			last = ticks;
+			}
+		previous = index;
+		}
+	}
+
+
+
+/****************************************************************************
+ * statistics_track_calculate
+ ****************************************************************************/
+static cw_void_t
+statistics_track_calculate(
+	struct statistics_track		*stt_trk)
+
+	{
+	cw_count64_t			ticks;
+	cw_index_t			d, i;
+
+	for (i = 0, ticks = 0; i < stt_trk->size; i++)
+		{
+		d = stt_trk->data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		stt_trk->histogram[d]++;
+		ticks += d;
+		}
+	stt_trk->pulses = stt_trk->size;
+	stt_trk->nsecs  = statistics_nsecs(ticks, stt_trk->clock);
+	statistics_revolutions(stt_trk);
+	statistics_peaks(stt_trk);
+	}
+
+
+
+/****************************************************************************
+ * statistics_thread
+ ****************************************************************************/
+static cw_void_t *
+statistics_thread(
+	cw_void_t			*arg)
+
+	{
+	struct statistics		*stt = (struct statistics *) arg;
+	cw_index_t			i;
+
+	while (1)
+		{
+		pthread_mutex_lock(&stt->mutex);
+		i = stt->next++;
+		pthread_mutex_unlock(&stt->mutex);
+		if (i >= stt->tracks) break;
+		statistics_track_calculate(&stt->stt_trk[i]);
+		}
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * statistics_sum
+ ****************************************************************************/
+static cw_void_t
+statistics_sum(
+	struct statistics		*stt)
+
+	{
+	struct statistics_track		*sum = &stt->sum;
+	struct statistics_track		*stt_trk;
+	cw_index_t			i, j;
+
+	*sum = (struct statistics_track) { .cwtool_track = -1, .clock = -1 };
+	for (i = 0; i < stt->tracks; i++)
+		{
+		stt_trk = &stt->stt_trk[i];
+		if (i == 0) sum->clock = stt_trk->clock;
+		if (sum->clock != stt_trk->clock) sum->clock = -1;
+		for (j = 0; j < GLOBAL_NR_PULSE_LENGTHS; j++) sum->histogram[j] += stt_trk->histogram[j];
+		sum->pulses += stt_trk->pulses;
+		sum->nsecs  += stt_trk->nsecs;
+		if (stt_trk->revolutions == 0) continue;
+		if ((sum->revolutions == 0) || (stt_trk->revolution_min < sum->revolution_min)) sum->revolution_min = stt_trk->revolution_min;
+		if ((sum->revolutions == 0) || (stt_trk->revolution_max > sum->revolution_max)) sum->revolution_max = stt_trk->revolution_max;
+		sum->revolution_nsecs += stt_trk->revolution_nsecs;
+		sum->revolutions      += stt_trk->revolutions;
+		}
+	statistics_peaks(sum);
+	}
+
+
+
+/****************************************************************************
+ * statistics_field
+ ****************************************************************************/
+static cw_count_t
+statistics_field(
+	cw_char_t			*line,
+	cw_size_t			size,
+	cw_count_t			l,
+	cw_mode_t			format,
+	const cw_char_t			*name,
+	const cw_char_t			*value)
+
+	{
+	const cw_char_t			*separator = ((l == 0) || (line[l - 1] == '{')) ? "" : ",";
+
+	/* unknown values are given as empty strings */
+
+	if (format == OPTIONS_STATISTICS_FORMAT_CSV) return (l + string_snprintf(&line[l], size - l, "%s%s", separator, value));
+	if (value[0] == '\0') value = "null";
+	return (l + string_snprintf(&line[l], size - l, "%s \"%s\": %s", separator, name, value));
+	}
+
+
+
+/****************************************************************************
+ * statistics_usecs
+ ****************************************************************************/
+static cw_char_t *
+statistics_usecs(
+	cw_char_t			*value,
+	cw_count64_t			nsecs)
+
+	{
+	string_snprintf(value, VALUE_SIZE, "%lld.%03lld", nsecs / 1000, nsecs % 1000);
+	return (value);
+	}
+
+
+
+/****************************************************************************
+ * statistics_hundredths
+ ****************************************************************************/
+static cw_char_t *
+statistics_hundredths(
+	cw_char_t			*value,
+	cw_count64_t			number)
+
+	{
+	string_snprintf(value, VALUE_SIZE, "%lld.%02lld", number / 100, number % 100);
+	return (value);
+	}
+
+
+
+/****************************************************************************
+ * statistics_number
+ ****************************************************************************/
+static cw_char_t *
+statistics_number(
+	cw_char_t			*value,
+	cw_count64_t			number)
+
+	{
+	string_snprintf(value, VALUE_SIZE, "%lld", number);
+	return (value);
+	}
+
+
+
+/****************************************************************************
+ * statistics_line
+ ****************************************************************************/
+static cw_char_t *
+statistics_line(
+	cw_char_t			*line,
+	cw_size_t			size,
+	struct statistics_track		*stt_trk,
+	cw_mode_t			format)
+
+	{
+	cw_char_t			value[VALUE_SIZE];
+	cw_count64_t			average = 0;
+	cw_count_t			l = 0;
+	cw_index_t			i;
+
+	/*
+	 * with csv each track is one line with a fixed number of columns,
+	 * with json each track is one object. the summary of the whole
+	 * disk has no track number
+	 */
+
+	if (stt_trk->revolutions > 0) average = stt_trk->revolution_nsecs / stt_trk->revolutions;
+	if (format == OPTIONS_STATISTICS_FORMAT_JSON) l = string_snprintf(line, size, "{");
+	if (stt_trk->cwtool_track != -1) l = statistics_field(line, size, l, format, "track", statistics_number(value, stt_trk->cwtool_track));
+	else l = statistics_field(line, size, l, format, "track", (format == OPTIONS_STATISTICS_FORMAT_CSV) ? "all" : "");
+	l = statistics_field(line, size, l, format, "clock", (stt_trk->clock != -1) ? statistics_number(value, stt_trk->clock) : "");
+	l = statistics_field(line, size, l, format, "pulses", statistics_number(value, stt_trk->pulses));
+	l = statistics_field(line, size, l, format, "time_us", statistics_usecs(value, stt_trk->nsecs));
+	l = statistics_field(line, size, l, format, "revolutions", statistics_number(value, stt_trk->revolutions));
+	l = statistics_field(line, size, l, format, "revolution_us", (average > 0) ? statistics_usecs(value, average) : "");
+	l = statistics_field(line, size, l, format, "revolution_min_us", (average > 0) ? statistics_usecs(value, stt_trk->revolution_min) : "");
+	l = statistics_field(line, size, l, format, "revolution_max_us", (average > 0) ? statistics_usecs(value, stt_trk->revolution_max) : "");
+	l = statistics_field(line, size, l, format, "rpm", (average > 0) ? statistics_hundredths(value, 6000000000000LL / average) : "");
+	l = statistics_field(line, size, l, format, "peaks", statistics_number(value, stt_trk->peaks));
+	if (format == OPTIONS_STATISTICS_FORMAT_CSV)
+		{
+		for (i = 0; i < STATISTICS_NR_PEAKS; i++)
+			{
+			l = statistics_field(line, size, l, format, NULL, (i < stt_trk->peaks) ? statistics_hundredths(value, stt_trk->pek[i].position) : "");
+			l = statistics_field(line, size, l, format, NULL, (i < stt_trk->peaks) ? statistics_number(value, stt_trk->pek[i].width) : "");
+			l = statistics_field(line, size, l, format, NULL, (i < stt_trk->peaks) ? statistics_number(value, stt_trk->pek[i].count) : "");
+			}
+		for (i = 0; i < GLOBAL_NR_PULSE_LENGTHS; i++) l = statistics_field(line, size, l, format, NULL, statistics_number(value, stt_trk->histogram[i]));
+		return (line);
+		}
+	l += string_snprintf(&line[l], size - l, ", \"peak\": [");
+	for (i = 0; i < stt_trk->peaks; i++)
+		{
+		l += string_snprintf(&line[l], size - l, "%s{", (i > 0) ? ", " : "");
+		l = statistics_field(line, size, l, format, "position", statistics_hundredths(value, stt_trk->pek[i].position));
+		l = statistics_field(line, size, l, format, "width", statistics_number(value, stt_trk->pek[i].width));
+		l = statistics_field(line, size, l, format, "count", statistics_number(value, stt_trk->pek[i].count));
+		l += string_snprintf(&line[l], size - l, " }");
+		}
+	l += string_snprintf(&line[l], size - l, "], \"histogram\": [");
+	for (i = 0; i < GLOBAL_NR_PULSE_LENGTHS; i++) l += string_snprintf(&line[l], size - l, "%s%d", (i > 0) ? ", " : "", stt_trk->histogram[i]);
+	string_snprintf(&line[l], size - l, "] }");
+	return (line);
+	}
+
+
+
+/****************************************************************************
+ * statistics_json_string
+ ****************************************************************************/
+static cw_char_t *
+statistics_json_string(
+	cw_char_t			*line,
+	cw_size_t			size,
+	const cw_char_t			*string)
+
+	{
+	cw_count_t			l;
+	cw_index_t			i;
+
+	/* quotes, backslashes and control characters have to be escaped */
+
+	for (i = l = 0; (string[i] != '\0') && (l + 7 < size); i++)
+		{
+		if ((string[i] == '"') || (string[i] == '\\')) l += string_snprintf(&line[l], size - l, "\\%c", string[i]);
+		else if ((cw_u8_t) string[i] < 0x20) l += string_snprintf(&line[l], size - l, "\\u%04x", (cw_u8_t) string[i]);
+		else line[l++] = string[i];
+		}
+	line[l] = '\0';
+	return (line);
+	}
+
+
+
+/****************************************************************************
+ * statistics_header_csv
+ ****************************************************************************/
+static cw_char_t *
+statistics_header_csv(
+	cw_char_t			*line,
+	cw_size_t			size)
+
+	{
+	cw_count_t			l;
+	cw_index_t			i;
+
+	l = string_snprintf(line, size, "track,clock,pulses,time_us,revolutions,revolution_us,revolution_min_us,revolution_max_us,rpm,peaks");
+	for (i = 0; i < STATISTICS_NR_PEAKS; i++) l += string_snprintf(&line[l], size - l, ",peak%d_position,peak%d_width,peak%d_count", i, i, i);
+	for (i = 0; i < GLOBAL_NR_PULSE_LENGTHS; i++) l += string_snprintf(&line[l], size - l, ",h%02x", i);
+	return (line);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * statistics_init
+ ****************************************************************************/
+cw_void_t
+statistics_init(
+	struct statistics		*stt,
+	cw_count_t			tracks)
+
+	{
+	*stt = (struct statistics) { .size = tracks };
+	stt->stt_trk = calloc((tracks > 0) ? tracks : 1, sizeof (struct statistics_track));
+	if (stt->stt_trk == NULL) error_oom();
+	if (pthread_mutex_init(&stt->mutex, NULL) != 0) error_message("error while initializing statistics mutex");
+	}
+
+
+
+/****************************************************************************
+ * statistics_deinit
+ ****************************************************************************/
+cw_void_t
+statistics_deinit(
+	struct statistics		*stt)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < stt->tracks; i++) free(stt->stt_trk[i].data);
+	free(stt->stt_trk);
+	pthread_mutex_destroy(&stt->mutex);
+	}
+
+
+
+/****************************************************************************
+ * statistics_add_track
+ ****************************************************************************/
+cw_void_t
+statistics_add_track(
+	struct statistics		*stt,
+	struct fifo			*ffo,
+	cw_count_t			cwtool_track,
+	cw_count_t			clock)
+
+	{
+	struct statistics_track		*stt_trk;
+	cw_size_t			size = fifo_get_wr_ofs(ffo);
+
+	/* the data is copied, so all tracks can be analyzed later at once */
+
+	error_condition(stt->tracks >= stt->size);
+	stt_trk  = &stt->stt_trk[stt->tracks++];
+	*stt_trk = (struct statistics_track)
+		{
+		.cwtool_track = cwtool_track,
+		.clock        = clock,
+		.flags        = fifo_get_flags(ffo),
+		.data         = malloc((size > 0) ? size : 1),
+		.size         = size
+		};
+	if (stt_trk->data == NULL) error_oom();
+	memcpy(stt_trk->data, fifo_get_data(ffo), size);
+	}
+
+
+
+/****************************************************************************
+ * statistics_calculate
+ ****************************************************************************/
+cw_void_t
+statistics_calculate(
+	struct statistics		*stt,
+	cw_count_t			threads)
+
+	{
+	pthread_t			thread[GLOBAL_NR_THREADS];
+	cw_index_t			i;
+
+	/* threads == 0 means one thread for each online cpu */
+
+	if (threads == 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > GLOBAL_NR_THREADS) threads = GLOBAL_NR_THREADS;
+	if (threads > stt->tracks) threads = stt->tracks;
+	if (threads < 1) threads = 1;
+	verbose_message(GENERIC, 1, "calculating statistics of %d tracks with %d threads", stt->tracks, threads);
+	stt->next = 0;
+	for (i = 0; i < threads; i++) if (pthread_create(&thread[i], NULL, statistics_thread, stt) != 0) error_message("error while creating thread");
+	for (i = 0; i < threads; i++) pthread_join(thread[i], NULL);
+	statistics_sum(stt);
+	}
+
+
+
+/****************************************************************************
+ * statistics_print
+ ****************************************************************************/
+cw_void_t
+statistics_print(
+	struct statistics		*stt,
+	const cw_char_t			*disk_name,
+	cw_mode_t			format)
+
+	{
+	cw_char_t			line[LINE_SIZE];
+	cw_index_t			i;
+
+	debug_error_condition((format != OPTIONS_STATISTICS_FORMAT_CSV) && (format != OPTIONS_STATISTICS_FORMAT_JSON));
+	if (format == OPTIONS_STATISTICS_FORMAT_CSV)
+		{
+		printf("%s\n", statistics_header_csv(line, sizeof (line)));
+		for (i = 0; i < stt->tracks; i++) printf("%s\n", statistics_line(line, sizeof (line), &stt->stt_trk[i], format));
+		printf("%s\n", statistics_line(line, sizeof (line), &stt->sum, format));
+		return;
+		}
+	printf("{\n\"disk\": \"%s\",\n\"tracks\": [\n", statistics_json_string(line, sizeof (line), disk_name));
+	for (i = 0; i < stt->tracks; i++) printf("%s%s\n", statistics_line(line, sizeof (line), &stt->stt_trk[i], format), (i + 1 < stt->tracks) ? "," : "");
+	printf("],\n\"summary\": %s\n}\n", statistics_line(line, sizeof (line), &stt->sum, format));
+	}
+/******************************************************** Karsten Scheibler */
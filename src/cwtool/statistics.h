@@ -0,0 +1,122 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * statistics.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_STATISTICS_H
+#define CWTOOL_STATISTICS_H
+
+#include <pthread.h>
+
+#include "types.h"
+#include "global.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * statistics of the raw counter values of each track and of the whole
+ * disk. positions of peaks are given in 1/100 counter values, the width
+ * of a peak is its full width at half maximum in counter values.
+ * revolutions are measured between two index pulses, this is only
+ * possible if the index was stored together with the data
+ */
+
+#define STATISTICS_NR_PEAKS		GLOBAL_NR_BOUNDS
+
+struct statistics_peak
+	{
+	cw_count_t			position;
+	cw_count_t			width;
+	cw_count_t			count;
+	};
+
+struct statistics_track
+	{
+	cw_count_t			cwtool_track;
+	cw_count_t			clock;
+	cw_flag_t			flags;
+	cw_raw8_t			*data;
+	cw_size_t			size;
+	cw_count_t			pulses;
+	cw_count64_t			nsecs;
+	cw_count_t			revolutions;
+	cw_count64_t			revolution_nsecs;
+	cw_count64_t			revolution_min;
+	cw_count64_t			revolution_max;
+	cw_count_t			peaks;
+	struct statistics_peak		pek[STATISTICS_NR_PEAKS];
+	cw_count_t			histogram[GLOBAL_NR_PULSE_LENGTHS];
+	};
+
+struct statistics
+	{
+	struct statistics_track		*stt_trk;
+	cw_count_t			tracks;
+	cw_count_t			size;
+	struct statistics_track		sum;
+	pthread_mutex_t			mutex;
+	cw_index_t			next;
+	};
+
+struct fifo;
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+statistics_init(
+	struct statistics		*stt,
+	cw_count_t			tracks);
+
+extern cw_void_t
+statistics_deinit(
+	struct statistics		*stt);
+
+extern cw_void_t
+statistics_add_track(
+	struct statistics		*stt,
+	struct fifo			*ffo,
+	cw_count_t			cwtool_track,
+	cw_count_t			clock);
+
+extern cw_void_t
+statistics_calculate(
+	struct statistics		*stt,
+	cw_count_t			threads);
+
+extern cw_void_t
+statistics_print(
+	struct statistics		*stt,
+	const cw_char_t			*disk_name,
+	cw_mode_t			format);
+
+
+
+#endif /* !CWTOOL_STATISTICS_H */
+/******************************************************** Karsten Scheibler */